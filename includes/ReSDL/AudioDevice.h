@@ -73,9 +73,14 @@ namespace ReSDL {
             SDL_UnlockAudioDevice(this->id);
         }
 
+        // queues a contiguous container of samples, the size is given to SDL in bytes
         template<typename T>
         void queueAudio(const T& data) {
-            SDL_QueueAudio(this->id, std::data(data), std::size(data));
+            queueAudio(std::data(data), static_cast<Uint32>(std::size(data) * sizeof(*std::data(data))));
+        }
+
+        void queueAudio(const void* data, Uint32 bytes) {
+            SDL_QueueAudio(this->id, data, bytes);
         }
     };
 }
\ No newline at end of file
@@ -1,5 +1,22 @@
 namespace ReSDL {
 
+	// all inputs of a game controller at one point in time, filled by GameController::snapshot
+	struct GameControllerState
+	{
+		Sint16 axes[SDL_CONTROLLER_AXIS_MAX];
+		Uint32 buttons;
+
+		Sint16 axis(SDL_GameControllerAxis index) const
+		{
+			return axes[index];
+		}
+
+		bool button(SDL_GameControllerButton index) const
+		{
+			return (buttons >> index) & 1;
+		}
+	};
+
 	struct GameController 
 	{
 		sdl_handle<SDL_GameController> handle;
@@ -7,11 +24,19 @@ namespace ReSDL {
 		GameController(int device_index)
 			: handle(SDL_GameControllerOpen(device_index), SDL_GameControllerClose)
 		{
+			const char* controllerName = SDL_GameControllerName(handle.get());
+			m_name = controllerName ? controllerName : "";
+			m_instanceId = SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(handle.get()));
+		}
+
+		const std::string& name() const
+		{
+			return m_name;
 		}
 
-		std::string name() const
+		SDL_JoystickID instanceId() const
 		{
-			return SDL_GameControllerName(handle.get());
+			return m_instanceId;
 		}
 
 		std::string mapping() const
@@ -34,10 +59,28 @@ namespace ReSDL {
 			return SDL_GameControllerGetJoystick(handle.get());
 		}
 
+		// reads all axes and buttons in one pass
+		void snapshot(GameControllerState& state) const
+		{
+			SDL_GameController* controller = handle.get();
+			for (int i = 0; i < SDL_CONTROLLER_AXIS_MAX; ++i) {
+				state.axes[i] = SDL_GameControllerGetAxis(controller, static_cast<SDL_GameControllerAxis>(i));
+			}
+			Uint32 buttons = 0;
+			for (int i = 0; i < SDL_CONTROLLER_BUTTON_MAX; ++i) {
+				buttons |= static_cast<Uint32>(SDL_GameControllerGetButton(controller, static_cast<SDL_GameControllerButton>(i)) != 0) << i;
+			}
+			state.buttons = buttons;
+		}
+
 		static bool isGameController(int joystick_index)
 		{
 			return SDL_IsGameController(joystick_index);
 		}
+
+	private:
+		std::string m_name;
+		SDL_JoystickID m_instanceId;
 	};
 
 }
\ No newline at end of file
@@ -1,5 +1,26 @@
+#include <algorithm>
+
 namespace ReSDL {
 
+	// all inputs of a joystick at one point in time, filled by Joystick::snapshot
+	struct JoystickState
+	{
+		static constexpr int MaxAxes = 16;
+		static constexpr int MaxButtons = 32;
+		static constexpr int MaxHats = 4;
+
+		Sint16 axes[MaxAxes];
+		Uint32 buttons;
+		Uint8 hats[MaxHats];
+		Uint8 numAxes;
+		Uint8 numButtons;
+		Uint8 numHats;
+
+		bool button(int index) const
+		{
+			return (buttons >> index) & 1;
+		}
+	};
 
 	struct Joystick
 	{
@@ -8,16 +29,22 @@ namespace ReSDL {
 		Joystick(int device_index)
 			: handle(SDL_JoystickOpen(device_index), SDL_JoystickClose)
 		{
+			const char* joystickName = SDL_JoystickName(handle.get());
+			m_name = joystickName ? joystickName : "";
+			m_numAxes = SDL_JoystickNumAxes(handle.get());
+			m_numButtons = SDL_JoystickNumButtons(handle.get());
+			m_numHats = SDL_JoystickNumHats(handle.get());
+			m_instanceId = SDL_JoystickInstanceID(handle.get());
 		}
 
-		std::string name() const
+		const std::string& name() const
 		{
-			return SDL_JoystickName(handle.get());
+			return m_name;
 		}
 
 		SDL_JoystickID instanceId() const
 		{
-			return SDL_JoystickInstanceID(handle.get());
+			return m_instanceId;
 		}
 
 		Sint16 getAxis(int axis) const
@@ -27,7 +54,7 @@ namespace ReSDL {
 
 		int numAxes() const
 		{
-			return SDL_JoystickNumAxes(handle.get());
+			return m_numAxes;
 		}
 
 		Uint8 getButton(int button) const
@@ -37,7 +64,7 @@ namespace ReSDL {
 
 		int numButtons() const
 		{
-			return SDL_JoystickNumButtons(handle.get());
+			return m_numButtons;
 		}
 
 		Uint8 getHat(int hat) const
@@ -47,7 +74,28 @@ namespace ReSDL {
 
 		int numHats() const
 		{
-			return SDL_JoystickNumHats(handle.get());
+			return m_numHats;
+		}
+
+		// reads all axes, buttons and hats in one pass, counts are clamped to the state's capacity
+		// and to 0 when SDL reported an error (-1)
+		void snapshot(JoystickState& state) const
+		{
+			SDL_Joystick* joystick = handle.get();
+			state.numAxes = static_cast<Uint8>(std::clamp(m_numAxes, 0, JoystickState::MaxAxes));
+			state.numButtons = static_cast<Uint8>(std::clamp(m_numButtons, 0, JoystickState::MaxButtons));
+			state.numHats = static_cast<Uint8>(std::clamp(m_numHats, 0, JoystickState::MaxHats));
+			for (int i = 0; i < state.numAxes; ++i) {
+				state.axes[i] = SDL_JoystickGetAxis(joystick, i);
+			}
+			Uint32 buttons = 0;
+			for (int i = 0; i < state.numButtons; ++i) {
+				buttons |= static_cast<Uint32>(SDL_JoystickGetButton(joystick, i) != 0) << i;
+			}
+			state.buttons = buttons;
+			for (int i = 0; i < state.numHats; ++i) {
+				state.hats[i] = SDL_JoystickGetHat(joystick, i);
+			}
 		}
 		//--------------------------------------------------------------------------
 
@@ -61,6 +109,18 @@ namespace ReSDL {
 			return SDL_NumJoysticks();
 		}
 
+		// instance id of the device before it is opened, -1 for an invalid index
+		static SDL_JoystickID instanceIdForIndex(int device_index)
+		{
+			return SDL_JoystickGetDeviceInstanceID(device_index);
+		}
+
+	private:
+		std::string m_name;
+		int m_numAxes;
+		int m_numButtons;
+		int m_numHats;
+		SDL_JoystickID m_instanceId;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#include "SDL.h"
+
+namespace ReSDL {
+
+
+	// one row of pixels, width elements starting at data
+	template<typename T>
+	struct PixelRow
+	{
+		T* data;
+		int width;
+
+		T* begin() const {
+			return data;
+		}
+
+		T* end() const {
+			return data + width;
+		}
+
+		int size() const {
+			return width;
+		}
+
+		T& operator[](int x) const {
+			return data[x];
+		}
+	};
+
+	// A typed 2D window into pixel memory that does not own it. Rows are pitch bytes apart,
+	// which may be more than width pixels; sub views share the pitch of the view they come from.
+	template<typename T>
+	struct PixelView
+	{
+		T* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+		// bytes from one row to the next
+		int pitch = 0;
+
+		PixelView() = default;
+
+		PixelView(T* pixels, int width, int height, int pitch)
+			: pixels(pixels)
+			, width(width)
+			, height(height)
+			, pitch(pitch)
+		{
+		}
+
+		// a view of const pixels from a mutable one
+		template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+		PixelView(const PixelView<U>& other)
+			: PixelView(other.pixels, other.width, other.height, other.pitch)
+		{
+		}
+
+		bool empty() const {
+			return width <= 0 || height <= 0;
+		}
+
+		T* rowData(int y) const {
+			using Byte = typename std::conditional<std::is_const<T>::value, const uint8_t, uint8_t>::type;
+			return reinterpret_cast<T*>(reinterpret_cast<Byte*>(pixels) + static_cast<ptrdiff_t>(y) * pitch);
+		}
+
+		PixelRow<T> row(int y) const {
+			return { rowData(y), width };
+		}
+
+		T& operator()(int x, int y) const {
+			return rowData(y)[x];
+		}
+
+		// the part of the view inside rect, clipped to the view
+		PixelView sub(const SDL_Rect& rect) const {
+			const int x0 = std::max(rect.x, 0);
+			const int y0 = std::max(rect.y, 0);
+			const int x1 = std::min(rect.x + rect.w, width);
+			const int y1 = std::min(rect.y + rect.h, height);
+			if(x1 <= x0 || y1 <= y0) {
+				return PixelView(pixels, 0, 0, pitch);
+			}
+			return PixelView(rowData(y0) + x0, x1 - x0, y1 - y0, pitch);
+		}
+
+		// true if rows follow each other without padding, so the view is one run of pixels
+		bool contiguous() const {
+			return pitch == static_cast<int>(width * sizeof(T));
+		}
+	};
+
+
+}
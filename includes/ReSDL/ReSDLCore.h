@@ -11,6 +11,7 @@
 #include "ReSDL/ReSDLTypes.h"
 #include "ReSDL/ReSDLCommon.h"
 #include "ReSDL/AudioDevice.h"
+#include "ReSDL/PixelView.h"
 #include "ReSDL/Surface.h"
 #include "ReSDL/Window.h"
 #include "ReSDL/Renderer.h"
@@ -55,4 +55,43 @@ namespace ReSDL {
 		}
 	};
 
+	// Keeps a surface locked for as long as it lives, so its pixels may be accessed directly.
+	// Surfaces that do not need locking are left alone.
+	class SurfaceLock
+	{
+		SDL_Surface* surface;
+		bool locked = false;
+	public:
+		explicit SurfaceLock(Surface& surface)
+			: surface(surface.handle.get())
+		{
+			if(SDL_MUSTLOCK(this->surface)) {
+				check(SDL_LockSurface(this->surface));
+				locked = true;
+			}
+		}
+
+		SurfaceLock(const SurfaceLock&) = delete;
+		SurfaceLock& operator=(const SurfaceLock&) = delete;
+
+		~SurfaceLock() {
+			if(locked) {
+				SDL_UnlockSurface(surface);
+			}
+		}
+
+		const SDL_PixelFormat& format() const {
+			return *surface->format;
+		}
+
+		// the pixels as T, which has to be as large as one pixel, e.g. Uint32 for 32 bit formats
+		template<typename T>
+		PixelView<T> view() const {
+			if(surface->format->BytesPerPixel != sizeof(T)) {
+				throw std::runtime_error("SurfaceLock: the surface has " + std::to_string(surface->format->BytesPerPixel) + " bytes per pixel, the view " + std::to_string(sizeof(T)));
+			}
+			return PixelView<T>(static_cast<T*>(surface->pixels), surface->w, surface->h, surface->pitch);
+		}
+	};
+
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+
+#include "Engine/Engine.h"
+#include "Bench.h"
+#include "VirtualControllers.h"
+
+using namespace Engine::Input;
+
+namespace {
+	// counts heap allocations, to show that a frame of input does none
+	std::atomic<size_t> allocations{ 0 };
+}
+
+void* operator new(size_t size)
+{
+	++allocations;
+	if(void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace {
+
+const SDL_GameControllerAxis axes[] = { SDL_CONTROLLER_AXIS_LEFTX, SDL_CONTROLLER_AXIS_LEFTY, SDL_CONTROLLER_AXIS_RIGHTX, SDL_CONTROLLER_AXIS_RIGHTY, SDL_CONTROLLER_AXIS_TRIGGERLEFT, SDL_CONTROLLER_AXIS_TRIGGERRIGHT };
+
+// every controller gets up to six axis mappings, the rest of mappingsPerController as button
+// mappings, plus a stick and a d-pad
+void configure(AxisInputManager& input, const std::vector<std::shared_ptr<ReSDL::GameController>>& controllers, size_t mappingsPerController, double& sink)
+{
+	for(size_t i = 0; i < AxisCount; ++i) {
+		input.setAxisHandler(static_cast<Axis>(i), [&sink](Axis, double value) { sink += value; });
+	}
+	for(size_t i = 0; i < RadialCount; ++i) {
+		input.setRadialHandler(static_cast<Radial>(i), [&sink](Radial, Vec2d value) { sink += value[0]; });
+	}
+	for(size_t i = 0; i < ButtonCount; ++i) {
+		input.setButtonHandler(static_cast<Button>(i), [&sink](Button, ButtonState state) { sink += static_cast<int>(state); });
+	}
+	for(size_t key = 0; key < 8; ++key) {
+		input.setKeyMapping(static_cast<Axis>(key % AxisCount), static_cast<Uint8>(SDL_SCANCODE_A + key), 0.0, 1.0);
+	}
+	for(const auto& controller : controllers) {
+		const size_t axisMappings = std::min<size_t>(mappingsPerController / 2, 6);
+		for(size_t m = 0; m < axisMappings; ++m) {
+			input.setGameControllerMapping(controller, axes[m], static_cast<Axis>(m), [](Sint16 value) { return value / 32767.0; });
+		}
+		for(size_t m = 0; m < mappingsPerController - axisMappings; ++m) {
+			input.setGameControllerMapping(controller, static_cast<SDL_GameControllerButton>(m), static_cast<Button>(m % ButtonCount));
+		}
+		input.setGameControllerMapping(controller, SDL_CONTROLLER_AXIS_LEFTX, SDL_CONTROLLER_AXIS_LEFTY, Radial::Main, [](Sint16 x, Sint16 y) { return Vec2d{ x / 32767.0, y / 32767.0 }; });
+		input.setGameControllerMapping(controller, SDL_CONTROLLER_BUTTON_DPAD_UP, SDL_CONTROLLER_BUTTON_DPAD_DOWN, SDL_CONTROLLER_BUTTON_DPAD_LEFT, SDL_CONTROLLER_BUTTON_DPAD_RIGHT, Radial::Secondary);
+	}
+}
+
+}
+
+int main()
+{
+	ReSDL::SDL sdl(SDL_INIT_GAMECONTROLLER);
+	Bench::VirtualControllers pads(8);
+	if(!pads.available()) {
+		std::printf("no virtual game controllers, skipping: %s\n", pads.error().c_str());
+		return 0;
+	}
+	// every frame starts by moving all controllers, that part is measured alone and subtracted
+	const double device = Bench::measure([&] {
+		pads.step();
+		return 0;
+	});
+	Bench::report("moving 8 virtual controllers", device);
+
+	for(size_t controllerCount : { 1, 4, 8 }) {
+		for(size_t mappings : { 4, 12, 20 }) {
+			const std::vector<std::shared_ptr<ReSDL::GameController>> controllers(pads.controllers().begin(), pads.controllers().begin() + controllerCount);
+			AxisInputManager input;
+			double sink = 0.0;
+			configure(input, controllers, mappings, sink);
+			pads.rewind();
+			input.handleAndSubmitEvents();
+
+			const size_t before = allocations;
+			size_t frames = 0;
+			const double frame = Bench::measure([&] {
+				pads.step();
+				input.handleAndSubmitEvents();
+				++frames;
+				return sink;
+			}) - device;
+			const double perFrame = static_cast<double>(allocations - before) / frames;
+
+			const std::string name = "polling frame, " + std::to_string(controllerCount) + " controllers x " + std::to_string(mappings + 2) + " mappings";
+			Bench::report(name, frame, std::to_string(perFrame).substr(0, 4) + " allocations per frame");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace Bench {
+
+// Calls func until at least minSeconds have passed and returns the mean time of one call in
+// nanoseconds. func should return a value that depends on its work, so it can not be dropped.
+template<typename Func>
+double measure(Func&& func, double minSeconds = 0.25)
+{
+	using Clock = std::chrono::steady_clock;
+	volatile double sink = 0.0;
+	sink = sink + static_cast<double>(func());
+	size_t calls = 0;
+	const auto start = Clock::now();
+	std::chrono::duration<double> elapsed(0.0);
+	do {
+		sink = sink + static_cast<double>(func());
+		++calls;
+		elapsed = Clock::now() - start;
+	} while(elapsed.count() < minSeconds);
+	return elapsed.count() * 1e9 / calls;
+}
+
+inline void report(const std::string& name, double nanoseconds, const std::string& extra = std::string())
+{
+	if(nanoseconds >= 1e6) {
+		std::printf("%-48s %10.3f ms  %s\n", name.c_str(), nanoseconds / 1e6, extra.c_str());
+	}
+	else if(nanoseconds >= 1e3) {
+		std::printf("%-48s %10.3f us  %s\n", name.c_str(), nanoseconds / 1e3, extra.c_str());
+	}
+	else {
+		std::printf("%-48s %10.3f ns  %s\n", name.c_str(), nanoseconds, extra.c_str());
+	}
+}
+
+}
@@ -0,0 +1,125 @@
+#include <vector>
+#include <string>
+#include <random>
+
+#include "Engine/Physics/Broadphase.h"
+#include "Bench.h"
+
+using namespace Engine;
+using namespace Engine::Physics;
+
+namespace {
+
+// bodies of 1 to 4 units spread so that each overlaps a handful of others
+std::vector<Aabb2d> makeBoxes(size_t count, std::minstd_rand& random)
+{
+	const double extent = std::sqrt(static_cast<double>(count)) * 6.0;
+	std::uniform_real_distribution<double> position(0.0, extent);
+	std::uniform_real_distribution<double> size(1.0, 4.0);
+	std::vector<Aabb2d> boxes(count);
+	for(auto& box : boxes) {
+		box.min = Vec2d{ position(random), position(random) };
+		box.max = Vec2d{ box.min[0] + size(random), box.min[1] + size(random) };
+	}
+	return boxes;
+}
+
+void nudge(Aabb2d& box, std::minstd_rand& random)
+{
+	std::uniform_real_distribution<double> step(-0.5, 0.5);
+	const Vec2d offset{ step(random), step(random) };
+	box.min = box.min + offset;
+	box.max = box.max + offset;
+}
+
+}
+
+int main()
+{
+	Concurrency::ThreadPool pool;
+	std::printf("%zu pool workers\n", pool.size());
+
+	for(size_t count : { 1000, 10000, 100000 }) {
+		std::minstd_rand random(1);
+		std::vector<Aabb2d> boxes = makeBoxes(count, random);
+		const size_t moving = count / 100;
+		const std::string n = " " + std::to_string(count) + " bodies";
+		std::vector<BodyPair> added;
+		std::vector<BodyPair> removed;
+		std::vector<BodyPair> pairs;
+
+		if(count <= 10000) {
+			const double naive = Bench::measure([&] {
+				pairs.clear();
+				for(BodyId a = 0; a < count; ++a) {
+					for(BodyId b = a + 1; b < count; ++b) {
+						if(boxes[a].overlaps(boxes[b])) {
+							pairs.push_back({ a, b });
+						}
+					}
+				}
+				return pairs.size();
+			});
+			Bench::report("all pairs O(n^2)," + n, naive, std::to_string(pairs.size()) + " pairs");
+		}
+
+		const double gridBuild = Bench::measure([&] {
+			SpatialHashGrid grid(8.0);
+			for(const auto& box : boxes) {
+				grid.insert(box);
+			}
+			added.clear();
+			removed.clear();
+			grid.updatePairs(added, removed);
+			return added.size();
+		});
+		Bench::report("SpatialHashGrid build," + n, gridBuild, std::to_string(added.size()) + " pairs");
+
+		SpatialHashGrid grid(8.0);
+		for(const auto& box : boxes) {
+			grid.insert(box);
+		}
+		grid.updatePairs(added, removed);
+		const double gridIncremental = Bench::measure([&] {
+			for(size_t i = 0; i < moving; ++i) {
+				const BodyId id = static_cast<BodyId>(random() % count);
+				nudge(boxes[id], random);
+				grid.update(id, boxes[id]);
+			}
+			added.clear();
+			removed.clear();
+			grid.updatePairs(added, removed);
+			return added.size() + removed.size();
+		});
+		Bench::report("SpatialHashGrid 1% moved," + n, gridIncremental);
+
+		SweepAndPrune sweep;
+		for(const auto& box : boxes) {
+			sweep.insert(box);
+		}
+		const double sweepIncremental = Bench::measure([&] {
+			for(size_t i = 0; i < moving; ++i) {
+				const BodyId id = static_cast<BodyId>(random() % count);
+				nudge(boxes[id], random);
+				sweep.update(id, boxes[id]);
+			}
+			pairs.clear();
+			sweep.findPairs(pairs);
+			return pairs.size();
+		});
+		Bench::report("SweepAndPrune 1% moved," + n, sweepIncremental, std::to_string(pairs.size()) + " pairs");
+
+		const double sweepParallel = Bench::measure([&] {
+			for(size_t i = 0; i < moving; ++i) {
+				const BodyId id = static_cast<BodyId>(random() % count);
+				nudge(boxes[id], random);
+				sweep.update(id, boxes[id]);
+			}
+			pairs.clear();
+			sweep.findPairs(pairs, &pool);
+			return pairs.size();
+		});
+		Bench::report("SweepAndPrune 1% moved, pool," + n, sweepParallel);
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+#include "SDL.h"
+#include "Engine/Audio/Capture.h"
+#include "Bench.h"
+
+using namespace Engine::Audio;
+
+namespace {
+
+// iterative radix-2 with a bit reversal pass on the same split arrays, as the scalar reference
+void referenceFft(float* re, float* im, const std::vector<float>& cosines, const std::vector<float>& sines, size_t n)
+{
+	for(size_t i = 1, j = 0; i < n; ++i) {
+		size_t bit = n >> 1;
+		for(; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if(i < j) {
+			std::swap(re[i], re[j]);
+			std::swap(im[i], im[j]);
+		}
+	}
+	for(size_t length = 2; length <= n; length <<= 1) {
+		const size_t half = length / 2;
+		const size_t step = n / length;
+		for(size_t i = 0; i < n; i += length) {
+			for(size_t k = 0; k < half; ++k) {
+				const float wr = cosines[k * step];
+				const float wi = sines[k * step];
+				const float br = re[i + k + half];
+				const float bi = im[i + k + half];
+				const float oddR = br * wr - bi * wi;
+				const float oddI = br * wi + bi * wr;
+				re[i + k + half] = re[i + k] - oddR;
+				im[i + k + half] = im[i + k] - oddI;
+				re[i + k] += oddR;
+				im[i + k] += oddI;
+			}
+		}
+	}
+}
+
+void runFft(size_t size)
+{
+	std::minstd_rand random(7);
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+	std::vector<float> re(size), im(size);
+	for(size_t i = 0; i < size; ++i) {
+		re[i] = value(random);
+		im[i] = value(random);
+	}
+	const double pi = std::acos(-1.0);
+	std::vector<float> cosines(size / 2), sines(size / 2);
+	for(size_t k = 0; k < size / 2; ++k) {
+		cosines[k] = static_cast<float>(std::cos(-2.0 * pi * k / size));
+		sines[k] = static_cast<float>(std::sin(-2.0 * pi * k / size));
+	}
+	const std::vector<float> inputRe = re, inputIm = im;
+
+	// the transforms run on their own output, the inverse keeps the values from growing
+	Fft fft(size);
+	const double forward = Bench::measure([&] {
+		fft.forward(re.data(), im.data());
+		fft.inverse(re.data(), im.data());
+		return re[0];
+	}) / 2;
+	std::vector<float> referenceRe(size), referenceIm(size);
+	const double reference = Bench::measure([&] {
+		std::copy(inputRe.begin(), inputRe.end(), referenceRe.begin());
+		std::copy(inputIm.begin(), inputIm.end(), referenceIm.begin());
+		referenceFft(referenceRe.data(), referenceIm.data(), cosines, sines, size);
+		return referenceRe[0];
+	});
+
+	// the usual 5 n log2(n) flops of a radix-2 transform, to compare sizes
+	const double flops = 5.0 * size * std::log2(static_cast<double>(size));
+	char extra[64];
+	std::snprintf(extra, sizeof(extra), "%7.0f MFLOPS", flops / forward * 1e3);
+	Bench::report("Fft " + std::to_string(size), forward, extra);
+	std::snprintf(extra, sizeof(extra), "%7.0f MFLOPS", flops / reference * 1e3);
+	Bench::report("scalar radix-2 reference " + std::to_string(size), reference, extra);
+}
+
+// one analysis window: window, spectrum, band energies and the pitch autocorrelation
+void runAnalyzer(size_t fftSize, size_t hop)
+{
+	const int rate = 48000;
+	AudioCapture capture(fftSize * 4);
+	capture.setFormat(AudioFormat{ rate, 1, AUDIO_F32SYS, static_cast<int>(hop) });
+	CaptureAnalyzer analyzer(capture, fftSize, hop);
+	std::vector<float> tone(hop);
+	size_t sample = 0;
+	CaptureFeatures features;
+	const double window = Bench::measure([&] {
+		for(size_t i = 0; i < hop; ++i, ++sample) {
+			tone[i] = static_cast<float>(0.3 * std::sin(2.0 * 3.14159265358979 * 220.0 * sample / rate));
+		}
+		capture.write(tone.data(), hop);
+		const size_t windows = analyzer.analyze();
+		analyzer.poll(features);
+		return windows;
+	});
+	const double budget = 1e9 * hop / rate;
+	char extra[64];
+	std::snprintf(extra, sizeof(extra), "%5.2f%% of the %.2f ms hop", 100.0 * window / budget, budget / 1e6);
+	Bench::report("CaptureAnalyzer " + std::to_string(fftSize) + " / hop " + std::to_string(hop) + ", per window", window, extra);
+}
+
+}
+
+int main()
+{
+	for(size_t size = 64; size <= 16384; size *= 2) {
+		runFft(size);
+	}
+	runAnalyzer(1024, 256);
+	runAnalyzer(2048, 256);
+	runAnalyzer(4096, 512);
+	return 0;
+}
@@ -0,0 +1,120 @@
+#include <vector>
+#include <string>
+#include <cmath>
+#include <random>
+#include <chrono>
+
+#include "SDL.h"
+#include "Engine/Engine.h"
+#include "Bench.h"
+
+using namespace Engine;
+
+namespace {
+
+constexpr size_t Count = 4096;
+
+double toDouble(double value)
+{
+	return value;
+}
+
+double toDouble(Fixed value)
+{
+	return value.toDouble();
+}
+
+double length(const Vec2d& v)
+{
+	return std::sqrt(v * v);
+}
+
+Fixed length(const Vec2fx& v)
+{
+	return sqrt(v * v);
+}
+
+// the same work on the double and the Fixed path; values start out equal up to rounding
+template<typename T>
+struct Run
+{
+	using V = Vec<T, 2>;
+	using Point = PhysicsPoint<T, T, std::chrono::milliseconds, 2>;
+
+	std::vector<V> position, velocity, acceleration;
+	std::vector<Point> points;
+	double step = 0.0;
+	double dot = 0.0;
+	double lengths = 0.0;
+	double advance = 0.0;
+
+	Run()
+	{
+		std::minstd_rand random(7);
+		std::uniform_real_distribution<double> value(-10.0, 10.0);
+		for(size_t i = 0; i < Count; ++i) {
+			const V p{ T(value(random)), T(value(random)) };
+			const V v{ T(value(random)), T(value(random)) };
+			const V a{ T(value(random)), T(value(random)) };
+			position.push_back(p);
+			velocity.push_back(v);
+			acceleration.push_back(a);
+			points.emplace_back(T(1.0 + std::abs(value(random))), p, v);
+		}
+	}
+
+	void measure()
+	{
+		const T dt = T(0.016);
+		step = Bench::measure([&] {
+			for(size_t i = 0; i < Count; ++i) {
+				position[i] = position[i] + (velocity[i] + acceleration[i] * dt) * dt;
+			}
+			return toDouble(position[0][0]);
+		});
+		dot = Bench::measure([&] {
+			T sum = T(0);
+			for(size_t i = 0; i < Count; ++i) {
+				sum += velocity[i] * acceleration[i];
+			}
+			return toDouble(sum);
+		});
+		lengths = Bench::measure([&] {
+			T sum = T(0);
+			for(size_t i = 0; i < Count; ++i) {
+				sum += length(velocity[i]);
+			}
+			return toDouble(sum);
+		});
+		// a small impulse that does not let the points run away over millions of steps
+		const V impulse{ T(0.001), T(-0.001) };
+		advance = Bench::measure([&] {
+			for(auto& point : points) {
+				point = point.advance(impulse, std::chrono::milliseconds(16));
+			}
+			return toDouble(points[0].getPosition()[0]);
+		});
+	}
+};
+
+void report(const std::string& name, double reference, double fixed)
+{
+	const std::string per = " per " + std::to_string(Count);
+	Bench::report(name + " double," + per, reference);
+	Bench::report(name + " Fixed," + per, fixed, std::to_string(fixed / reference).substr(0, 4) + "x the double time");
+}
+
+}
+
+int main()
+{
+	Run<double> reference;
+	Run<Fixed> fixed;
+	reference.measure();
+	fixed.measure();
+	report("Vec2 p += (v + a * dt) * dt,", reference.step, fixed.step);
+	report("Vec2 dot,", reference.dot, fixed.dot);
+	report("Vec2 length,", reference.lengths, fixed.lengths);
+	report("PhysicsPoint2 advance,", reference.advance, fixed.advance);
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <memory>
+#include <algorithm>
+
+#include "SDL.h"
+#include "Engine/Audio/Midi.h"
+#include "Bench.h"
+
+using namespace Engine::Audio;
+
+namespace {
+
+constexpr int SampleRate = 48000;
+constexpr size_t BlockFrames = 256;
+
+// renders the whole song in device sized blocks until the last notes rang out
+void run(const std::shared_ptr<const MidiFile>& file, size_t voices)
+{
+	MidiPlayer player(file, SampleRate, voices);
+	std::vector<float> stereo(BlockFrames * 2);
+	size_t frames = 0;
+	size_t peakVoices = 0;
+	const double song = Bench::measure([&] {
+		player.rewind();
+		frames = 0;
+		float sum = 0.0f;
+		while(!player.finished()) {
+			frames += player.render(stereo.data(), BlockFrames);
+			peakVoices = std::max(peakVoices, player.synth().activeVoices());
+			sum += stereo[0];
+		}
+		return sum;
+	}, 1.0);
+	const double seconds = static_cast<double>(frames) / SampleRate;
+	char extra[96];
+	std::snprintf(extra, sizeof(extra), "%.1f s of audio, %6.0fx real time, up to %zu voices", seconds, seconds * 1e9 / song, peakVoices);
+	Bench::report(std::to_string(voices) + " voices, whole song", song, extra);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 2) {
+		std::printf("usage: %s file.mid, e.g. test/Goose/resource/music.mid\n", argv[0]);
+		return 1;
+	}
+	const auto file = std::make_shared<const MidiFile>(argv[1]);
+	std::printf("%s: %zu tracks, %zu events, %.1f s\n", argv[1], file->tracks(), file->events().size(), file->duration());
+	for(size_t voices : { 8, 16, 32, 64 }) {
+		run(file, voices);
+	}
+	return 0;
+}
@@ -0,0 +1,89 @@
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+#include "SDL.h"
+#include "Engine/Audio/OutputConverter.h"
+#include "Bench.h"
+
+using namespace Engine::Audio;
+
+namespace {
+
+constexpr int MixRate = 48000;
+constexpr int BlockFrames = 256;
+
+// stands in for the mixer by copying a precomputed stereo sine, so the timings are the converter's
+struct Tone
+{
+	std::vector<float> table;
+	size_t position = 0;
+
+	Tone()
+	: table(2 * 4800)
+	{
+		for(size_t i = 0; i < table.size() / 2; ++i) {
+			const float value = static_cast<float>(0.5 * std::sin(2.0 * 3.14159265358979 * 440.0 * i / MixRate));
+			table[2 * i] = value;
+			table[2 * i + 1] = -value;
+		}
+	}
+
+	static void render(void* userdata, float* stereo, size_t frames)
+	{
+		auto* tone = static_cast<Tone*>(userdata);
+		const size_t length = tone->table.size() / 2;
+		while(frames > 0) {
+			const size_t count = std::min(frames, length - tone->position);
+			std::copy_n(&tone->table[2 * tone->position], 2 * count, stereo);
+			tone->position = (tone->position + count) % length;
+			stereo += 2 * count;
+			frames -= count;
+		}
+	}
+};
+
+const char* formatName(SDL_AudioFormat format)
+{
+	switch(format) {
+	case AUDIO_S16SYS: return "S16";
+	case AUDIO_S32SYS: return "S32";
+	default: return "F32";
+	}
+}
+
+void run(int deviceRate, int channels, SDL_AudioFormat format)
+{
+	AudioFormat device;
+	device.sampleRate = deviceRate;
+	device.channels = channels;
+	device.format = format;
+	device.blockFrames = BlockFrames;
+	Tone tone;
+	OutputConverter converter(MixRate, device, &Tone::render, &tone);
+	std::vector<Uint8> stream(static_cast<size_t>(BlockFrames) * device.bytesPerFrame());
+
+	const double block = Bench::measure([&] {
+		converter.render(stream.data(), stream.size());
+		return stream[0];
+	});
+	const double budget = device.blockDuration() * 1e9;
+	char extra[96];
+	std::snprintf(extra, sizeof(extra), "%8.1f ns per channel, %5.2f%% of the %.2f ms block", block / channels, 100.0 * block / budget, budget / 1e6);
+	Bench::report(std::to_string(MixRate) + " -> " + std::to_string(deviceRate) + " Hz " + formatName(format) + " x" + std::to_string(channels) + ", per block", block, extra);
+}
+
+}
+
+int main()
+{
+	for(int rate : { 48000, 44100, 96000 }) {
+		for(SDL_AudioFormat format : { AUDIO_F32SYS, AUDIO_S16SYS, AUDIO_S32SYS }) {
+			for(int channels : { 1, 2, 6 }) {
+				run(rate, channels, format);
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,39 @@
+#include <vector>
+#include <string>
+
+#include "Engine/Physics/PhysicsPointSystem.h"
+#include "Bench.h"
+
+using namespace Engine;
+
+int main()
+{
+	const std::chrono::milliseconds step(16);
+	const PhysicsPoint2d::ImpulseVector impulse{ 0.0, 0.01 };
+
+	for(size_t count : { 1000, 10000, 100000 }) {
+		std::vector<PhysicsPoint2d> points;
+		Physics::PhysicsPointSystem2d system(count);
+		for(size_t i = 0; i < count; ++i) {
+			const PhysicsPoint2d point(1.0 + i % 7, { double(i % 640), double(i % 480) }, { 0.01 * (i % 13), -0.02 * (i % 5) });
+			points.push_back(point);
+			system.add(point);
+		}
+
+		const double objects = Bench::measure([&] {
+			for(auto& point : points) {
+				point = point.advance(impulse, step);
+			}
+			return points[0].getPosition()[0];
+		});
+		const double arrays = Bench::measure([&] {
+			system.advance(impulse, step);
+			return system.positions(0)[0];
+		});
+
+		const std::string n = std::to_string(count);
+		Bench::report("PhysicsPoint2d::advance loop, " + n + " points", objects);
+		Bench::report("PhysicsPointSystem2d::advance, " + n + " points", arrays, std::to_string(objects / arrays).substr(0, 4) + "x");
+	}
+	return 0;
+}
@@ -0,0 +1,103 @@
+#include <memory>
+#include <cstdio>
+
+#include "Engine/Engine.h"
+#include "Engine/Input/StaticBindings.h"
+#include "Bench.h"
+#include "VirtualControllers.h"
+
+using namespace Engine::Input;
+
+// The same bindings once through AxisInputManager's std::function tables and once as a static
+// pipeline, both reading one virtual controller that moves every frame.
+int main()
+{
+	ReSDL::SDL sdl(SDL_INIT_GAMECONTROLLER);
+	Bench::VirtualControllers pads(1);
+	if(!pads.available()) {
+		std::printf("no virtual game controller, skipping: %s\n", pads.error().c_str());
+		return 0;
+	}
+	const auto controller = pads.controllers()[0];
+	double sink = 0.0;
+	auto axisHandler = [&sink](Axis, double value) { sink += value; };
+	auto radialHandler = [&sink](Radial, Vec2d value) { sink += value[0] + value[1]; };
+	auto buttonHandler = [&sink](Button, ButtonState state) { sink += static_cast<int>(state); };
+	auto linear = [](Sint16 value) { return value / 32767.0; };
+
+	AxisInputManager manager;
+	manager.setKeyMapping(Axis::Main_X, SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT, -1.0, 0.0, 1.0);
+	manager.setGameControllerMapping(controller, SDL_CONTROLLER_AXIS_LEFTX, Axis::Main_X, linear);
+	manager.setKeyMapping(Axis::Main_Y, SDL_SCANCODE_UP, SDL_SCANCODE_DOWN, -1.0, 0.0, 1.0);
+	manager.setGameControllerMapping(controller, SDL_CONTROLLER_AXIS_LEFTY, Axis::Main_Y, linear);
+	manager.setGameControllerMapping(controller, SDL_CONTROLLER_AXIS_TRIGGERRIGHT, Axis::Main_Z, linear);
+	manager.setKeyMapping(Radial::Main, SDL_SCANCODE_W, SDL_SCANCODE_S, SDL_SCANCODE_A, SDL_SCANCODE_D);
+	manager.setGameControllerMapping(controller, SDL_CONTROLLER_AXIS_RIGHTX, SDL_CONTROLLER_AXIS_RIGHTY, Radial::Main,
+		[](Sint16 x, Sint16 y) { return Vec2d{ x / 32767.0, y / 32767.0 }; });
+	manager.setGameControllerMapping(controller, SDL_CONTROLLER_BUTTON_DPAD_UP, SDL_CONTROLLER_BUTTON_DPAD_DOWN, SDL_CONTROLLER_BUTTON_DPAD_LEFT, SDL_CONTROLLER_BUTTON_DPAD_RIGHT, Radial::Secondary);
+	const SDL_Scancode keys[] = { SDL_SCANCODE_SPACE, SDL_SCANCODE_LCTRL, SDL_SCANCODE_E, SDL_SCANCODE_Q, SDL_SCANCODE_RETURN };
+	const SDL_GameControllerButton buttons[] = { SDL_CONTROLLER_BUTTON_A, SDL_CONTROLLER_BUTTON_B, SDL_CONTROLLER_BUTTON_X, SDL_CONTROLLER_BUTTON_Y, SDL_CONTROLLER_BUTTON_START };
+	const Button targets[] = { Button::A, Button::B, Button::X, Button::Y, Button::Start };
+	for(size_t i = 0; i < 5; ++i) {
+		manager.setKeyMapping(static_cast<Uint8>(keys[i]), targets[i]);
+		manager.setGameControllerMapping(controller, buttons[i], targets[i]);
+		manager.setButtonHandler(targets[i], buttonHandler);
+	}
+	manager.setAxisHandler(Axis::Main_X, axisHandler);
+	manager.setAxisHandler(Axis::Main_Y, axisHandler);
+	manager.setAxisHandler(Axis::Main_Z, axisHandler);
+	manager.setRadialHandler(Radial::Main, radialHandler);
+	manager.setRadialHandler(Radial::Secondary, radialHandler);
+
+	auto pipeline = makeInputPipeline(
+		bindAxis(Axis::Main_X, axisHandler, KeyPairAxis{ SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT }, ControllerAxis<>{ 0, SDL_CONTROLLER_AXIS_LEFTX }),
+		bindAxis(Axis::Main_Y, axisHandler, KeyPairAxis{ SDL_SCANCODE_UP, SDL_SCANCODE_DOWN }, ControllerAxis<>{ 0, SDL_CONTROLLER_AXIS_LEFTY }),
+		bindAxis(Axis::Main_Z, axisHandler, ControllerAxis<>{ 0, SDL_CONTROLLER_AXIS_TRIGGERRIGHT }),
+		bindRadial(Radial::Main, radialHandler, KeyCrossRadial{ SDL_SCANCODE_W, SDL_SCANCODE_S, SDL_SCANCODE_A, SDL_SCANCODE_D },
+			ControllerStickRadial<>{ 0, SDL_CONTROLLER_AXIS_RIGHTX, SDL_CONTROLLER_AXIS_RIGHTY }),
+		bindRadial(Radial::Secondary, radialHandler, ControllerCrossRadial{ 0, SDL_CONTROLLER_BUTTON_DPAD_UP, SDL_CONTROLLER_BUTTON_DPAD_DOWN, SDL_CONTROLLER_BUTTON_DPAD_LEFT, SDL_CONTROLLER_BUTTON_DPAD_RIGHT }),
+		bindButton(Button::A, buttonHandler, KeyButton{ SDL_SCANCODE_SPACE }, ControllerButton{ 0, SDL_CONTROLLER_BUTTON_A }),
+		bindButton(Button::B, buttonHandler, KeyButton{ SDL_SCANCODE_LCTRL }, ControllerButton{ 0, SDL_CONTROLLER_BUTTON_B }),
+		bindButton(Button::X, buttonHandler, KeyButton{ SDL_SCANCODE_E }, ControllerButton{ 0, SDL_CONTROLLER_BUTTON_X }),
+		bindButton(Button::Y, buttonHandler, KeyButton{ SDL_SCANCODE_Q }, ControllerButton{ 0, SDL_CONTROLLER_BUTTON_Y }),
+		bindButton(Button::Start, buttonHandler, KeyButton{ SDL_SCANCODE_RETURN }, ControllerButton{ 0, SDL_CONTROLLER_BUTTON_START }));
+
+	// both have to see and report the same input, or the comparison means nothing
+	double handled[2];
+	for(int side = 0; side < 2; ++side) {
+		pads.rewind();
+		sink = 0.0;
+		for(int frame = 0; frame < 1000; ++frame) {
+			pads.step();
+			if(side == 0) {
+				manager.handleAndSubmitEvents();
+			}
+			else {
+				pipeline.update(StaticInputState::capture().setController(0, *controller));
+			}
+		}
+		handled[side] = sink;
+	}
+
+	// the same frames of input for both, each frame starts by moving the controller
+	const auto frames = [&](auto&& frame) {
+		pads.rewind();
+		return Bench::measure([&] {
+			pads.step();
+			frame();
+			return sink;
+		});
+	};
+	const double device = frames([] {});
+	const double dynamic = frames([&] { manager.handleAndSubmitEvents(); }) - device;
+	const double fixed = frames([&] { pipeline.update(StaticInputState::capture().setController(0, *controller)); }) - device;
+
+	Bench::report("moving the virtual controller", device);
+	Bench::report("AxisInputManager polling frame (std::function)", dynamic);
+	Bench::report("StaticInputPipeline frame", fixed, std::to_string(dynamic / fixed).substr(0, 4) + "x");
+	if(handled[0] != handled[1]) {
+		std::printf("the pipelines reported different input: %f vs %f\n", handled[0], handled[1]);
+		return 1;
+	}
+	return 0;
+}
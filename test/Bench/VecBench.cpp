@@ -0,0 +1,85 @@
+#include <vector>
+#include <array>
+#include <string>
+#include <random>
+
+#include "SDL.h"
+#include "Engine/Utilities.h"
+#include "Bench.h"
+
+namespace {
+
+constexpr size_t Count = 4096;
+
+template<typename T, size_t N>
+void run(const std::string& name)
+{
+	std::minstd_rand random(7);
+	std::uniform_real_distribution<T> value(T(-10), T(10));
+	std::vector<Vec<T,N>> position(Count), velocity(Count), acceleration(Count);
+	std::vector<std::array<T,N>> plainPosition(Count), plainVelocity(Count), plainAcceleration(Count);
+	for(size_t i = 0; i < Count; ++i) {
+		for(size_t d = 0; d < N; ++d) {
+			plainPosition[i][d] = position[i][d] = value(random);
+			plainVelocity[i][d] = velocity[i][d] = value(random);
+			plainAcceleration[i][d] = acceleration[i][d] = value(random);
+		}
+	}
+	const T dt = T(0.016);
+
+	// the same step written against std::array, as the scalar reference
+	const double plain = Bench::measure([&] {
+		for(size_t i = 0; i < Count; ++i) {
+			for(size_t d = 0; d < N; ++d) {
+				plainPosition[i][d] = plainPosition[i][d] + (plainVelocity[i][d] + plainAcceleration[i][d] * dt) * dt;
+			}
+		}
+		return plainPosition[0][0];
+	});
+	const double eager = Bench::measure([&] {
+		for(size_t i = 0; i < Count; ++i) {
+			position[i] = position[i] + (velocity[i] + acceleration[i] * dt) * dt;
+		}
+		return position[0][0];
+	});
+	const double fused = Bench::measure([&] {
+		for(size_t i = 0; i < Count; ++i) {
+			position[i] = lazy(position[i]) + (lazy(velocity[i]) + lazy(acceleration[i]) * dt) * dt;
+		}
+		return position[0][0];
+	});
+	const double plainDot = Bench::measure([&] {
+		T sum = T(0);
+		for(size_t i = 0; i < Count; ++i) {
+			for(size_t d = 0; d < N; ++d) {
+				sum += plainVelocity[i][d] * plainAcceleration[i][d];
+			}
+		}
+		return sum;
+	});
+	const double dot = Bench::measure([&] {
+		T sum = T(0);
+		for(size_t i = 0; i < Count; ++i) {
+			sum += velocity[i] * acceleration[i];
+		}
+		return sum;
+	});
+
+	const std::string per = " per " + std::to_string(Count) + " " + name;
+	Bench::report("std::array p += (v + a * dt) * dt," + per, plain);
+	Bench::report("Vec operators p += (v + a * dt) * dt," + per, eager);
+	Bench::report("Vec lazy() p += (v + a * dt) * dt," + per, fused);
+	Bench::report("std::array dot," + per, plainDot);
+	Bench::report("Vec dot," + per, dot);
+}
+
+}
+
+int main()
+{
+	run<float, 4>("Vec4f");
+	run<double, 2>("Vec2d");
+	run<double, 3>("Vec3d");
+	run<double, 4>("Vec4d");
+	return 0;
+}
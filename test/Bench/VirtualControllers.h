@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "ReSDL/ReSDL.h"
+
+namespace Bench {
+
+// Game controllers backed by SDL virtual joysticks, so the input benches read real device state
+// through SDL without hardware attached. SDL has to be initialized with SDL_INIT_GAMECONTROLLER.
+// Every step moves all axes and buttons along a fixed script that crosses the dead zones; rewind
+// starts the script over, so two pipelines can be fed the same input.
+class VirtualControllers
+{
+public:
+	explicit VirtualControllers(size_t count)
+	{
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+		// the pipelines poll, queueing an event for every change would only add to the step
+		SDL_JoystickEventState(SDL_IGNORE);
+		SDL_GameControllerEventState(SDL_IGNORE);
+		for(size_t i = 0; i < count; ++i) {
+			const int index = SDL_JoystickAttachVirtual(SDL_JOYSTICK_TYPE_GAMECONTROLLER, SDL_CONTROLLER_AXIS_MAX, SDL_CONTROLLER_BUTTON_MAX, 0);
+			if(index < 0) {
+				m_error = SDL_GetError();
+				m_controllers.clear();
+				return;
+			}
+			// axes and buttons in SDL's own order, whatever mapping SDL would guess otherwise
+			char guid[33];
+			SDL_JoystickGetGUIDString(SDL_JoystickGetDeviceGUID(index), guid, sizeof(guid));
+			std::string mapping = std::string(guid) + ",Bench Controller,";
+			for(int a = 0; a < SDL_CONTROLLER_AXIS_MAX; ++a) {
+				mapping += std::string(SDL_GameControllerGetStringForAxis(static_cast<SDL_GameControllerAxis>(a))) + ":a" + std::to_string(a) + ",";
+			}
+			for(int b = 0; b < SDL_CONTROLLER_BUTTON_MAX; ++b) {
+				mapping += std::string(SDL_GameControllerGetStringForButton(static_cast<SDL_GameControllerButton>(b))) + ":b" + std::to_string(b) + ",";
+			}
+			SDL_GameControllerAddMapping(mapping.c_str());
+			auto controller = std::make_shared<ReSDL::GameController>(index);
+			if(!controller->handle) {
+				m_error = SDL_GetError();
+				m_controllers.clear();
+				return;
+			}
+			m_controllers.push_back(controller);
+		}
+#else
+		(void)count;
+		m_error = "virtual joysticks need SDL 2.0.14";
+#endif
+	}
+
+	bool available() const
+	{
+		return !m_controllers.empty();
+	}
+
+	// why there are no controllers
+	const std::string& error() const
+	{
+		return m_error;
+	}
+
+	const std::vector<std::shared_ptr<ReSDL::GameController>>& controllers() const
+	{
+		return m_controllers;
+	}
+
+	void rewind()
+	{
+		m_frame = 0;
+	}
+
+	// sets the next frame of the script and lets SDL pick it up
+	void step()
+	{
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+		for(size_t c = 0; c < m_controllers.size(); ++c) {
+			SDL_Joystick* joystick = SDL_GameControllerGetJoystick(m_controllers[c]->handle.get());
+			for(int a = 0; a < SDL_CONTROLLER_AXIS_MAX; ++a) {
+				// a triangle from -32767 to 32767 over 64 frames, shifted per axis and controller
+				const int t = static_cast<int>((m_frame + 7 * a + 13 * c) % 64);
+				const int value = (t < 32 ? t : 64 - t) * 2048 - 32767;
+				SDL_JoystickSetVirtualAxis(joystick, a, static_cast<Sint16>(value));
+			}
+			for(int b = 0; b < SDL_CONTROLLER_BUTTON_MAX; ++b) {
+				// each button held for a while and released for a while, at its own period
+				const size_t period = 4 + b + c;
+				SDL_JoystickSetVirtualButton(joystick, b, (m_frame / period) % 2 ? SDL_PRESSED : SDL_RELEASED);
+			}
+		}
+		SDL_JoystickUpdate();
+#endif
+		++m_frame;
+	}
+
+private:
+	std::vector<std::shared_ptr<ReSDL::GameController>> m_controllers;
+	std::string m_error;
+	size_t m_frame = 0;
+};
+
+}
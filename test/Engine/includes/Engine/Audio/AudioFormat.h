@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ReSDL/ReSDL.h"
+
+namespace Engine {
+namespace Audio {
+
+// The format a device actually runs at. Take it from the obtained spec of AudioDevice::open,
+// SDL may have changed any part of the desired one.
+struct AudioFormat
+{
+	int sampleRate = 48000;
+	int channels = 2;
+	SDL_AudioFormat format = AUDIO_F32SYS;
+	// frames per callback
+	int blockFrames = 256;
+
+	static AudioFormat fromSpec(const SDL_AudioSpec& spec)
+	{
+		return { spec.freq, spec.channels, spec.format, spec.samples };
+	}
+
+	int bytesPerSample() const
+	{
+		return SDL_AUDIO_BITSIZE(format) / 8;
+	}
+
+	int bytesPerFrame() const
+	{
+		return bytesPerSample() * channels;
+	}
+
+	bool isFloat() const
+	{
+		return SDL_AUDIO_ISFLOAT(format) != 0;
+	}
+
+	// seconds of audio per callback
+	double blockDuration() const
+	{
+		return static_cast<double>(blockFrames) / sampleRate;
+	}
+};
+
+}
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+
+#include "Engine/Concurrency/SpscRingBuffer.h"
+#include "Engine/Audio/Mixer.h"
+#include "Engine/Audio/WaveFile.h"
+
+namespace Engine {
+namespace Audio {
+
+// Plays a memory mapped wave file through the mixer with constant memory. Samples are converted
+// into a fixed size ring ahead of the audio thread, either by a StreamRefiller thread or by the
+// audio callback itself, and pages behind the read position are handed back to the OS. The file
+// should have the mixer's sample rate. A stream is one voice at a time and has to outlive it.
+class AudioStream : public IVoiceSource
+{
+public:
+	enum class RefillMode { Background, Callback };
+
+	// ringFrames bounds the memory, refill starts once fewer than refillThreshold frames are queued
+	explicit AudioStream(std::shared_ptr<const WaveFile> file, size_t ringFrames = 16384, size_t refillThreshold = 0)
+	: m_file(std::move(file))
+	, m_ring(ringFrames * 2)
+	, m_decode(DecodeFrames * 2)
+	, m_refillThreshold(refillThreshold ? refillThreshold : m_ring.capacity() / 4)
+	, m_loopEnd(m_file->frames())
+	{
+		m_file->file().adviseSequential();
+	}
+
+	// the loop range is played seamlessly, loopEnd 0 means the end of the file; set before playing
+	void setLoop(bool loop, size_t loopStart = 0, size_t loopEnd = 0)
+	{
+		m_loop = loop;
+		m_loopEnd = loopEnd ? std::min(loopEnd, m_file->frames()) : m_file->frames();
+		m_loopStart = std::min(loopStart, m_loopEnd);
+	}
+
+	void setRefillMode(RefillMode mode)
+	{
+		m_mode = mode;
+	}
+
+	RefillMode refillMode() const
+	{
+		return m_mode;
+	}
+
+	// Fills the whole ring, so the first callback after play has data without waiting for a refill.
+	// Call it before the stream is given to a refiller or played, there can only be one producer.
+	void prefetch()
+	{
+		refill();
+	}
+
+	bool needsRefill() const
+	{
+		return !m_sourceDone.load(std::memory_order_relaxed) && m_ring.size() / 2 < m_refillThreshold;
+	}
+
+	// Producer side: converts frames from the file into the ring until it is full or the file ends.
+	// Returns the number of frames added.
+	size_t refill()
+	{
+		size_t added = 0;
+		for(;;) {
+			const size_t free = (m_ring.capacity() - m_ring.size()) / 2;
+			if(free == 0 || m_sourceDone.load(std::memory_order_relaxed)) {
+				break;
+			}
+			if(m_position >= m_loopEnd) {
+				if(!m_loop || m_loopStart == m_loopEnd) {
+					m_sourceDone.store(true, std::memory_order_release);
+					break;
+				}
+				releaseBehind();
+				m_position = m_loopStart;
+				m_released = m_loopStart;
+			}
+			const size_t count = std::min({ free, static_cast<size_t>(DecodeFrames), m_loopEnd - m_position });
+			m_file->readStereo(m_position, count, m_decode.data());
+			m_ring.push(m_decode.data(), count * 2);
+			m_position += count;
+			added += count;
+		}
+		adviseAround(added);
+		return added;
+	}
+
+	// the file ended and everything was played
+	bool finished() const
+	{
+		return m_sourceDone.load(std::memory_order_acquire) && m_ring.empty();
+	}
+
+	// callbacks that found the ring empty before the file ended
+	size_t underruns() const
+	{
+		return m_underruns.load(std::memory_order_relaxed);
+	}
+
+	size_t render(float* stereo, size_t frames) override
+	{
+		if(m_mode == RefillMode::Callback && needsRefill()) {
+			refill();
+		}
+		// check for the end before popping, so frames pushed in between are not mistaken for the end
+		const bool sourceDone = m_sourceDone.load(std::memory_order_acquire);
+		const size_t got = m_ring.pop(stereo, frames * 2) / 2;
+		if(got == frames || sourceDone) {
+			return got;
+		}
+		std::fill(stereo + got * 2, stereo + frames * 2, 0.0f);
+		m_underruns.fetch_add(1, std::memory_order_relaxed);
+		return frames;
+	}
+
+private:
+	static constexpr size_t DecodeFrames = 1024;
+
+	// Reads ahead of the converted range and drops the pages that are already converted into the
+	// ring. The system calls only happen about twice per ring, so this is cheap enough for the
+	// callback refill mode as well.
+	void adviseAround(size_t added)
+	{
+		m_sinceAdvice += added;
+		const size_t ringFrames = m_ring.capacity() / 2;
+		if(m_sinceAdvice < ringFrames / 2) {
+			return;
+		}
+		m_sinceAdvice = 0;
+		const size_t ahead = std::min(m_position + ringFrames, m_loopEnd);
+		m_file->file().prefetch(m_file->fileOffset(m_position), m_file->fileOffset(ahead) - m_file->fileOffset(m_position));
+		releaseBehind();
+	}
+
+	void releaseBehind()
+	{
+		if(m_position > m_released) {
+			m_file->file().release(m_file->fileOffset(m_released), m_file->fileOffset(m_position) - m_file->fileOffset(m_released));
+			m_released = m_position;
+		}
+	}
+
+	std::shared_ptr<const WaveFile> m_file;
+	Concurrency::SpscRingBuffer<float> m_ring;
+	std::vector<float> m_decode;
+	const size_t m_refillThreshold;
+	RefillMode m_mode = RefillMode::Background;
+
+	// producer side
+	size_t m_position = 0;
+	size_t m_loopStart = 0;
+	size_t m_loopEnd;
+	bool m_loop = false;
+	size_t m_sinceAdvice = 0;
+	size_t m_released = 0;
+
+	std::atomic<bool> m_sourceDone{ false };
+	std::atomic<size_t> m_underruns{ 0 };
+};
+
+// Keeps background refilled streams topped up from one thread. The audio thread never waits for
+// it: the thread simply checks all streams a few times per ring's worth of audio.
+class StreamRefiller
+{
+public:
+	explicit StreamRefiller(std::chrono::milliseconds period = std::chrono::milliseconds(5))
+	: m_period(period)
+	{
+	}
+
+	StreamRefiller(const StreamRefiller&) = delete;
+	StreamRefiller& operator=(const StreamRefiller&) = delete;
+
+	~StreamRefiller()
+	{
+		stop();
+	}
+
+	void add(std::shared_ptr<AudioStream> stream)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_streams.push_back(std::move(stream));
+	}
+
+	void remove(const AudioStream* stream)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_streams.erase(std::remove_if(m_streams.begin(), m_streams.end(), [stream](const std::shared_ptr<AudioStream>& entry) { return entry.get() == stream; }), m_streams.end());
+	}
+
+	void start()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_running) {
+			return;
+		}
+		m_running = true;
+		m_thread = std::thread([this] { run(); });
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(!m_running) {
+				return;
+			}
+			m_running = false;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+
+	// refill now instead of at the next period, e.g. right after a stream was added
+	void notify()
+	{
+		m_wake.notify_one();
+	}
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while(m_running) {
+			for(auto& stream : m_streams) {
+				if(stream->refillMode() == AudioStream::RefillMode::Background && stream->needsRefill()) {
+					stream->refill();
+				}
+			}
+			m_wake.wait_for(lock, m_period);
+		}
+	}
+
+	std::vector<std::shared_ptr<AudioStream>> m_streams;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::thread m_thread;
+	std::chrono::milliseconds m_period;
+	bool m_running = false;
+};
+
+}
+}
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <cmath>
+#include <algorithm>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Concurrency/SpscRingBuffer.h"
+#include "Engine/Audio/AudioFormat.h"
+#include "Engine/Audio/WaveFile.h"
+#include "Engine/Audio/Fft.h"
+
+namespace Engine {
+namespace Audio {
+
+// Collects input from an SDL capture device as mono float in a lock-free ring. Open the device
+// as AUDIO_F32SYS with callback and this as userdata; any number of channels is mixed down. The
+// callback never allocates or locks, samples that do not fit into the ring are dropped.
+class AudioCapture
+{
+public:
+	explicit AudioCapture(size_t capacity = 1 << 16)
+	: m_ring(capacity)
+	{
+	}
+
+	AudioCapture(const AudioCapture&) = delete;
+	AudioCapture& operator=(const AudioCapture&) = delete;
+
+	// the obtained format, set it before the device or a feeder starts writing
+	void setFormat(const AudioFormat& format)
+	{
+		m_format = format;
+	}
+
+	const AudioFormat& format() const
+	{
+		return m_format;
+	}
+
+	// SDL_AudioCallback for a capture device, userdata is the capture
+	static void SDLCALL callback(void* userdata, Uint8* stream, int length)
+	{
+		auto* capture = static_cast<AudioCapture*>(userdata);
+		const int channels = capture->m_format.channels;
+		const float* samples = reinterpret_cast<const float*>(stream);
+		size_t frames = static_cast<size_t>(length) / (sizeof(float) * channels);
+		std::array<float, 256> mono;
+		while(frames > 0) {
+			const size_t count = std::min(frames, mono.size());
+			for(size_t i = 0; i < count; ++i) {
+				float sum = 0.0f;
+				for(int c = 0; c < channels; ++c) {
+					sum += samples[i * channels + c];
+				}
+				mono[i] = sum / channels;
+			}
+			capture->write(mono.data(), count);
+			samples += count * channels;
+			frames -= count;
+		}
+	}
+
+	// producer side, the device callback or one other thread, e.g. a CaptureFileFeeder
+	size_t write(const float* mono, size_t count)
+	{
+		const size_t written = m_ring.push(mono, count);
+		if(written < count) {
+			m_dropped.fetch_add(count - written, std::memory_order_relaxed);
+		}
+		return written;
+	}
+
+	// consumer side
+	size_t read(float* mono, size_t count)
+	{
+		return m_ring.pop(mono, count);
+	}
+
+	size_t available() const
+	{
+		return m_ring.size();
+	}
+
+	// samples lost because the consumer fell behind
+	size_t dropped() const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	Concurrency::SpscRingBuffer<float> m_ring;
+	std::atomic<size_t> m_dropped{ 0 };
+	AudioFormat m_format{ 48000, 1, AUDIO_F32SYS, 256 };
+};
+
+// Writes a wave file into an AudioCapture at the pace a microphone would, for testing the
+// analysis without a capture device.
+class CaptureFileFeeder
+{
+public:
+	CaptureFileFeeder(AudioCapture& capture, std::shared_ptr<const WaveFile> file, bool loop = true)
+	: m_capture(capture)
+	, m_file(std::move(file))
+	, m_loop(loop)
+	{
+		m_capture.setFormat(AudioFormat{ static_cast<int>(m_file->sampleRate()), 1, AUDIO_F32SYS, 256 });
+	}
+
+	CaptureFileFeeder(const CaptureFileFeeder&) = delete;
+	CaptureFileFeeder& operator=(const CaptureFileFeeder&) = delete;
+
+	~CaptureFileFeeder()
+	{
+		stop();
+	}
+
+	void start()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_running) {
+			return;
+		}
+		m_running = true;
+		m_thread = std::thread([this] { run(); });
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(!m_running) {
+				return;
+			}
+			m_running = false;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+
+	bool finished() const
+	{
+		return m_finished.load(std::memory_order_acquire);
+	}
+
+private:
+	void run()
+	{
+		const auto startedAt = std::chrono::steady_clock::now();
+		const double rate = m_file->sampleRate();
+		size_t written = 0;
+		size_t position = 0;
+		std::array<float, 512> stereo;
+		std::array<float, 256> mono;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while(m_running && !m_finished.load(std::memory_order_relaxed)) {
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startedAt;
+			size_t due = static_cast<size_t>(elapsed.count() * rate) - written;
+			while(due > 0) {
+				if(position == m_file->frames()) {
+					// an empty file would never get past this, looping or not
+					if(!m_loop || m_file->frames() == 0) {
+						m_finished.store(true, std::memory_order_release);
+						break;
+					}
+					position = 0;
+				}
+				const size_t count = std::min({ due, mono.size(), m_file->frames() - position });
+				m_file->readStereo(position, count, stereo.data());
+				for(size_t i = 0; i < count; ++i) {
+					mono[i] = 0.5f * (stereo[2 * i] + stereo[2 * i + 1]);
+				}
+				m_capture.write(mono.data(), count);
+				position += count;
+				written += count;
+				due -= count;
+			}
+			m_wake.wait_for(lock, std::chrono::milliseconds(5));
+		}
+	}
+
+	AudioCapture& m_capture;
+	std::shared_ptr<const WaveFile> m_file;
+	const bool m_loop;
+	std::atomic<bool> m_finished{ false };
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::thread m_thread;
+	bool m_running = false;
+};
+
+// what the analysis found in the latest window of input
+struct CaptureFeatures
+{
+	static constexpr size_t Bands = 8;
+
+	// analysis windows so far, one per hop
+	Uint64 frame = 0;
+	// RMS level of the window in dBFS
+	float level = -120.0f;
+	// RMS level per octave band in dBFS, the first one from 62.5 Hz to 125 Hz
+	std::array<float, Bands> bands{};
+	// voice activity from the speech band's level above the tracked noise floor
+	bool voice = false;
+	// fundamental frequency in Hz, 0 when the window has no clear one
+	float pitch = 0.0f;
+	// 0 to 1, how periodic the window is at that pitch
+	float clarity = 0.0f;
+};
+
+// Analyses an AudioCapture on a worker thread: every hop samples it takes the last fftSize,
+// computes the Hann windowed spectrum and its octave band levels, detects voice activity and
+// estimates the pitch with the normalized square difference function (McLeod and Wyvill), using
+// the FFT for the autocorrelation. The game thread polls the results; it never waits for them.
+class CaptureAnalyzer
+{
+public:
+	CaptureAnalyzer(AudioCapture& capture, size_t fftSize = 2048, size_t hop = 256, size_t resultCapacity = 64)
+	: m_capture(capture)
+	, m_size(fftSize)
+	, m_hop(hop)
+	, m_spectrum(fftSize)
+	, m_autocorrelation(fftSize * 2)
+	, m_results(resultCapacity)
+	, m_history(fftSize, 0.0f)
+	, m_window(fftSize)
+	, m_re(fftSize * 2)
+	, m_im(fftSize * 2)
+	, m_nsdf(fftSize / 2)
+	{
+		const double pi = std::acos(-1.0);
+		m_windowPower = 0.0;
+		for(size_t i = 0; i < fftSize; ++i) {
+			m_window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / fftSize));
+			m_windowPower += m_window[i] * m_window[i];
+		}
+	}
+
+	CaptureAnalyzer(const CaptureAnalyzer&) = delete;
+	CaptureAnalyzer& operator=(const CaptureAnalyzer&) = delete;
+
+	~CaptureAnalyzer()
+	{
+		stop();
+	}
+
+	// dB the speech band has to be above the noise floor to count as voice
+	void setVoiceThreshold(float decibels)
+	{
+		m_voiceThreshold = decibels;
+	}
+
+	// analyses on a worker thread until stop
+	void start()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_running) {
+			return;
+		}
+		m_running = true;
+		m_thread = std::thread([this] { run(); });
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(!m_running) {
+				return;
+			}
+			m_running = false;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+
+	// game thread: takes all new results and keeps the latest, false if there were none
+	bool poll(CaptureFeatures& latest)
+	{
+		bool any = false;
+		while(m_results.tryPop(latest)) {
+			any = true;
+		}
+		return any;
+	}
+
+	// Analyses all complete hops the capture holds on the calling thread, instead of start.
+	// Returns the number of windows analysed.
+	size_t analyze()
+	{
+		size_t windows = 0;
+		while(m_capture.available() >= m_hop) {
+			std::copy(m_history.begin() + m_hop, m_history.end(), m_history.begin());
+			m_capture.read(&m_history[m_size - m_hop], m_hop);
+			const CaptureFeatures features = analyzeWindow();
+			m_results.tryPush(features);
+			++windows;
+		}
+		return windows;
+	}
+
+private:
+	void run()
+	{
+		const auto period = std::chrono::microseconds(static_cast<long long>(500000.0 * m_hop / m_capture.format().sampleRate));
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while(m_running) {
+			analyze();
+			m_wake.wait_for(lock, period);
+		}
+	}
+
+	static float decibels(double power)
+	{
+		return static_cast<float>(10.0 * std::log10(power + 1e-12));
+	}
+
+	CaptureFeatures analyzeWindow()
+	{
+		const double rate = m_capture.format().sampleRate;
+		CaptureFeatures features;
+		features.frame = ++m_frame;
+
+		double energy = 0.0;
+		for(size_t i = 0; i < m_size; ++i) {
+			energy += m_history[i] * m_history[i];
+		}
+		features.level = decibels(energy / m_size);
+
+		// spectrum, scaled so a band holding a sine reads its RMS level
+		for(size_t i = 0; i < m_size; ++i) {
+			m_re[i] = m_history[i] * m_window[i];
+		}
+		std::fill(m_im.begin(), m_im.begin() + m_size, 0.0f);
+		m_spectrum.forward(m_re.data(), m_im.data());
+		const double scale = 2.0 / (m_size * m_windowPower);
+		const double binWidth = rate / m_size;
+		auto bandPower = [&](double low, double high) {
+			const size_t first = std::max<size_t>(1, static_cast<size_t>(std::ceil(low / binWidth)));
+			const size_t last = std::min(m_size / 2 + 1, static_cast<size_t>(std::ceil(high / binWidth)));
+			double power = 0.0;
+			for(size_t k = first; k < last; ++k) {
+				power += m_re[k] * m_re[k] + m_im[k] * m_im[k];
+			}
+			return power * scale;
+		};
+		for(size_t b = 0; b < CaptureFeatures::Bands; ++b) {
+			const double low = 62.5 * (1 << b);
+			features.bands[b] = decibels(bandPower(low, 2.0 * low));
+		}
+
+		// the noise floor drops right away and creeps up slowly, so speech does not raise it
+		const float speech = decibels(bandPower(300.0, 3400.0));
+		m_noiseFloor = std::min(speech, m_noiseFloor + 0.02f);
+		if(speech > m_noiseFloor + m_voiceThreshold && speech > -60.0f) {
+			m_hangover = 8;
+		}
+		features.voice = m_hangover > 0;
+		if(m_hangover > 0) {
+			--m_hangover;
+		}
+
+		estimatePitch(features, rate);
+		return features;
+	}
+
+	void estimatePitch(CaptureFeatures& features, double rate)
+	{
+		// linear autocorrelation from the zero padded power spectrum
+		const size_t padded = m_size * 2;
+		std::copy(m_history.begin(), m_history.end(), m_re.begin());
+		std::fill(m_re.begin() + m_size, m_re.end(), 0.0f);
+		std::fill(m_im.begin(), m_im.end(), 0.0f);
+		m_autocorrelation.forward(m_re.data(), m_im.data());
+		for(size_t k = 0; k < padded; ++k) {
+			m_re[k] = m_re[k] * m_re[k] + m_im[k] * m_im[k];
+			m_im[k] = 0.0f;
+		}
+		m_autocorrelation.inverse(m_re.data(), m_im.data());
+
+		// normalized square difference, 1 where the signal repeats exactly
+		const size_t maxLag = std::min(m_size / 2, static_cast<size_t>(rate / 50.0));
+		const size_t minLag = static_cast<size_t>(rate / 1200.0);
+		double m = 2.0 * m_re[0];
+		for(size_t lag = 0; lag < maxLag; ++lag) {
+			m_nsdf[lag] = m > 0.0 ? static_cast<float>(2.0 * m_re[lag] / m) : 0.0f;
+			m -= m_history[lag] * m_history[lag] + m_history[m_size - 1 - lag] * m_history[m_size - 1 - lag];
+		}
+
+		// the first peak after a negative zero crossing that gets close to the highest one
+		size_t best = 0;
+		float highest = 0.0f;
+		size_t peaks[32];
+		size_t peakCount = 0;
+		size_t lag = 0;
+		while(lag < maxLag && m_nsdf[lag] > 0.0f) {
+			++lag;
+		}
+		while(lag < maxLag && peakCount < 32) {
+			while(lag < maxLag && m_nsdf[lag] <= 0.0f) {
+				++lag;
+			}
+			size_t peak = lag;
+			while(lag < maxLag && m_nsdf[lag] > 0.0f) {
+				if(m_nsdf[lag] > m_nsdf[peak]) {
+					peak = lag;
+				}
+				++lag;
+			}
+			// a peak cut off by maxLag is not a peak
+			if(lag < maxLag && peak >= minLag) {
+				peaks[peakCount++] = peak;
+				highest = std::max(highest, m_nsdf[peak]);
+			}
+		}
+		for(size_t i = 0; i < peakCount; ++i) {
+			if(m_nsdf[peaks[i]] >= 0.9f * highest) {
+				best = peaks[i];
+				break;
+			}
+		}
+		if(best == 0 || highest < 0.5f) {
+			return;
+		}
+
+		// parabola through the peak and its neighbours
+		const float left = m_nsdf[best - 1];
+		const float centre = m_nsdf[best];
+		const float right = m_nsdf[best + 1];
+		const float denominator = left - 2.0f * centre + right;
+		const float offset = denominator != 0.0f ? 0.5f * (left - right) / denominator : 0.0f;
+		features.pitch = static_cast<float>(rate / (best + offset));
+		features.clarity = std::min(centre - 0.25f * (left - right) * offset, 1.0f);
+	}
+
+	AudioCapture& m_capture;
+	const size_t m_size;
+	const size_t m_hop;
+	Fft m_spectrum;
+	Fft m_autocorrelation;
+	Concurrency::SpscRingBuffer<CaptureFeatures> m_results;
+
+	// worker side
+	std::vector<float> m_history;
+	std::vector<float> m_window;
+	std::vector<float> m_re;
+	std::vector<float> m_im;
+	std::vector<float> m_nsdf;
+	double m_windowPower;
+	Uint64 m_frame = 0;
+	float m_noiseFloor = 0.0f;
+	float m_voiceThreshold = 12.0f;
+	int m_hangover = 0;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::thread m_thread;
+	bool m_running = false;
+};
+
+}
+}
@@ -0,0 +1,518 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Concurrency/SpscRingBuffer.h"
+#include "Engine/Audio/Kernels.h"
+#include "Engine/Audio/Resampler.h"
+
+namespace Engine {
+namespace Audio {
+
+// One processing step of a DspGraph, working in place on interleaved stereo float blocks.
+// prepare runs on the game thread before the node is first used and may allocate; process runs
+// on the audio thread and must neither allocate nor lock. Parameters can be set from any thread,
+// nodes pick them up at the start of the next block.
+class DspNode
+{
+public:
+	static constexpr size_t MaxParameters = 8;
+
+	explicit DspNode(std::string name)
+	: m_name(std::move(name))
+	{
+		for(auto& parameter : m_parameters) {
+			parameter.store(0.0f, std::memory_order_relaxed);
+		}
+	}
+
+	virtual ~DspNode() = default;
+
+	DspNode(const DspNode&) = delete;
+	DspNode& operator=(const DspNode&) = delete;
+
+	const std::string& name() const
+	{
+		return m_name;
+	}
+
+	virtual void prepare(int /*sampleRate*/, size_t /*maxBlockFrames*/)
+	{
+	}
+
+	// stereo holds the sum of the node's inputs, silence for nodes without inputs
+	virtual void process(float* stereo, size_t frames) = 0;
+
+	void setParameter(size_t index, float value)
+	{
+		m_parameters[index].store(value, std::memory_order_relaxed);
+	}
+
+	float parameter(size_t index) const
+	{
+		return m_parameters[index].load(std::memory_order_relaxed);
+	}
+
+	// sample rate the node was prepared for, 0 before that
+	int sampleRate() const
+	{
+		return m_sampleRate;
+	}
+
+private:
+	friend class DspGraph;
+
+	void record(Uint64 ticks, size_t frames)
+	{
+		m_ticks.fetch_add(ticks, std::memory_order_relaxed);
+		m_frames.fetch_add(frames, std::memory_order_relaxed);
+		m_blocks.fetch_add(1, std::memory_order_relaxed);
+		if(ticks > m_peakTicks.load(std::memory_order_relaxed)) {
+			m_peakTicks.store(ticks, std::memory_order_relaxed);
+		}
+	}
+
+	std::string m_name;
+	std::array<std::atomic<float>, MaxParameters> m_parameters;
+	int m_sampleRate = 0;
+
+	// performance counter ticks spent in process, written by the audio thread
+	std::atomic<Uint64> m_ticks{ 0 };
+	std::atomic<Uint64> m_peakTicks{ 0 };
+	std::atomic<Uint64> m_frames{ 0 };
+	std::atomic<Uint64> m_blocks{ 0 };
+};
+
+// a node that renders whatever a RenderFunc produces, e.g. the mixer
+class RenderNode : public DspNode
+{
+public:
+	RenderNode(std::string name, RenderFunc render, void* userdata)
+	: DspNode(std::move(name))
+	, m_render(render)
+	, m_userdata(userdata)
+	{
+	}
+
+	void process(float* stereo, size_t frames) override
+	{
+		m_render(m_userdata, stereo, frames);
+	}
+
+private:
+	RenderFunc m_render;
+	void* m_userdata;
+};
+
+// identifies a node in one DspGraph, 0 is never a valid node
+using NodeId = Uint32;
+
+// CPU time a node spent on the audio thread since the last resetStats
+struct DspNodeStats
+{
+	NodeId id = 0;
+	std::string name;
+	Uint64 blocks = 0;
+	double averageMicroseconds = 0.0;
+	double peakMicroseconds = 0.0;
+	// fraction of real time, 0.01 means the node takes 1% of the audio it produces
+	double load = 0.0;
+};
+
+// Nodes connected into buses and effect chains, e.g. mixer -> reverb -> master. Every input of a
+// node is summed into its block before it runs. The game thread edits the graph and publishes it;
+// publishing compiles the nodes that reach the output into a flat list of steps with
+// preallocated buffers, and the audio thread switches to the new program at its next block
+// through an atomic pointer. Retired programs come back through a queue and are freed on the game
+// thread, so the audio thread never allocates, frees or locks. Only one thread may edit the graph.
+class DspGraph
+{
+public:
+	explicit DspGraph(size_t maxBlockFrames = 1024, int sampleRate = 48000)
+	: m_maxBlockFrames(maxBlockFrames)
+	, m_sampleRate(sampleRate)
+	, m_frequency(static_cast<double>(SDL_GetPerformanceFrequency()))
+	, m_retired(16)
+	{
+	}
+
+	DspGraph(const DspGraph&) = delete;
+	DspGraph& operator=(const DspGraph&) = delete;
+
+	// the audio thread must not run any more
+	~DspGraph()
+	{
+		collect();
+		delete m_pending.exchange(nullptr);
+		delete m_current;
+	}
+
+	int sampleRate() const
+	{
+		return m_sampleRate;
+	}
+
+	// only before the first publish, nodes are prepared for the rate they are first published at
+	void setSampleRate(int sampleRate)
+	{
+		if(m_published && sampleRate != m_sampleRate) {
+			throw std::logic_error("DspGraph: the sample rate cannot change after publishing");
+		}
+		m_sampleRate = sampleRate;
+	}
+
+	NodeId add(std::shared_ptr<DspNode> node)
+	{
+		m_nodes.push_back(std::move(node));
+		return static_cast<NodeId>(m_nodes.size());
+	}
+
+	// disconnects and drops the node, it is destroyed on this thread once no program uses it
+	void remove(NodeId id)
+	{
+		if(!node(id)) {
+			return;
+		}
+		m_nodes[id - 1].reset();
+		m_edges.erase(std::remove_if(m_edges.begin(), m_edges.end(), [id](const Edge& edge) {
+			return edge.first == id || edge.second == id;
+		}), m_edges.end());
+		if(m_output == id) {
+			m_output = 0;
+		}
+	}
+
+	DspNode* node(NodeId id) const
+	{
+		return id > 0 && id <= m_nodes.size() ? m_nodes[id - 1].get() : nullptr;
+	}
+
+	template<typename T>
+	T* node(NodeId id) const
+	{
+		return dynamic_cast<T*>(node(id));
+	}
+
+	// feeds from into to, returns false for unknown nodes or if it would close a cycle
+	bool connect(NodeId from, NodeId to)
+	{
+		if(!node(from) || !node(to) || from == to || reaches(to, from)) {
+			return false;
+		}
+		if(std::find(m_edges.begin(), m_edges.end(), Edge{ from, to }) == m_edges.end()) {
+			m_edges.emplace_back(from, to);
+		}
+		return true;
+	}
+
+	void disconnect(NodeId from, NodeId to)
+	{
+		m_edges.erase(std::remove(m_edges.begin(), m_edges.end(), Edge{ from, to }), m_edges.end());
+	}
+
+	// the node whose block is the graph's output
+	void setOutput(NodeId id)
+	{
+		m_output = node(id) ? id : 0;
+	}
+
+	NodeId output() const
+	{
+		return m_output;
+	}
+
+	// Compiles the graph and hands it to the audio thread, which starts using it with its next block.
+	// Nodes that do not reach the output are left out.
+	void publish()
+	{
+		collect();
+		Program* program = compile();
+		m_published = true;
+		m_order = program->ids;
+		// a program the audio thread never picked up can go right away
+		delete m_pending.exchange(program, std::memory_order_acq_rel);
+	}
+
+	// frees programs the audio thread is done with, publish does that as well
+	void collect()
+	{
+		Program* program;
+		while(m_retired.tryPop(program)) {
+			delete program;
+		}
+	}
+
+	// the published nodes in execution order
+	const std::vector<NodeId>& order() const
+	{
+		return m_order;
+	}
+
+	// timing of the published nodes in execution order
+	std::vector<DspNodeStats> stats() const
+	{
+		std::vector<DspNodeStats> result;
+		for(NodeId id : m_order) {
+			const DspNode* current = node(id);
+			if(!current) {
+				continue;
+			}
+			DspNodeStats stats;
+			stats.id = id;
+			stats.name = current->name();
+			stats.blocks = current->m_blocks.load(std::memory_order_relaxed);
+			const Uint64 ticks = current->m_ticks.load(std::memory_order_relaxed);
+			const Uint64 frames = current->m_frames.load(std::memory_order_relaxed);
+			if(stats.blocks > 0) {
+				stats.averageMicroseconds = 1e6 * ticks / m_frequency / stats.blocks;
+				stats.peakMicroseconds = 1e6 * current->m_peakTicks.load(std::memory_order_relaxed) / m_frequency;
+			}
+			if(frames > 0) {
+				stats.load = ticks / m_frequency * m_sampleRate / frames;
+			}
+			result.push_back(std::move(stats));
+		}
+		return result;
+	}
+
+	// sum of the loads of all published nodes
+	double load() const
+	{
+		double total = 0.0;
+		for(const auto& stats : stats()) {
+			total += stats.load;
+		}
+		return total;
+	}
+
+	void resetStats()
+	{
+		for(const auto& current : m_nodes) {
+			if(current) {
+				current->m_ticks.store(0, std::memory_order_relaxed);
+				current->m_peakTicks.store(0, std::memory_order_relaxed);
+				current->m_frames.store(0, std::memory_order_relaxed);
+				current->m_blocks.store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// audio thread: writes frames interleaved stereo frames of the output node, clipped to [-1, 1]
+	void render(float* out, size_t frames)
+	{
+		// decaying feedback lines would otherwise end up in slow denormal arithmetic
+		kernels::FlushDenormals flush;
+		acquire();
+		while(frames > 0) {
+			const size_t block = std::min(frames, m_maxBlockFrames);
+			renderBlock(out, block);
+			out += block * 2;
+			frames -= block;
+		}
+	}
+
+	// RenderFunc, userdata is the graph
+	static void pull(void* userdata, float* stereo, size_t frames)
+	{
+		static_cast<DspGraph*>(userdata)->render(stereo, frames);
+	}
+
+private:
+	using Edge = std::pair<NodeId, NodeId>;
+
+	struct Step
+	{
+		DspNode* node;
+		float* buffer;
+		Uint32 firstInput;
+		Uint32 inputCount;
+		// the buffer already holds the only input, nothing to sum
+		bool inPlace;
+	};
+
+	struct Program
+	{
+		// keeps the nodes alive while the audio thread may still run them
+		std::vector<std::shared_ptr<DspNode>> nodes;
+		std::vector<NodeId> ids;
+		std::vector<Step> steps;
+		std::vector<const float*> inputs;
+		std::vector<float> buffers;
+		const float* output = nullptr;
+	};
+
+	// is there a path from one node to the other
+	bool reaches(NodeId from, NodeId to) const
+	{
+		std::vector<NodeId> open{ from };
+		std::vector<bool> seen(m_nodes.size() + 1, false);
+		while(!open.empty()) {
+			const NodeId id = open.back();
+			open.pop_back();
+			if(id == to) {
+				return true;
+			}
+			if(seen[id]) {
+				continue;
+			}
+			seen[id] = true;
+			for(const Edge& edge : m_edges) {
+				if(edge.first == id) {
+					open.push_back(edge.second);
+				}
+			}
+		}
+		return false;
+	}
+
+	Program* compile()
+	{
+		std::unique_ptr<Program> program(new Program);
+		if(!m_output) {
+			return program.release();
+		}
+
+		// depth first from the output along the inputs, post order puts every node after its inputs
+		std::vector<Uint8> state(m_nodes.size() + 1, 0);
+		std::vector<std::pair<NodeId, size_t>> stack{ { m_output, 0 } };
+		state[m_output] = 1;
+		while(!stack.empty()) {
+			auto& top = stack.back();
+			bool descended = false;
+			for(; top.second < m_edges.size(); ++top.second) {
+				const Edge& edge = m_edges[top.second];
+				if(edge.second == top.first && state[edge.first] == 0) {
+					state[edge.first] = 1;
+					stack.emplace_back(edge.first, 0);
+					descended = true;
+					break;
+				}
+			}
+			if(!descended) {
+				program->ids.push_back(top.first);
+				stack.pop_back();
+			}
+		}
+
+		// a node that is the only input of its only consumer shares that consumer's buffer
+		std::vector<Uint32> consumers(m_nodes.size() + 1, 0);
+		std::vector<Uint32> step(m_nodes.size() + 1, 0);
+		for(size_t i = 0; i < program->ids.size(); ++i) {
+			step[program->ids[i]] = static_cast<Uint32>(i);
+		}
+		for(const Edge& edge : m_edges) {
+			if(state[edge.first] && state[edge.second]) {
+				++consumers[edge.first];
+			}
+		}
+
+		std::vector<size_t> bufferOf(program->ids.size());
+		std::vector<size_t> inputBuffers;
+		size_t buffers = 0;
+		for(size_t i = 0; i < program->ids.size(); ++i) {
+			const NodeId id = program->ids[i];
+			Step current{ node(id), nullptr, static_cast<Uint32>(inputBuffers.size()), 0, false };
+			NodeId only = 0;
+			for(const Edge& edge : m_edges) {
+				if(edge.second == id && state[edge.first]) {
+					inputBuffers.push_back(bufferOf[step[edge.first]]);
+					++current.inputCount;
+					only = edge.first;
+				}
+			}
+			if(current.inputCount == 1 && consumers[only] == 1) {
+				bufferOf[i] = bufferOf[step[only]];
+				current.inPlace = true;
+			}
+			else {
+				bufferOf[i] = buffers++;
+			}
+			program->steps.push_back(current);
+			program->nodes.push_back(m_nodes[id - 1]);
+
+			if(current.node->m_sampleRate == 0) {
+				current.node->prepare(m_sampleRate, m_maxBlockFrames);
+				current.node->m_sampleRate = m_sampleRate;
+			}
+		}
+
+		const size_t stride = m_maxBlockFrames * 2;
+		program->buffers.assign(buffers * stride, 0.0f);
+		for(size_t i = 0; i < program->steps.size(); ++i) {
+			program->steps[i].buffer = program->buffers.data() + bufferOf[i] * stride;
+		}
+		for(size_t index : inputBuffers) {
+			program->inputs.push_back(program->buffers.data() + index * stride);
+		}
+		program->output = program->steps.back().buffer;
+		return program.release();
+	}
+
+	void acquire()
+	{
+		if(!m_pending.load(std::memory_order_relaxed)) {
+			return;
+		}
+		// only switch if the old program can be handed back, only the game thread frees
+		if(m_current && !m_retired.tryPush(m_current)) {
+			return;
+		}
+		m_current = m_pending.exchange(nullptr, std::memory_order_acq_rel);
+	}
+
+	void renderBlock(float* out, size_t frames)
+	{
+		if(!m_current || !m_current->output) {
+			kernels::clear(out, frames * 2);
+			return;
+		}
+		for(const Step& step : m_current->steps) {
+			if(!step.inPlace) {
+				if(step.inputCount == 0) {
+					kernels::clear(step.buffer, frames * 2);
+				}
+				else {
+					const float* const* inputs = &m_current->inputs[step.firstInput];
+					std::copy(inputs[0], inputs[0] + frames * 2, step.buffer);
+					for(Uint32 i = 1; i < step.inputCount; ++i) {
+						kernels::mixStereo(step.buffer, inputs[i], frames, 1.0f, 1.0f, 0.0f, 0.0f);
+					}
+				}
+			}
+			const Uint64 start = SDL_GetPerformanceCounter();
+			step.node->process(step.buffer, frames);
+			step.node->record(SDL_GetPerformanceCounter() - start, frames);
+		}
+		std::copy(m_current->output, m_current->output + frames * 2, out);
+		kernels::scaleAndClip(out, frames * 2, 1.0f);
+	}
+
+	const size_t m_maxBlockFrames;
+	int m_sampleRate;
+	bool m_published = false;
+	const double m_frequency;
+
+	// game thread side
+	std::vector<std::shared_ptr<DspNode>> m_nodes;
+	std::vector<Edge> m_edges;
+	NodeId m_output = 0;
+	std::vector<NodeId> m_order;
+
+	// handed over to the audio thread and back
+	std::atomic<Program*> m_pending{ nullptr };
+	Concurrency::SpscRingBuffer<Program*> m_retired;
+
+	// audio thread side
+	Program* m_current = nullptr;
+};
+
+}
+}
@@ -0,0 +1,439 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+
+#include "Engine/Audio/DspGraph.h"
+
+namespace Engine {
+namespace Audio {
+
+inline float decibelsToGain(float decibels)
+{
+	return std::pow(10.0f, decibels / 20.0f);
+}
+
+// Scales by a gain that ramps over a block when it changes. Without a gain it is a plain bus
+// that sums its inputs.
+class GainNode : public DspNode
+{
+public:
+	explicit GainNode(std::string name = "gain", float gain = 1.0f)
+	: DspNode(std::move(name))
+	, m_current(gain)
+	{
+		setGain(gain);
+	}
+
+	void setGain(float gain)
+	{
+		setParameter(0, gain);
+	}
+
+	void process(float* stereo, size_t frames) override
+	{
+		const float target = parameter(0);
+		if(target == 1.0f && m_current == 1.0f) {
+			return;
+		}
+		const float step = (target - m_current) / frames;
+		float gain = m_current;
+		for(size_t i = 0; i < frames; ++i, gain += step) {
+			stereo[2 * i] *= gain;
+			stereo[2 * i + 1] *= gain;
+		}
+		m_current = target;
+	}
+
+private:
+	float m_current;
+};
+
+// Second order filter with the coefficients of the Audio EQ Cookbook (R. Bristow-Johnson),
+// in transposed direct form II with one state per channel.
+class BiquadNode : public DspNode
+{
+public:
+	enum class Type : Uint8 { LowPass, HighPass, BandPass, Notch, Peak, LowShelf, HighShelf };
+
+	BiquadNode(std::string name, Type type, float frequency, float q = 0.7071f, float gainDb = 0.0f)
+	: DspNode(std::move(name))
+	, m_type(type)
+	{
+		setFrequency(frequency);
+		setQ(q);
+		setGainDb(gainDb);
+	}
+
+	void setFrequency(float frequency)
+	{
+		setParameter(0, frequency);
+	}
+
+	void setQ(float q)
+	{
+		setParameter(1, q);
+	}
+
+	// for Peak and the shelves
+	void setGainDb(float gainDb)
+	{
+		setParameter(2, gainDb);
+	}
+
+	void process(float* stereo, size_t frames) override
+	{
+		update();
+		for(size_t i = 0; i < frames; ++i) {
+			for(int c = 0; c < 2; ++c) {
+				const float x = stereo[2 * i + c];
+				const float y = m_b0 * x + m_z1[c];
+				m_z1[c] = m_b1 * x - m_a1 * y + m_z2[c];
+				m_z2[c] = m_b2 * x - m_a2 * y;
+				stereo[2 * i + c] = y;
+			}
+		}
+	}
+
+private:
+	void update()
+	{
+		const float frequency = parameter(0);
+		const float q = parameter(1);
+		const float gainDb = parameter(2);
+		if(frequency == m_frequency && q == m_q && gainDb == m_gainDb) {
+			return;
+		}
+		m_frequency = frequency;
+		m_q = q;
+		m_gainDb = gainDb;
+
+		const double pi = std::acos(-1.0);
+		const double w = 2.0 * pi * std::min(std::max(static_cast<double>(frequency), 10.0), 0.49 * sampleRate()) / sampleRate();
+		const double cosw = std::cos(w);
+		const double alpha = std::sin(w) / (2.0 * std::max(q, 0.01f));
+		const double a = std::pow(10.0, gainDb / 40.0);
+		const double shelf = 2.0 * std::sqrt(a) * alpha;
+		double b0, b1, b2, a0, a1, a2;
+		switch(m_type) {
+		case Type::LowPass:
+			b0 = b2 = (1.0 - cosw) / 2.0; b1 = 1.0 - cosw;
+			a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha;
+			break;
+		case Type::HighPass:
+			b0 = b2 = (1.0 + cosw) / 2.0; b1 = -(1.0 + cosw);
+			a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha;
+			break;
+		case Type::BandPass:
+			b0 = alpha; b1 = 0.0; b2 = -alpha;
+			a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha;
+			break;
+		case Type::Notch:
+			b0 = b2 = 1.0; b1 = -2.0 * cosw;
+			a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha;
+			break;
+		case Type::Peak:
+			b0 = 1.0 + alpha * a; b1 = -2.0 * cosw; b2 = 1.0 - alpha * a;
+			a0 = 1.0 + alpha / a; a1 = -2.0 * cosw; a2 = 1.0 - alpha / a;
+			break;
+		case Type::LowShelf:
+			b0 = a * ((a + 1.0) - (a - 1.0) * cosw + shelf);
+			b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosw);
+			b2 = a * ((a + 1.0) - (a - 1.0) * cosw - shelf);
+			a0 = (a + 1.0) + (a - 1.0) * cosw + shelf;
+			a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosw);
+			a2 = (a + 1.0) + (a - 1.0) * cosw - shelf;
+			break;
+		case Type::HighShelf:
+		default:
+			b0 = a * ((a + 1.0) + (a - 1.0) * cosw + shelf);
+			b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosw);
+			b2 = a * ((a + 1.0) + (a - 1.0) * cosw - shelf);
+			a0 = (a + 1.0) - (a - 1.0) * cosw + shelf;
+			a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosw);
+			a2 = (a + 1.0) - (a - 1.0) * cosw - shelf;
+			break;
+		}
+		m_b0 = static_cast<float>(b0 / a0);
+		m_b1 = static_cast<float>(b1 / a0);
+		m_b2 = static_cast<float>(b2 / a0);
+		m_a1 = static_cast<float>(a1 / a0);
+		m_a2 = static_cast<float>(a2 / a0);
+	}
+
+	const Type m_type;
+	float m_frequency = -1.0f;
+	float m_q = -1.0f;
+	float m_gainDb = 0.0f;
+	float m_b0 = 1.0f, m_b1 = 0.0f, m_b2 = 0.0f, m_a1 = 0.0f, m_a2 = 0.0f;
+	std::array<float, 2> m_z1{};
+	std::array<float, 2> m_z2{};
+};
+
+// Echo with feedback. The line is allocated for maxSeconds when the node is prepared.
+class DelayNode : public DspNode
+{
+public:
+	DelayNode(std::string name, float maxSeconds, float seconds, float feedback = 0.35f, float mix = 0.3f)
+	: DspNode(std::move(name))
+	, m_maxSeconds(maxSeconds)
+	{
+		setTime(seconds);
+		setFeedback(feedback);
+		setMix(mix);
+	}
+
+	void setTime(float seconds)
+	{
+		setParameter(0, seconds);
+	}
+
+	void setFeedback(float feedback)
+	{
+		setParameter(1, feedback);
+	}
+
+	// 0 is only the input, 1 only the echo
+	void setMix(float mix)
+	{
+		setParameter(2, mix);
+	}
+
+	void prepare(int sampleRate, size_t /*maxBlockFrames*/) override
+	{
+		m_line.assign((static_cast<size_t>(m_maxSeconds * sampleRate) + 1) * 2, 0.0f);
+	}
+
+	void process(float* stereo, size_t frames) override
+	{
+		const size_t length = m_line.size() / 2;
+		const size_t delay = std::min(std::max<size_t>(static_cast<size_t>(parameter(0) * sampleRate()), 1), length - 1);
+		const float feedback = std::min(std::max(parameter(1), 0.0f), 0.98f);
+		const float mix = parameter(2);
+		size_t read = (m_write + length - delay) % length;
+		for(size_t i = 0; i < frames; ++i) {
+			for(int c = 0; c < 2; ++c) {
+				const float in = stereo[2 * i + c];
+				const float echo = m_line[2 * read + c];
+				m_line[2 * m_write + c] = in + echo * feedback;
+				stereo[2 * i + c] = in + (echo - in) * mix;
+			}
+			if(++read == length) {
+				read = 0;
+			}
+			if(++m_write == length) {
+				m_write = 0;
+			}
+		}
+	}
+
+private:
+	const float m_maxSeconds;
+	std::vector<float> m_line;
+	size_t m_write = 0;
+};
+
+// Feed-forward compressor on the louder of both channels, so the stereo image stays put.
+// The gain reduction follows with separate attack and release times.
+class CompressorNode : public DspNode
+{
+public:
+	CompressorNode(std::string name, float thresholdDb = -18.0f, float ratio = 4.0f, float attackMs = 5.0f, float releaseMs = 100.0f, float makeupDb = 0.0f)
+	: DspNode(std::move(name))
+	{
+		setThreshold(thresholdDb);
+		setRatio(ratio);
+		setAttack(attackMs);
+		setRelease(releaseMs);
+		setMakeup(makeupDb);
+	}
+
+	void setThreshold(float decibels)
+	{
+		setParameter(0, decibels);
+	}
+
+	void setRatio(float ratio)
+	{
+		setParameter(1, ratio);
+	}
+
+	void setAttack(float milliseconds)
+	{
+		setParameter(2, milliseconds);
+	}
+
+	void setRelease(float milliseconds)
+	{
+		setParameter(3, milliseconds);
+	}
+
+	void setMakeup(float decibels)
+	{
+		setParameter(4, decibels);
+	}
+
+	// gain reduction at the end of the last block in dB, for meters
+	float gainReduction() const
+	{
+		return m_meter.load(std::memory_order_relaxed);
+	}
+
+	void process(float* stereo, size_t frames) override
+	{
+		const float threshold = parameter(0);
+		const float slope = 1.0f - 1.0f / std::max(parameter(1), 1.0f);
+		const float attack = coefficient(parameter(2));
+		const float release = coefficient(parameter(3));
+		const float makeup = parameter(4);
+		for(size_t i = 0; i < frames; ++i) {
+			const float peak = std::max(std::abs(stereo[2 * i]), std::abs(stereo[2 * i + 1]));
+			const float level = 20.0f * std::log10(peak + 1e-9f);
+			const float target = std::max(level - threshold, 0.0f) * slope;
+			m_reduction += (target - m_reduction) * (target > m_reduction ? attack : release);
+			const float gain = decibelsToGain(makeup - m_reduction);
+			stereo[2 * i] *= gain;
+			stereo[2 * i + 1] *= gain;
+		}
+		m_meter.store(m_reduction, std::memory_order_relaxed);
+	}
+
+private:
+	// one pole smoothing that gets about two thirds of the way in the given time
+	float coefficient(float milliseconds) const
+	{
+		return 1.0f - std::exp(-1000.0f / (std::max(milliseconds, 0.01f) * sampleRate()));
+	}
+
+	float m_reduction = 0.0f;
+	std::atomic<float> m_meter{ 0.0f };
+};
+
+// Schroeder-Moorer reverb after Freeverb (Jezar at Dreampoint): eight damped comb filters in
+// parallel and four allpasses in series per channel, with slightly longer lines on the right.
+class ReverbNode : public DspNode
+{
+public:
+	ReverbNode(std::string name, float roomSize = 0.6f, float damping = 0.4f, float wet = 0.25f, float width = 1.0f)
+	: DspNode(std::move(name))
+	{
+		setRoomSize(roomSize);
+		setDamping(damping);
+		setWet(wet);
+		setWidth(width);
+	}
+
+	// 0 to 1, the decay time
+	void setRoomSize(float roomSize)
+	{
+		setParameter(0, roomSize);
+	}
+
+	// 0 to 1, how fast high frequencies decay
+	void setDamping(float damping)
+	{
+		setParameter(1, damping);
+	}
+
+	// level of the reverb added to the input
+	void setWet(float wet)
+	{
+		setParameter(2, wet);
+	}
+
+	// 0 is mono, 1 full stereo
+	void setWidth(float width)
+	{
+		setParameter(3, width);
+	}
+
+	void prepare(int sampleRate, size_t /*maxBlockFrames*/) override
+	{
+		// the published tunings are in samples at 44.1 kHz
+		static const int combs[Combs] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+		static const int allpasses[Allpasses] = { 556, 441, 341, 225 };
+		const double scale = sampleRate / 44100.0;
+		for(int c = 0; c < 2; ++c) {
+			const int spread = c == 0 ? 0 : 23;
+			for(int i = 0; i < Combs; ++i) {
+				m_combs[c][i].line.assign(static_cast<size_t>((combs[i] + spread) * scale), 0.0f);
+			}
+			for(int i = 0; i < Allpasses; ++i) {
+				m_allpasses[c][i].line.assign(static_cast<size_t>((allpasses[i] + spread) * scale), 0.0f);
+			}
+		}
+	}
+
+	void process(float* stereo, size_t frames) override
+	{
+		const float feedback = 0.7f + 0.28f * std::min(std::max(parameter(0), 0.0f), 1.0f);
+		const float damping = 0.4f * std::min(std::max(parameter(1), 0.0f), 1.0f);
+		const float wet = 3.0f * parameter(2);
+		const float width = parameter(3);
+		const float wet1 = wet * (width / 2.0f + 0.5f);
+		const float wet2 = wet * (1.0f - width) / 2.0f;
+		for(size_t i = 0; i < frames; ++i) {
+			const float input = (stereo[2 * i] + stereo[2 * i + 1]) * 0.015f;
+			float out[2];
+			for(int c = 0; c < 2; ++c) {
+				float sum = 0.0f;
+				for(Comb& comb : m_combs[c]) {
+					sum += comb.process(input, feedback, damping);
+				}
+				for(Allpass& allpass : m_allpasses[c]) {
+					sum = allpass.process(sum);
+				}
+				out[c] = sum;
+			}
+			stereo[2 * i] += out[0] * wet1 + out[1] * wet2;
+			stereo[2 * i + 1] += out[1] * wet1 + out[0] * wet2;
+		}
+	}
+
+private:
+	static constexpr int Combs = 8;
+	static constexpr int Allpasses = 4;
+
+	struct Comb
+	{
+		std::vector<float> line;
+		size_t index = 0;
+		float store = 0.0f;
+
+		float process(float input, float feedback, float damping)
+		{
+			const float output = line[index];
+			store = output * (1.0f - damping) + store * damping;
+			line[index] = input + store * feedback;
+			if(++index == line.size()) {
+				index = 0;
+			}
+			return output;
+		}
+	};
+
+	struct Allpass
+	{
+		std::vector<float> line;
+		size_t index = 0;
+
+		float process(float input)
+		{
+			const float buffered = line[index];
+			line[index] = input + buffered * 0.5f;
+			if(++index == line.size()) {
+				index = 0;
+			}
+			return buffered - input;
+		}
+	};
+
+	std::array<std::array<Comb, Combs>, 2> m_combs;
+	std::array<std::array<Allpass, Allpasses>, 2> m_allpasses;
+};
+
+}
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Engine/Audio/Kernels.h"
+
+#if ENGINE_AUDIO_SSE2
+#include <xmmintrin.h>
+#endif
+
+namespace Engine {
+namespace Audio {
+
+// Complex FFT of a power of two size on split real and imaginary arrays. Stockham autosort
+// radix-4 stages, plus one radix-2 stage for odd powers, so there is no bit reversal pass.
+// The first stage is vectorized across butterflies, all later ones across the contiguous
+// sub-transforms. Twiddles are computed once in the constructor; transforms never allocate.
+class Fft
+{
+public:
+	explicit Fft(size_t size)
+	: m_size(size)
+	, m_workRe(size)
+	, m_workIm(size)
+	{
+		if(size < 2 || (size & (size - 1)) != 0) {
+			throw std::runtime_error("Fft: the size has to be a power of two");
+		}
+		const double pi = std::acos(-1.0);
+		size_t n = size;
+		size_t s = 1;
+		while(n > 1) {
+			Stage stage;
+			stage.n = n;
+			stage.s = s;
+			stage.radix = n >= 4 ? 4 : 2;
+			stage.twiddles = m_twiddles.size();
+			const size_t m = n / stage.radix;
+			const int powers = stage.radix - 1;
+			m_twiddles.resize(m_twiddles.size() + 2 * powers * m);
+			float* twiddles = &m_twiddles[stage.twiddles];
+			for(int k = 1; k <= powers; ++k) {
+				for(size_t p = 0; p < m; ++p) {
+					const double angle = -2.0 * pi * k * p / n;
+					twiddles[(2 * k - 2) * m + p] = static_cast<float>(std::cos(angle));
+					twiddles[(2 * k - 1) * m + p] = static_cast<float>(std::sin(angle));
+				}
+			}
+			m_stages.push_back(stage);
+			n /= stage.radix;
+			s *= stage.radix;
+		}
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	// in place and unscaled
+	void forward(float* re, float* im)
+	{
+		transform(re, im);
+	}
+
+	// in place and scaled by 1 / size, so forward followed by inverse gives back the input
+	void inverse(float* re, float* im)
+	{
+		// swapping real and imaginary parts turns the forward transform into the inverse one
+		transform(im, re);
+		const float scale = 1.0f / m_size;
+		for(size_t i = 0; i < m_size; ++i) {
+			re[i] *= scale;
+			im[i] *= scale;
+		}
+	}
+
+private:
+	struct Stage
+	{
+		size_t n;
+		size_t s;
+		int radix;
+		size_t twiddles;
+	};
+
+	void transform(float* re, float* im)
+	{
+		float* xr = re;
+		float* xi = im;
+		float* yr = m_workRe.data();
+		float* yi = m_workIm.data();
+		for(const Stage& stage : m_stages) {
+			if(stage.radix == 4) {
+				radix4(stage, xr, xi, yr, yi);
+			}
+			else {
+				radix2(stage, xr, xi, yr, yi);
+			}
+			std::swap(xr, yr);
+			std::swap(xi, yi);
+		}
+		if(xr != re) {
+			std::copy(xr, xr + m_size, re);
+			std::copy(xi, xi + m_size, im);
+		}
+	}
+
+	void radix4(const Stage& stage, const float* xr, const float* xi, float* yr, float* yi) const
+	{
+		const size_t s = stage.s;
+		const size_t m = stage.n / 4;
+		const float* w1r = &m_twiddles[stage.twiddles];
+		const float* w1i = w1r + m;
+		const float* w2r = w1i + m;
+		const float* w2i = w2r + m;
+		const float* w3r = w2i + m;
+		const float* w3i = w3r + m;
+
+		size_t p = 0;
+#if ENGINE_AUDIO_SSE2
+		if(s == 1) {
+			// four butterflies at once, their outputs are interleaved by a transpose
+			for(; p + 4 <= m; p += 4) {
+				__m128 r0, i0, r1, i1, r2, i2, r3, i3;
+				butterfly4(
+					_mm_loadu_ps(xr + p), _mm_loadu_ps(xi + p), _mm_loadu_ps(xr + p + m), _mm_loadu_ps(xi + p + m),
+					_mm_loadu_ps(xr + p + 2 * m), _mm_loadu_ps(xi + p + 2 * m), _mm_loadu_ps(xr + p + 3 * m), _mm_loadu_ps(xi + p + 3 * m),
+					_mm_loadu_ps(w1r + p), _mm_loadu_ps(w1i + p), _mm_loadu_ps(w2r + p), _mm_loadu_ps(w2i + p), _mm_loadu_ps(w3r + p), _mm_loadu_ps(w3i + p),
+					r0, i0, r1, i1, r2, i2, r3, i3);
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				_MM_TRANSPOSE4_PS(i0, i1, i2, i3);
+				_mm_storeu_ps(yr + 4 * p, r0);
+				_mm_storeu_ps(yr + 4 * p + 4, r1);
+				_mm_storeu_ps(yr + 4 * p + 8, r2);
+				_mm_storeu_ps(yr + 4 * p + 12, r3);
+				_mm_storeu_ps(yi + 4 * p, i0);
+				_mm_storeu_ps(yi + 4 * p + 4, i1);
+				_mm_storeu_ps(yi + 4 * p + 8, i2);
+				_mm_storeu_ps(yi + 4 * p + 12, i3);
+			}
+		}
+		else if(s % 4 == 0) {
+			for(; p < m; ++p) {
+				const __m128 v1r = _mm_set1_ps(w1r[p]), v1i = _mm_set1_ps(w1i[p]);
+				const __m128 v2r = _mm_set1_ps(w2r[p]), v2i = _mm_set1_ps(w2i[p]);
+				const __m128 v3r = _mm_set1_ps(w3r[p]), v3i = _mm_set1_ps(w3i[p]);
+				const size_t a = s * p, b = s * (p + m), c = s * (p + 2 * m), d = s * (p + 3 * m);
+				const size_t out = s * 4 * p;
+				for(size_t q = 0; q < s; q += 4) {
+					__m128 r0, i0, r1, i1, r2, i2, r3, i3;
+					butterfly4(
+						_mm_loadu_ps(xr + a + q), _mm_loadu_ps(xi + a + q), _mm_loadu_ps(xr + b + q), _mm_loadu_ps(xi + b + q),
+						_mm_loadu_ps(xr + c + q), _mm_loadu_ps(xi + c + q), _mm_loadu_ps(xr + d + q), _mm_loadu_ps(xi + d + q),
+						v1r, v1i, v2r, v2i, v3r, v3i,
+						r0, i0, r1, i1, r2, i2, r3, i3);
+					_mm_storeu_ps(yr + out + q, r0);
+					_mm_storeu_ps(yi + out + q, i0);
+					_mm_storeu_ps(yr + out + s + q, r1);
+					_mm_storeu_ps(yi + out + s + q, i1);
+					_mm_storeu_ps(yr + out + 2 * s + q, r2);
+					_mm_storeu_ps(yi + out + 2 * s + q, i2);
+					_mm_storeu_ps(yr + out + 3 * s + q, r3);
+					_mm_storeu_ps(yi + out + 3 * s + q, i3);
+				}
+			}
+			return;
+		}
+#endif
+		for(; p < m; ++p) {
+			for(size_t q = 0; q < s; ++q) {
+				const size_t a = q + s * p, b = q + s * (p + m), c = q + s * (p + 2 * m), d = q + s * (p + 3 * m);
+				const float apcR = xr[a] + xr[c], apcI = xi[a] + xi[c];
+				const float amcR = xr[a] - xr[c], amcI = xi[a] - xi[c];
+				const float bpdR = xr[b] + xr[d], bpdI = xi[b] + xi[d];
+				// -i (b - d)
+				const float jR = xi[b] - xi[d], jI = xr[d] - xr[b];
+				const size_t out = q + s * 4 * p;
+				yr[out] = apcR + bpdR;
+				yi[out] = apcI + bpdI;
+				multiply(amcR + jR, amcI + jI, w1r[p], w1i[p], yr[out + s], yi[out + s]);
+				multiply(apcR - bpdR, apcI - bpdI, w2r[p], w2i[p], yr[out + 2 * s], yi[out + 2 * s]);
+				multiply(amcR - jR, amcI - jI, w3r[p], w3i[p], yr[out + 3 * s], yi[out + 3 * s]);
+			}
+		}
+	}
+
+	void radix2(const Stage& stage, const float* xr, const float* xi, float* yr, float* yi) const
+	{
+		const size_t s = stage.s;
+		const size_t m = stage.n / 2;
+		const float* wr = &m_twiddles[stage.twiddles];
+		const float* wi = wr + m;
+		for(size_t p = 0; p < m; ++p) {
+			const size_t a = s * p, b = s * (p + m), out = s * 2 * p;
+			size_t q = 0;
+#if ENGINE_AUDIO_SSE2
+			const __m128 vr = _mm_set1_ps(wr[p]), vi = _mm_set1_ps(wi[p]);
+			for(; q + 4 <= s; q += 4) {
+				const __m128 ar = _mm_loadu_ps(xr + a + q), ai = _mm_loadu_ps(xi + a + q);
+				const __m128 br = _mm_loadu_ps(xr + b + q), bi = _mm_loadu_ps(xi + b + q);
+				const __m128 dr = _mm_sub_ps(ar, br), di = _mm_sub_ps(ai, bi);
+				_mm_storeu_ps(yr + out + q, _mm_add_ps(ar, br));
+				_mm_storeu_ps(yi + out + q, _mm_add_ps(ai, bi));
+				_mm_storeu_ps(yr + out + s + q, _mm_sub_ps(_mm_mul_ps(dr, vr), _mm_mul_ps(di, vi)));
+				_mm_storeu_ps(yi + out + s + q, _mm_add_ps(_mm_mul_ps(dr, vi), _mm_mul_ps(di, vr)));
+			}
+#endif
+			for(; q < s; ++q) {
+				const float ar = xr[a + q], ai = xi[a + q];
+				const float br = xr[b + q], bi = xi[b + q];
+				yr[out + q] = ar + br;
+				yi[out + q] = ai + bi;
+				multiply(ar - br, ai - bi, wr[p], wi[p], yr[out + s + q], yi[out + s + q]);
+			}
+		}
+	}
+
+	static void multiply(float ar, float ai, float br, float bi, float& outR, float& outI)
+	{
+		outR = ar * br - ai * bi;
+		outI = ar * bi + ai * br;
+	}
+
+#if ENGINE_AUDIO_SSE2
+	static void multiply(__m128 ar, __m128 ai, __m128 br, __m128 bi, __m128& outR, __m128& outI)
+	{
+		outR = _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+		outI = _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+	}
+
+	static void butterfly4(__m128 ar, __m128 ai, __m128 br, __m128 bi, __m128 cr, __m128 ci, __m128 dr, __m128 di,
+		__m128 w1r, __m128 w1i, __m128 w2r, __m128 w2i, __m128 w3r, __m128 w3i,
+		__m128& r0, __m128& i0, __m128& r1, __m128& i1, __m128& r2, __m128& i2, __m128& r3, __m128& i3)
+	{
+		const __m128 apcR = _mm_add_ps(ar, cr), apcI = _mm_add_ps(ai, ci);
+		const __m128 amcR = _mm_sub_ps(ar, cr), amcI = _mm_sub_ps(ai, ci);
+		const __m128 bpdR = _mm_add_ps(br, dr), bpdI = _mm_add_ps(bi, di);
+		const __m128 jR = _mm_sub_ps(bi, di), jI = _mm_sub_ps(dr, br);
+		r0 = _mm_add_ps(apcR, bpdR);
+		i0 = _mm_add_ps(apcI, bpdI);
+		multiply(_mm_add_ps(amcR, jR), _mm_add_ps(amcI, jI), w1r, w1i, r1, i1);
+		multiply(_mm_sub_ps(apcR, bpdR), _mm_sub_ps(apcI, bpdI), w2r, w2i, r2, i2);
+		multiply(_mm_sub_ps(amcR, jR), _mm_sub_ps(amcI, jI), w3r, w3i, r3, i3);
+	}
+#endif
+
+	const size_t m_size;
+	std::vector<Stage> m_stages;
+	// per stage cos and sin of each power of the twiddle, m values each
+	std::vector<float> m_twiddles;
+	std::vector<float> m_workRe;
+	std::vector<float> m_workIm;
+};
+
+}
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+
+#include "ReSDL/ReSDL.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ENGINE_AUDIO_SSE2 1
+#endif
+
+namespace Engine {
+namespace Audio {
+namespace kernels {
+
+// Inner loops of the audio thread. All of them take interleaved float samples, handle any count
+// and do not need aligned pointers. Gains ramp linearly by the given step per frame so parameter
+// changes do not click.
+
+// treats denormal floats as zero on this thread while it lives, restoring the previous mode after
+class FlushDenormals
+{
+public:
+	FlushDenormals()
+	{
+#if ENGINE_AUDIO_SSE2
+		m_previous = _mm_getcsr();
+		// flush to zero and denormals are zero
+		_mm_setcsr(m_previous | 0x8040);
+#endif
+	}
+
+	~FlushDenormals()
+	{
+#if ENGINE_AUDIO_SSE2
+		_mm_setcsr(m_previous);
+#endif
+	}
+
+	FlushDenormals(const FlushDenormals&) = delete;
+	FlushDenormals& operator=(const FlushDenormals&) = delete;
+
+private:
+	unsigned int m_previous = 0;
+};
+
+inline void clear(float* out, size_t count)
+{
+	std::memset(out, 0, count * sizeof(float));
+}
+
+// adds a mono signal to a stereo buffer, panned by the left and right gains
+inline void mixMonoToStereo(float* out, const float* in, size_t frames, float gainL, float gainR, float stepL, float stepR)
+{
+	size_t i = 0;
+#if ENGINE_AUDIO_SSE2
+	__m128 gain01 = _mm_setr_ps(gainL, gainR, gainL + stepL, gainR + stepR);
+	const __m128 step2 = _mm_setr_ps(2 * stepL, 2 * stepR, 2 * stepL, 2 * stepR);
+	const __m128 step4 = _mm_add_ps(step2, step2);
+	for(; i + 4 <= frames; i += 4) {
+		const __m128 s = _mm_loadu_ps(in + i);
+		const __m128 gain23 = _mm_add_ps(gain01, step2);
+		float* o = out + 2 * i;
+		_mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_mul_ps(_mm_unpacklo_ps(s, s), gain01)));
+		_mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_mul_ps(_mm_unpackhi_ps(s, s), gain23)));
+		gain01 = _mm_add_ps(gain01, step4);
+	}
+	gainL += stepL * i;
+	gainR += stepR * i;
+#endif
+	for(; i < frames; ++i) {
+		out[2 * i] += in[i] * gainL;
+		out[2 * i + 1] += in[i] * gainR;
+		gainL += stepL;
+		gainR += stepR;
+	}
+}
+
+inline void mixStereo(float* out, const float* in, size_t frames, float gainL, float gainR, float stepL, float stepR)
+{
+	size_t i = 0;
+#if ENGINE_AUDIO_SSE2
+	__m128 gain = _mm_setr_ps(gainL, gainR, gainL + stepL, gainR + stepR);
+	const __m128 step2 = _mm_setr_ps(2 * stepL, 2 * stepR, 2 * stepL, 2 * stepR);
+	for(; i + 2 <= frames; i += 2) {
+		float* o = out + 2 * i;
+		_mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), _mm_mul_ps(_mm_loadu_ps(in + 2 * i), gain)));
+		gain = _mm_add_ps(gain, step2);
+	}
+	gainL += stepL * i;
+	gainR += stepR * i;
+#endif
+	for(; i < frames; ++i) {
+		out[2 * i] += in[2 * i] * gainL;
+		out[2 * i + 1] += in[2 * i + 1] * gainR;
+		gainL += stepL;
+		gainR += stepR;
+	}
+}
+
+// scales by gain and clamps to [-1, 1]
+inline void scaleAndClip(float* out, size_t count, float gain)
+{
+	size_t i = 0;
+#if ENGINE_AUDIO_SSE2
+	const __m128 g = _mm_set1_ps(gain);
+	const __m128 lo = _mm_set1_ps(-1.0f);
+	const __m128 hi = _mm_set1_ps(1.0f);
+	for(; i + 4 <= count; i += 4) {
+		const __m128 v = _mm_mul_ps(_mm_loadu_ps(out + i), g);
+		_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(v, lo), hi));
+	}
+#endif
+	for(; i < count; ++i) {
+		const float v = out[i] * gain;
+		out[i] = v < -1.0f ? -1.0f : v > 1.0f ? 1.0f : v;
+	}
+}
+
+// float to 16 bit with rounding and saturation
+inline void floatToS16(const float* in, Sint16* out, size_t count)
+{
+	size_t i = 0;
+#if ENGINE_AUDIO_SSE2
+	const __m128 scale = _mm_set1_ps(32767.0f);
+	for(; i + 8 <= count; i += 8) {
+		const __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i), scale));
+		const __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+	}
+#endif
+	for(; i < count; ++i) {
+		const float v = in[i] < -1.0f ? -1.0f : in[i] > 1.0f ? 1.0f : in[i];
+		out[i] = static_cast<Sint16>(std::lrint(v * 32767.0f));
+	}
+}
+
+// float to 32 bit with saturation, 1.0 maps to the largest float below 2^31
+inline void floatToS32(const float* in, Sint32* out, size_t count)
+{
+	size_t i = 0;
+#if ENGINE_AUDIO_SSE2
+	const __m128 scale = _mm_set1_ps(2147483648.0f);
+	const __m128 lo = _mm_set1_ps(-2147483648.0f);
+	const __m128 hi = _mm_set1_ps(2147483520.0f);
+	for(; i + 4 <= count; i += 4) {
+		const __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), lo), hi);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtps_epi32(v));
+	}
+#endif
+	for(; i < count; ++i) {
+		const float v = in[i] * 2147483648.0f;
+		out[i] = static_cast<Sint32>(std::lrint(v < -2147483648.0f ? -2147483648.0f : v > 2147483520.0f ? 2147483520.0f : v));
+	}
+}
+
+inline float dot(const float* a, const float* b, size_t count)
+{
+	size_t i = 0;
+	float sum = 0.0f;
+#if ENGINE_AUDIO_SSE2
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	for(; i + 8 <= count; i += 8) {
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	acc0 = _mm_add_ps(acc0, acc1);
+	acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+	acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+	sum = _mm_cvtss_f32(acc0);
+#endif
+	for(; i < count; ++i) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+}
+}
+}
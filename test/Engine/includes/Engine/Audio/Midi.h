@@ -0,0 +1,779 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/IO/MappedFile.h"
+#include "Engine/Audio/Mixer.h"
+#include "Engine/Audio/Oscillator.h"
+#include "Engine/Audio/Kernels.h"
+
+namespace Engine {
+namespace Audio {
+
+// a channel message at its time from the start of the song
+struct MidiEvent
+{
+	double seconds = 0.0;
+	Uint8 status = 0;
+	Uint8 data1 = 0;
+	Uint8 data2 = 0;
+
+	Uint8 type() const
+	{
+		return status & 0xF0;
+	}
+
+	Uint8 channel() const
+	{
+		return status & 0x0F;
+	}
+};
+
+// A Standard MIDI File, format 0 or 1, with all tracks merged into one list of channel messages.
+// Tempo changes are resolved while parsing, so every event knows its time in seconds. System
+// exclusive and meta events other than tempo and end of track are skipped.
+class MidiFile
+{
+public:
+	explicit MidiFile(const std::string& path)
+	{
+		IO::MappedFile file(path);
+		parse(file.data(), file.size(), path);
+	}
+
+	MidiFile(const uint8_t* data, size_t size, const std::string& name = "midi data")
+	{
+		parse(data, size, name);
+	}
+
+	// sorted by time
+	const std::vector<MidiEvent>& events() const
+	{
+		return m_events;
+	}
+
+	// up to the last end of track, including trailing silence
+	double duration() const
+	{
+		return m_duration;
+	}
+
+	size_t tracks() const
+	{
+		return m_tracks;
+	}
+
+private:
+	struct RawEvent
+	{
+		uint64_t tick;
+		// file order within the same tick
+		uint32_t order;
+		// 0 for a tempo change, data1 to data3 hold the microseconds per quarter
+		Uint8 status;
+		Uint8 data1;
+		Uint8 data2;
+		Uint8 data3;
+	};
+
+	static uint32_t readU32(const uint8_t* p)
+	{
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+	}
+
+	static uint16_t readU16(const uint8_t* p)
+	{
+		return static_cast<uint16_t>((p[0] << 8) | p[1]);
+	}
+
+	static uint32_t readVariable(const uint8_t*& p, const uint8_t* end, const std::string& name)
+	{
+		uint32_t value = 0;
+		for(int i = 0; i < 4; ++i) {
+			if(p >= end) {
+				break;
+			}
+			const uint8_t byte = *p++;
+			value = (value << 7) | (byte & 0x7F);
+			if(!(byte & 0x80)) {
+				return value;
+			}
+		}
+		throw std::runtime_error(name + " has a broken variable length number");
+	}
+
+	void parse(const uint8_t* data, size_t size, const std::string& name)
+	{
+		if(size < 14 || std::memcmp(data, "MThd", 4) != 0 || readU32(data + 4) < 6) {
+			throw std::runtime_error(name + " is not a MIDI file");
+		}
+		const uint16_t format = readU16(data + 8);
+		const uint16_t trackCount = readU16(data + 10);
+		const uint16_t division = readU16(data + 12);
+		if(format > 1) {
+			throw std::runtime_error(name + " is a format 2 MIDI file, only 0 and 1 are supported");
+		}
+
+		std::vector<RawEvent> raw;
+		uint64_t endTick = 0;
+		size_t offset = 8 + readU32(data + 4);
+		uint32_t order = 0;
+		while(m_tracks < trackCount && offset + 8 <= size) {
+			const uint32_t length = readU32(data + offset + 4);
+			const bool isTrack = std::memcmp(data + offset, "MTrk", 4) == 0;
+			const uint8_t* p = data + offset + 8;
+			// tolerate a track that claims more bytes than the file has
+			const uint8_t* end = data + std::min<size_t>(size, offset + 8 + length);
+			offset += 8 + length;
+			if(!isTrack) {
+				continue;
+			}
+			++m_tracks;
+
+			uint64_t tick = 0;
+			Uint8 running = 0;
+			while(p < end) {
+				tick += readVariable(p, end, name);
+				if(p >= end) {
+					break;
+				}
+				Uint8 status = *p;
+				if(status & 0x80) {
+					++p;
+				}
+				else if(!running) {
+					throw std::runtime_error(name + " has data without a status byte");
+				}
+				else {
+					status = running;
+				}
+
+				if(status == 0xFF) {
+					if(p >= end) {
+						break;
+					}
+					const Uint8 type = *p++;
+					const uint32_t metaLength = readVariable(p, end, name);
+					if(type == 0x51 && metaLength == 3 && p + 3 <= end) {
+						raw.push_back(RawEvent{ tick, order++, 0, p[0], p[1], p[2] });
+					}
+					p += std::min<size_t>(metaLength, end - p);
+					if(type == 0x2F) {
+						break;
+					}
+					continue;
+				}
+				if(status == 0xF0 || status == 0xF7) {
+					const uint32_t sysexLength = readVariable(p, end, name);
+					p += std::min<size_t>(sysexLength, end - p);
+					continue;
+				}
+				if(status >= 0xF0) {
+					// system common messages do not belong in files, there is no telling their length
+					throw std::runtime_error(name + " has an unexpected system message");
+				}
+
+				running = status;
+				const Uint8 type = status & 0xF0;
+				const int length = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+				if(p + length > end) {
+					break;
+				}
+				const Uint8 data1 = p[0] & 0x7F;
+				const Uint8 data2 = length == 2 ? (p[1] & 0x7F) : 0;
+				p += length;
+				raw.push_back(RawEvent{ tick, order++, status, data1, data2, 0 });
+			}
+			endTick = std::max(endTick, tick);
+		}
+
+		std::stable_sort(raw.begin(), raw.end(), [](const RawEvent& a, const RawEvent& b) {
+			return a.tick < b.tick;
+		});
+
+		// SMPTE divisions count frames per second and ticks per frame, they ignore the tempo
+		const bool smpte = (division & 0x8000) != 0;
+		const double smpteTick = smpte ? 1.0 / (-static_cast<int8_t>(division >> 8) * (division & 0xFF)) : 0.0;
+		const double ticksPerQuarter = smpte ? 1.0 : std::max<uint16_t>(division, 1);
+		double secondsPerTick = smpte ? smpteTick : 0.5 / ticksPerQuarter;
+		double seconds = 0.0;
+		uint64_t lastTick = 0;
+		m_events.reserve(raw.size());
+		for(const RawEvent& event : raw) {
+			seconds += (event.tick - lastTick) * secondsPerTick;
+			lastTick = event.tick;
+			if(event.status == 0) {
+				if(!smpte) {
+					const uint32_t microseconds = (uint32_t(event.data1) << 16) | (uint32_t(event.data2) << 8) | event.data3;
+					secondsPerTick = microseconds / 1e6 / ticksPerQuarter;
+				}
+				continue;
+			}
+			m_events.push_back(MidiEvent{ seconds, event.status, event.data1, event.data2 });
+		}
+		m_duration = seconds + (endTick - lastTick) * secondsPerTick;
+	}
+
+	std::vector<MidiEvent> m_events;
+	double m_duration = 0.0;
+	size_t m_tracks = 0;
+};
+
+// A General MIDI-ish synthesizer with a fixed voice budget. Melodic programs map to wavetable
+// waveforms and envelopes by instrument family; channel 10 plays synthesized drums. When all
+// voices are busy a new note takes the quietest releasing voice, or else the oldest one.
+// render runs on the audio thread and never allocates; so do the event functions.
+class MidiSynth
+{
+public:
+	static constexpr size_t Channels = 16;
+
+	MidiSynth(int sampleRate, size_t voices = 32, size_t maxBlockFrames = 1024)
+	: m_sampleRate(sampleRate)
+	, m_tables{ Wavetable::sine(), Wavetable::triangle(), Wavetable::saw(), Wavetable::square() }
+	, m_voices(voices, Voice(WavetableOscillator(m_tables[0], 440.0, sampleRate)))
+	, m_scratch(maxBlockFrames)
+	, m_maxBlockFrames(maxBlockFrames)
+	{
+		resetControllers();
+	}
+
+	MidiSynth(const MidiSynth&) = delete;
+	MidiSynth& operator=(const MidiSynth&) = delete;
+
+	void setGain(float gain)
+	{
+		m_gain = gain;
+	}
+
+	void handle(const MidiEvent& event)
+	{
+		const Uint8 channel = event.channel();
+		switch(event.type()) {
+		case 0x90:
+			if(event.data2 > 0) {
+				noteOn(channel, event.data1, event.data2);
+				break;
+			}
+			// note on with velocity 0 is a note off
+			noteOff(channel, event.data1);
+			break;
+		case 0x80:
+			noteOff(channel, event.data1);
+			break;
+		case 0xB0:
+			controlChange(channel, event.data1, event.data2);
+			break;
+		case 0xC0:
+			m_channels[channel].program = event.data1;
+			break;
+		case 0xE0:
+			pitchBend(channel, (event.data2 << 7) | event.data1);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void noteOn(Uint8 channel, Uint8 key, Uint8 velocity)
+	{
+		Voice& voice = allocate();
+		const ChannelState& state = m_channels[channel];
+		if(!voice.active) {
+			voice.level = 0.0f;
+		}
+		voice.active = true;
+		voice.channel = channel;
+		voice.key = key;
+		voice.velocity = velocity / 127.0f;
+		voice.held = true;
+		voice.sustained = false;
+		voice.age = m_age++;
+		voice.drum = channel == 9;
+		if(voice.drum) {
+			startDrum(voice, key);
+			return;
+		}
+		voice.patch = &patchFor(state.program);
+		voice.oscillator = WavetableOscillator(m_tables[voice.patch->table], frequency(voice), m_sampleRate);
+		voice.stage = Stage::Attack;
+	}
+
+	void noteOff(Uint8 channel, Uint8 key)
+	{
+		for(Voice& voice : m_voices) {
+			if(voice.active && voice.held && voice.channel == channel && voice.key == key) {
+				voice.held = false;
+				if(m_channels[channel].sustain) {
+					voice.sustained = true;
+				}
+				else {
+					release(voice);
+				}
+			}
+		}
+	}
+
+	void controlChange(Uint8 channel, Uint8 controller, Uint8 value)
+	{
+		ChannelState& state = m_channels[channel];
+		switch(controller) {
+		case 7:
+			state.volume = value / 127.0f;
+			break;
+		case 10:
+			state.pan = (value - 64) / 63.0f;
+			break;
+		case 11:
+			state.expression = value / 127.0f;
+			break;
+		case 64:
+			state.sustain = value >= 64;
+			if(!state.sustain) {
+				for(Voice& voice : m_voices) {
+					if(voice.active && voice.channel == channel && voice.sustained) {
+						voice.sustained = false;
+						release(voice);
+					}
+				}
+			}
+			break;
+		case 120:
+			// all sound off
+			for(Voice& voice : m_voices) {
+				if(voice.channel == channel) {
+					voice.active = false;
+				}
+			}
+			break;
+		case 121:
+			state = ChannelState{ state.program };
+			break;
+		case 123:
+			for(Voice& voice : m_voices) {
+				if(voice.active && voice.channel == channel) {
+					voice.held = voice.sustained = false;
+					release(voice);
+				}
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	// value from 0 to 16383, 8192 is the centre; the range is two semitones
+	void pitchBend(Uint8 channel, int value)
+	{
+		m_channels[channel].bend = (value - 8192) / 8192.0f * 2.0f;
+		for(Voice& voice : m_voices) {
+			if(voice.active && !voice.drum && voice.channel == channel) {
+				voice.oscillator.setFrequency(frequency(voice));
+			}
+		}
+	}
+
+	// releases every note, e.g. before jumping in a song
+	void allNotesOff()
+	{
+		for(Voice& voice : m_voices) {
+			if(voice.active) {
+				voice.held = voice.sustained = false;
+				release(voice);
+			}
+		}
+	}
+
+	void resetControllers()
+	{
+		for(ChannelState& state : m_channels) {
+			state = ChannelState{};
+		}
+	}
+
+	size_t activeVoices() const
+	{
+		return static_cast<size_t>(std::count_if(m_voices.begin(), m_voices.end(), [](const Voice& voice) { return voice.active; }));
+	}
+
+	// notes that took a busy voice because the budget was used up
+	size_t stolenVoices() const
+	{
+		return m_stolen;
+	}
+
+	// adds frames interleaved stereo frames
+	void render(float* stereo, size_t frames)
+	{
+		while(frames > 0) {
+			const size_t block = std::min(frames, m_maxBlockFrames);
+			for(Voice& voice : m_voices) {
+				if(voice.active) {
+					if(voice.drum) {
+						renderDrum(voice, stereo, block);
+					}
+					else {
+						renderTone(voice, stereo, block);
+					}
+				}
+			}
+			stereo += block * 2;
+			frames -= block;
+		}
+	}
+
+private:
+	enum class Stage : Uint8 { Attack, Decay, Sustain, Release };
+
+	// the envelope is evaluated every EnvelopeStep frames, the gain ramps linearly in between
+	static constexpr size_t EnvelopeStep = 32;
+	static constexpr float Silence = 1e-3f;
+
+	struct Patch
+	{
+		// index into m_tables: sine, triangle, saw, square
+		int table;
+		float attack;
+		// time constants in seconds, sustain 0 makes the instrument percussive
+		float decay;
+		float sustain;
+		float release;
+		float gain;
+	};
+
+	struct ChannelState
+	{
+		Uint8 program = 0;
+		float volume = 100.0f / 127.0f;
+		float expression = 1.0f;
+		float pan = 0.0f;
+		float bend = 0.0f;
+		bool sustain = false;
+	};
+
+	struct Voice
+	{
+		explicit Voice(WavetableOscillator oscillator)
+		: oscillator(oscillator)
+		{
+		}
+
+		bool active = false;
+		bool held = false;
+		bool sustained = false;
+		bool drum = false;
+		Uint8 channel = 0;
+		Uint8 key = 0;
+		float velocity = 0.0f;
+		Uint32 age = 0;
+		Stage stage = Stage::Release;
+		float level = 0.0f;
+		const Patch* patch = nullptr;
+		WavetableOscillator oscillator;
+		// drums: a decaying mix of noise and a falling sine
+		Uint32 noise = 1;
+		float noiseLevel = 0.0f;
+		float tonePhase = 0.0f;
+		float toneFrequency = 0.0f;
+		float toneDrop = 1.0f;
+		float decay = 0.0f;
+	};
+
+	static const Patch& patchFor(Uint8 program)
+	{
+		// one patch per family of eight programs: piano, chromatic percussion, organ, guitar,
+		// bass, strings, ensemble, brass, reed, pipe, synth lead, synth pad, synth effects,
+		// ethnic, percussive and sound effects
+		static const Patch patches[16] = {
+			{ 1, 0.002f, 0.6f, 0.0f, 0.25f, 0.9f },
+			{ 0, 0.001f, 0.35f, 0.0f, 0.3f, 0.9f },
+			{ 3, 0.005f, 1.0f, 1.0f, 0.05f, 0.35f },
+			{ 1, 0.002f, 0.45f, 0.0f, 0.2f, 0.9f },
+			{ 1, 0.004f, 0.8f, 0.5f, 0.08f, 1.0f },
+			{ 2, 0.08f, 1.0f, 0.85f, 0.25f, 0.45f },
+			{ 2, 0.12f, 1.0f, 0.8f, 0.35f, 0.45f },
+			{ 2, 0.03f, 0.3f, 0.75f, 0.12f, 0.45f },
+			{ 3, 0.02f, 0.3f, 0.8f, 0.08f, 0.35f },
+			{ 0, 0.03f, 0.5f, 0.85f, 0.12f, 0.9f },
+			{ 3, 0.005f, 0.3f, 0.7f, 0.1f, 0.35f },
+			{ 2, 0.3f, 1.0f, 0.8f, 0.6f, 0.4f },
+			{ 1, 0.05f, 0.8f, 0.5f, 0.5f, 0.6f },
+			{ 1, 0.003f, 0.4f, 0.0f, 0.2f, 0.8f },
+			{ 0, 0.001f, 0.2f, 0.0f, 0.15f, 0.9f },
+			{ 2, 0.01f, 0.5f, 0.5f, 0.3f, 0.4f },
+		};
+		return patches[(program >> 3) & 15];
+	}
+
+	double frequency(const Voice& voice) const
+	{
+		return 440.0 * std::pow(2.0, (voice.key - 69 + m_channels[voice.channel].bend) / 12.0);
+	}
+
+	// one pole coefficient reaching about a third of the way after seconds
+	float coefficient(float seconds, size_t frames) const
+	{
+		return std::exp(-static_cast<float>(frames) / (std::max(seconds, 0.001f) * m_sampleRate));
+	}
+
+	Voice& allocate()
+	{
+		Voice* best = nullptr;
+		for(Voice& voice : m_voices) {
+			if(!voice.active) {
+				return voice;
+			}
+			// releasing voices go first, the quietest of them; otherwise the oldest note
+			if(!best
+				|| (voice.stage == Stage::Release && best->stage != Stage::Release)
+				|| (voice.stage == Stage::Release && best->stage == Stage::Release && voice.level < best->level)
+				|| (voice.stage != Stage::Release && best->stage != Stage::Release && voice.age < best->age)) {
+				best = &voice;
+			}
+		}
+		++m_stolen;
+		return *best;
+	}
+
+	void release(Voice& voice)
+	{
+		if(voice.drum) {
+			// drums ring out on their own
+			return;
+		}
+		voice.stage = Stage::Release;
+	}
+
+	void startDrum(Voice& voice, Uint8 key)
+	{
+		voice.noise = 0x9E3779B9u ^ (voice.age * 2654435761u);
+		voice.tonePhase = 0.0f;
+		voice.level = 1.0f;
+		float decaySeconds;
+		if(key == 35 || key == 36) {
+			// kick
+			voice.noiseLevel = 0.05f;
+			voice.toneFrequency = 120.0f;
+			voice.toneDrop = coefficient(0.04f, 1);
+			decaySeconds = 0.15f;
+		}
+		else if(key == 38 || key == 40 || key == 37 || key == 39) {
+			// snare, side stick and clap
+			voice.noiseLevel = 0.6f;
+			voice.toneFrequency = 190.0f;
+			voice.toneDrop = coefficient(0.2f, 1);
+			decaySeconds = 0.09f;
+		}
+		else if(key == 42 || key == 44 || key == 46 || (key >= 49 && key <= 59)) {
+			// hi-hats and cymbals
+			voice.noiseLevel = 0.35f;
+			voice.toneFrequency = 0.0f;
+			decaySeconds = key == 42 || key == 44 ? 0.03f : 0.35f;
+		}
+		else {
+			// toms and everything else
+			voice.noiseLevel = 0.1f;
+			voice.toneFrequency = 80.0f + (key - 41) * 12.0f;
+			voice.toneDrop = coefficient(0.3f, 1);
+			decaySeconds = 0.2f;
+		}
+		voice.decay = coefficient(decaySeconds, 1);
+	}
+
+	void panGains(const Voice& voice, float gain, float& left, float& right) const
+	{
+		const ChannelState& state = m_channels[voice.channel];
+		const float scale = gain * m_gain * voice.velocity * voice.velocity * state.volume * state.volume * state.expression;
+		const float angle = (std::min(std::max(state.pan, -1.0f), 1.0f) + 1.0f) * 0.78539816f;
+		left = scale * std::cos(angle);
+		right = scale * std::sin(angle);
+	}
+
+	// envelope level after frames more frames, and whether the voice is still audible
+	bool advanceEnvelope(Voice& voice, size_t frames)
+	{
+		const Patch& patch = *voice.patch;
+		switch(voice.stage) {
+		case Stage::Attack:
+			voice.level += static_cast<float>(frames) / (patch.attack * m_sampleRate);
+			if(voice.level >= 1.0f) {
+				voice.level = 1.0f;
+				voice.stage = Stage::Decay;
+			}
+			break;
+		case Stage::Decay:
+			voice.level = patch.sustain + (voice.level - patch.sustain) * coefficient(patch.decay, frames);
+			if(patch.sustain > 0.0f && voice.level - patch.sustain < Silence) {
+				voice.level = patch.sustain;
+				voice.stage = Stage::Sustain;
+			}
+			break;
+		case Stage::Sustain:
+			break;
+		case Stage::Release:
+			voice.level *= coefficient(patch.release, frames);
+			break;
+		}
+		return voice.level > Silence || voice.stage == Stage::Attack;
+	}
+
+	void renderTone(Voice& voice, float* stereo, size_t frames)
+	{
+		voice.oscillator.render(m_scratch.data(), frames);
+		float left, right;
+		panGains(voice, voice.patch->gain, left, right);
+		for(size_t done = 0; done < frames;) {
+			const size_t count = std::min(EnvelopeStep, frames - done);
+			const float from = voice.level;
+			const bool audible = advanceEnvelope(voice, count);
+			const float to = audible ? voice.level : 0.0f;
+			const float step = (to - from) / count;
+			kernels::mixMonoToStereo(stereo + done * 2, m_scratch.data() + done, count, from * left, from * right, step * left, step * right);
+			done += count;
+			if(!audible) {
+				voice.active = false;
+				return;
+			}
+		}
+	}
+
+	void renderDrum(Voice& voice, float* stereo, size_t frames)
+	{
+		float left, right;
+		panGains(voice, 0.9f, left, right);
+		const float phaseStep = 1.0f / m_sampleRate;
+		for(size_t i = 0; i < frames; ++i) {
+			// xorshift noise
+			voice.noise ^= voice.noise << 13;
+			voice.noise ^= voice.noise >> 17;
+			voice.noise ^= voice.noise << 5;
+			const float noise = static_cast<Sint32>(voice.noise) * (1.0f / 2147483648.0f);
+			float sample = noise * voice.noiseLevel;
+			if(voice.toneFrequency > 0.0f) {
+				voice.tonePhase += voice.toneFrequency * phaseStep;
+				voice.tonePhase -= std::floor(voice.tonePhase);
+				sample += std::sin(voice.tonePhase * 6.2831853f);
+				voice.toneFrequency = 40.0f + (voice.toneFrequency - 40.0f) * voice.toneDrop;
+			}
+			sample *= voice.level;
+			voice.level *= voice.decay;
+			stereo[2 * i] += sample * left;
+			stereo[2 * i + 1] += sample * right;
+		}
+		if(voice.level < Silence) {
+			voice.active = false;
+		}
+	}
+
+	const int m_sampleRate;
+	std::array<Wavetable, 4> m_tables;
+	std::array<ChannelState, Channels> m_channels;
+	std::vector<Voice> m_voices;
+	std::vector<float> m_scratch;
+	const size_t m_maxBlockFrames;
+	float m_gain = 0.2f;
+	Uint32 m_age = 0;
+	size_t m_stolen = 0;
+};
+
+// Plays a MidiFile through a MidiSynth as a mixer voice. Events are applied at their exact
+// sample: the synth renders up to an event, the event changes its state, rendering continues.
+class MidiPlayer : public IVoiceSource
+{
+public:
+	MidiPlayer(std::shared_ptr<const MidiFile> file, int sampleRate, size_t voices = 32, size_t maxBlockFrames = 1024)
+	: m_file(std::move(file))
+	, m_synth(sampleRate, voices, maxBlockFrames)
+	, m_end(static_cast<Uint64>(m_file->duration() * sampleRate))
+	{
+		m_frames.reserve(m_file->events().size());
+		for(const MidiEvent& event : m_file->events()) {
+			m_frames.push_back(static_cast<Uint64>(event.seconds * sampleRate + 0.5));
+		}
+	}
+
+	void setLoop(bool loop)
+	{
+		m_loop = loop;
+	}
+
+	MidiSynth& synth()
+	{
+		return m_synth;
+	}
+
+	// back to the start, only while the player is not playing
+	void rewind()
+	{
+		m_position = 0;
+		m_next = 0;
+		m_finished = false;
+		m_synth.allNotesOff();
+		m_synth.resetControllers();
+	}
+
+	bool finished() const
+	{
+		return m_finished;
+	}
+
+	size_t render(float* stereo, size_t frames) override
+	{
+		kernels::clear(stereo, frames * 2);
+		const auto& events = m_file->events();
+		size_t done = 0;
+		while(done < frames) {
+			if(m_position >= m_end && m_next == events.size()) {
+				if(m_loop) {
+					m_position = 0;
+					m_next = 0;
+					m_synth.allNotesOff();
+					m_synth.resetControllers();
+				}
+				else if(m_synth.activeVoices() == 0) {
+					// the last notes have rung out
+					m_finished = true;
+					return done;
+				}
+			}
+			// up to the next event, the end of the song or the end of the buffer
+			Uint64 until = m_position + (frames - done);
+			if(m_next < events.size()) {
+				until = std::min(until, m_frames[m_next]);
+			}
+			else if(m_loop && m_position < m_end) {
+				until = std::min(until, m_end);
+			}
+			const size_t count = static_cast<size_t>(until - m_position);
+			m_synth.render(stereo + done * 2, count);
+			done += count;
+			m_position = until;
+			while(m_next < events.size() && m_frames[m_next] <= m_position) {
+				m_synth.handle(events[m_next++]);
+			}
+		}
+		return done;
+	}
+
+private:
+	std::shared_ptr<const MidiFile> m_file;
+	MidiSynth m_synth;
+	std::vector<Uint64> m_frames;
+	const Uint64 m_end;
+	Uint64 m_position = 0;
+	size_t m_next = 0;
+	bool m_loop = false;
+	bool m_finished = false;
+};
+
+}
+}
@@ -0,0 +1,403 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Concurrency/SpscRingBuffer.h"
+#include "Engine/Audio/Kernels.h"
+
+namespace Engine {
+namespace Audio {
+
+// Interleaved float PCM with one or two channels. The mixer only keeps the pointer, so the
+// samples have to stay alive as long as a voice plays them.
+struct Sound
+{
+	const float* samples = nullptr;
+	Uint32 frames = 0;
+	Uint8 channels = 1;
+};
+
+// Something that produces its samples on the audio thread, like a stream or a synthesizer.
+// render runs inside the audio callback and must neither allocate nor lock.
+class IVoiceSource
+{
+public:
+	virtual ~IVoiceSource() = default;
+
+	// writes up to frames interleaved stereo frames and returns how many it wrote, fewer ends the voice
+	virtual size_t render(float* stereo, size_t frames) = 0;
+};
+
+// identifies one playback of a sound, 0 is never a valid voice
+using VoiceId = Uint32;
+
+// Mixes up to MaxVoices voices into interleaved stereo float output from the SDL audio callback.
+// The game thread controls voices through a lock-free command queue and the audio thread never
+// allocates, locks or waits. Only one thread may call the control functions.
+class Mixer
+{
+public:
+	static constexpr size_t MaxVoices = 256;
+	static constexpr int Channels = 2;
+
+	explicit Mixer(size_t maxBlockFrames = 1024, size_t commandCapacity = 1024)
+	: m_commands(commandCapacity)
+	, m_scratch(maxBlockFrames * Channels)
+	, m_maxBlockFrames(maxBlockFrames)
+	{
+		for(auto& generation : m_finished) {
+			generation.store(0, std::memory_order_relaxed);
+		}
+		m_issued.fill(0);
+	}
+
+	Mixer(const Mixer&) = delete;
+	Mixer& operator=(const Mixer&) = delete;
+
+	// pan goes from -1 (left) to 1 (right), playback starts at startFrame, e.g. to resume a sound;
+	// returns 0 if all voices are busy or the queue is full
+	VoiceId play(const Sound& sound, float gain = 1.0f, float pan = 0.0f, bool loop = false, Uint32 startFrame = 0)
+	{
+		if(!sound.samples || !sound.frames || sound.channels < 1 || sound.channels > 2) {
+			return 0;
+		}
+		Command command{ CommandType::Play };
+		command.sound = sound;
+		command.gain = gain;
+		command.pan = pan;
+		command.loop = loop;
+		command.startFrame = startFrame;
+		return start(command);
+	}
+
+	VoiceId play(IVoiceSource* source, float gain = 1.0f, float pan = 0.0f)
+	{
+		if(!source) {
+			return 0;
+		}
+		Command command{ CommandType::Play };
+		command.source = source;
+		command.gain = gain;
+		command.pan = pan;
+		return start(command);
+	}
+
+	// fades the voice out over one block
+	bool stop(VoiceId voice)
+	{
+		Command command{ CommandType::Stop };
+		command.voice = voice;
+		return send(command);
+	}
+
+	bool setGain(VoiceId voice, float gain)
+	{
+		Command command{ CommandType::SetGain };
+		command.voice = voice;
+		command.gain = gain;
+		return send(command);
+	}
+
+	bool setPan(VoiceId voice, float pan)
+	{
+		Command command{ CommandType::SetPan };
+		command.voice = voice;
+		command.pan = pan;
+		return send(command);
+	}
+
+	bool stopAll()
+	{
+		return send(Command{ CommandType::StopAll });
+	}
+
+	bool setMasterGain(float gain)
+	{
+		Command command{ CommandType::SetMasterGain };
+		command.gain = gain;
+		return send(command);
+	}
+
+	// true from play until the voice ended on the audio thread
+	bool isPlaying(VoiceId voice) const
+	{
+		const size_t slot = voice & SlotMask;
+		const Uint32 generation = voice >> SlotBits;
+		return voice && m_issued[slot] == generation && m_finished[slot].load(std::memory_order_acquire) != generation;
+	}
+
+	// number of voices mixed in the last block
+	size_t activeVoices() const
+	{
+		return m_activeVoices.load(std::memory_order_relaxed);
+	}
+
+	// commands that were lost because the queue was full
+	size_t droppedCommands() const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+	// audio thread: writes frames interleaved stereo frames to out
+	void render(float* out, size_t frames)
+	{
+		processCommands();
+		while(frames > 0) {
+			const size_t block = std::min(frames, m_maxBlockFrames);
+			renderBlock(out, block);
+			out += block * Channels;
+			frames -= block;
+		}
+		m_activeVoices.store(m_activeCount, std::memory_order_relaxed);
+	}
+
+	// SDL_AudioCallback for an AUDIO_F32 stereo device, userdata is the mixer
+	static void SDLCALL callback(void* userdata, Uint8* stream, int length)
+	{
+		auto* mixer = static_cast<Mixer*>(userdata);
+		mixer->render(reinterpret_cast<float*>(stream), static_cast<size_t>(length) / (sizeof(float) * Channels));
+	}
+
+private:
+	static constexpr Uint32 SlotBits = 8;
+	static constexpr Uint32 SlotMask = (1u << SlotBits) - 1;
+	static constexpr Uint32 GenerationMask = 0xFFFFFFu;
+	static_assert(MaxVoices == (1u << SlotBits), "voice ids keep the slot in the low bits");
+
+	enum class CommandType : Uint8 { Play, Stop, SetGain, SetPan, StopAll, SetMasterGain };
+
+	struct Command
+	{
+		CommandType type;
+		VoiceId voice = 0;
+		Sound sound{};
+		IVoiceSource* source = nullptr;
+		float gain = 1.0f;
+		float pan = 0.0f;
+		bool loop = false;
+		Uint32 startFrame = 0;
+	};
+
+	struct Voice
+	{
+		Uint32 generation = 0;
+		Sound sound{};
+		IVoiceSource* source = nullptr;
+		Uint32 position = 0;
+		bool loop = false;
+		bool stopping = false;
+		float gain = 1.0f;
+		float pan = 0.0f;
+		float currentL = 0.0f;
+		float currentR = 0.0f;
+		float targetL = 0.0f;
+		float targetR = 0.0f;
+	};
+
+	bool send(const Command& command)
+	{
+		if(!m_commands.tryPush(command)) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		return true;
+	}
+
+	// game thread: a slot is free once the audio thread finished the generation we issued last
+	VoiceId start(Command& command)
+	{
+		for(size_t n = 0; n < MaxVoices; ++n) {
+			const size_t slot = (m_nextSlot + n) & SlotMask;
+			if(m_finished[slot].load(std::memory_order_acquire) != m_issued[slot]) {
+				continue;
+			}
+			const Uint32 previous = m_issued[slot];
+			Uint32 generation = (previous + 1) & GenerationMask;
+			if(generation == 0) {
+				generation = 1;
+			}
+			command.voice = (generation << SlotBits) | static_cast<Uint32>(slot);
+			m_issued[slot] = generation;
+			if(!send(command)) {
+				m_issued[slot] = previous;
+				return 0;
+			}
+			m_nextSlot = slot + 1;
+			return command.voice;
+		}
+		return 0;
+	}
+
+	// equal power panning
+	static void panGains(float gain, float pan, float& left, float& right)
+	{
+		const float angle = (std::min(std::max(pan, -1.0f), 1.0f) + 1.0f) * 0.78539816f;
+		left = gain * std::cos(angle);
+		right = gain * std::sin(angle);
+	}
+
+	Voice* find(VoiceId id)
+	{
+		Voice& voice = m_voices[id & SlotMask];
+		return voice.generation == (id >> SlotBits) && voice.generation != 0 ? &voice : nullptr;
+	}
+
+	void processCommands()
+	{
+		Command command;
+		while(m_commands.tryPop(command)) {
+			switch(command.type) {
+			case CommandType::Play: {
+				const size_t slot = command.voice & SlotMask;
+				Voice& voice = m_voices[slot];
+				if(voice.generation != 0) {
+					// only possible if the game thread reused a slot we have not released yet
+					continue;
+				}
+				voice = Voice{};
+				voice.generation = command.voice >> SlotBits;
+				voice.sound = command.sound;
+				voice.position = command.sound.frames ? command.startFrame % command.sound.frames : 0;
+				voice.source = command.source;
+				voice.loop = command.loop;
+				voice.gain = command.gain;
+				voice.pan = command.pan;
+				panGains(voice.gain, voice.pan, voice.targetL, voice.targetR);
+				// a sound resumed in the middle fades in over the first block instead of clicking
+				voice.currentL = voice.position ? 0.0f : voice.targetL;
+				voice.currentR = voice.position ? 0.0f : voice.targetR;
+				m_active[m_activeCount++] = static_cast<Uint16>(slot);
+				break;
+			}
+			case CommandType::Stop:
+				if(Voice* voice = find(command.voice)) {
+					voice->stopping = true;
+					voice->targetL = voice->targetR = 0.0f;
+				}
+				break;
+			case CommandType::SetGain:
+				if(Voice* voice = find(command.voice)) {
+					voice->gain = command.gain;
+					panGains(voice->gain, voice->pan, voice->targetL, voice->targetR);
+				}
+				break;
+			case CommandType::SetPan:
+				if(Voice* voice = find(command.voice)) {
+					voice->pan = command.pan;
+					panGains(voice->gain, voice->pan, voice->targetL, voice->targetR);
+				}
+				break;
+			case CommandType::StopAll:
+				for(size_t i = 0; i < m_activeCount; ++i) {
+					Voice& voice = m_voices[m_active[i]];
+					voice.stopping = true;
+					voice.targetL = voice.targetR = 0.0f;
+				}
+				break;
+			case CommandType::SetMasterGain:
+				m_masterGain = command.gain;
+				break;
+			}
+		}
+	}
+
+	// mixes frames of the voice starting at offset, returns false when the voice ran out
+	bool mixVoice(Voice& voice, float* out, size_t frames)
+	{
+		const float stepL = (voice.targetL - voice.currentL) / frames;
+		const float stepR = (voice.targetR - voice.currentR) / frames;
+		float gainL = voice.currentL;
+		float gainR = voice.currentR;
+		bool playing = true;
+
+		size_t done = 0;
+		while(done < frames) {
+			size_t count = frames - done;
+			const float* in;
+			Uint8 channels;
+			if(voice.source) {
+				count = voice.source->render(m_scratch.data(), count);
+				in = m_scratch.data();
+				channels = 2;
+				if(count < frames - done) {
+					playing = false;
+				}
+			}
+			else {
+				count = std::min<size_t>(count, voice.sound.frames - voice.position);
+				in = voice.sound.samples + static_cast<size_t>(voice.position) * voice.sound.channels;
+				channels = voice.sound.channels;
+				voice.position += static_cast<Uint32>(count);
+				if(voice.position == voice.sound.frames) {
+					if(voice.loop) {
+						voice.position = 0;
+					}
+					else {
+						playing = false;
+					}
+				}
+			}
+			if(channels == 1) {
+				kernels::mixMonoToStereo(out + done * Channels, in, count, gainL, gainR, stepL, stepR);
+			}
+			else {
+				kernels::mixStereo(out + done * Channels, in, count, gainL, gainR, stepL, stepR);
+			}
+			gainL += stepL * count;
+			gainR += stepR * count;
+			done += count;
+			if(!playing) {
+				break;
+			}
+		}
+		voice.currentL = voice.targetL;
+		voice.currentR = voice.targetR;
+		return playing && !voice.stopping;
+	}
+
+	void renderBlock(float* out, size_t frames)
+	{
+		kernels::clear(out, frames * Channels);
+		for(size_t i = 0; i < m_activeCount;) {
+			const size_t slot = m_active[i];
+			Voice& voice = m_voices[slot];
+			if(mixVoice(voice, out, frames)) {
+				++i;
+				continue;
+			}
+			// hand the slot back to the game thread and keep the active list dense
+			m_finished[slot].store(voice.generation, std::memory_order_release);
+			voice.generation = 0;
+			voice.source = nullptr;
+			m_active[i] = m_active[--m_activeCount];
+		}
+		kernels::scaleAndClip(out, frames * Channels, m_masterGain);
+	}
+
+	Concurrency::SpscRingBuffer<Command> m_commands;
+	std::atomic<size_t> m_dropped{ 0 };
+	std::atomic<size_t> m_activeVoices{ 0 };
+
+	// game thread side
+	std::array<Uint32, MaxVoices> m_issued;
+	size_t m_nextSlot = 0;
+
+	// written by the audio thread when a voice ends
+	std::array<std::atomic<Uint32>, MaxVoices> m_finished;
+
+	// audio thread side
+	std::array<Voice, MaxVoices> m_voices;
+	std::array<Uint16, MaxVoices> m_active;
+	size_t m_activeCount = 0;
+	std::vector<float> m_scratch;
+	const size_t m_maxBlockFrames;
+	float m_masterGain = 1.0f;
+};
+
+}
+}
@@ -0,0 +1,415 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "Engine/Audio/Kernels.h"
+#include "Engine/Audio/Mixer.h"
+
+namespace Engine {
+namespace Audio {
+
+// Oscillators keep their phase in a Uint32 where the whole range is one period, so the phase wraps
+// exactly and never loses precision, no matter how long a sound runs.
+inline Uint32 phaseIncrement(double frequency, int sampleRate)
+{
+	double cycles = frequency / sampleRate;
+	cycles -= std::floor(cycles);
+	return static_cast<Uint32>(cycles * 4294967296.0);
+}
+
+// One period of a waveform, stored once per octave with only the harmonics that stay below
+// Nyquist in that octave, so high notes do not alias.
+class Wavetable
+{
+public:
+	static constexpr int SizeBits = 11;
+	static constexpr Uint32 Size = 1u << SizeBits;
+	static constexpr int Levels = SizeBits;
+
+	// amplitude(n) is the sine amplitude of harmonic n, starting at 1
+	template<typename Amplitude>
+	static Wavetable additive(Amplitude amplitude)
+	{
+		Wavetable table;
+		std::vector<double> sine(Size);
+		const double pi = std::acos(-1.0);
+		for(Uint32 i = 0; i < Size; ++i) {
+			sine[i] = std::sin(2.0 * pi * i / Size);
+		}
+		std::vector<double> level(Size);
+		double scale = 0.0;
+		for(int l = 0; l < Levels; ++l) {
+			std::fill(level.begin(), level.end(), 0.0);
+			const Uint32 harmonics = (Size / 2) >> l;
+			for(Uint32 n = 1; n <= harmonics; ++n) {
+				const double a = amplitude(n);
+				if(a == 0.0) {
+					continue;
+				}
+				// sin(2 pi n i / Size) is a lookup into the fundamental
+				for(Uint32 i = 0; i < Size; ++i) {
+					level[i] += a * sine[(n * i) & (Size - 1)];
+				}
+			}
+			// all levels share the scale of the richest one, so notes keep their loudness across octaves
+			if(l == 0) {
+				for(double v : level) {
+					scale = std::max(scale, std::abs(v));
+				}
+				scale = scale > 0.0 ? 1.0 / scale : 0.0;
+			}
+			float* out = table.m_samples.data() + l * (Size + 1);
+			for(Uint32 i = 0; i < Size; ++i) {
+				out[i] = static_cast<float>(level[i] * scale);
+			}
+			// guard sample for the interpolation
+			out[Size] = out[0];
+		}
+		return table;
+	}
+
+	static Wavetable sine()
+	{
+		return additive([](Uint32 n) { return n == 1 ? 1.0 : 0.0; });
+	}
+
+	static Wavetable saw()
+	{
+		return additive([](Uint32 n) { return 1.0 / n; });
+	}
+
+	static Wavetable square()
+	{
+		return additive([](Uint32 n) { return n % 2 ? 1.0 / n : 0.0; });
+	}
+
+	static Wavetable triangle()
+	{
+		return additive([](Uint32 n) { return n % 2 ? ((n / 2) % 2 ? -1.0 : 1.0) / (static_cast<double>(n) * n) : 0.0; });
+	}
+
+	// the table for a phase increment, Size + 1 samples
+	const float* forIncrement(Uint32 increment) const
+	{
+		// the highest harmonic that stays below Nyquist at this pitch
+		const Uint32 maxHarmonic = increment ? 0x80000000u / increment : Size;
+		int l = 0;
+		while(l + 1 < Levels && ((Size / 2) >> l) > maxHarmonic) {
+			++l;
+		}
+		return m_samples.data() + l * (Size + 1);
+	}
+
+private:
+	Wavetable()
+	: m_samples(Levels * (Size + 1))
+	{
+	}
+
+	std::vector<float> m_samples;
+};
+
+// Reads a wavetable with linear interpolation. The table has to outlive the oscillator.
+class WavetableOscillator
+{
+public:
+	WavetableOscillator(const Wavetable& table, double frequency, int sampleRate)
+	: m_table(&table)
+	, m_sampleRate(sampleRate)
+	, m_increment(phaseIncrement(frequency, sampleRate))
+	{
+	}
+
+	void setFrequency(double frequency)
+	{
+		m_increment = phaseIncrement(frequency, m_sampleRate);
+	}
+
+	void reset(Uint32 phase = 0)
+	{
+		m_phase = phase;
+	}
+
+	// writes frames mono samples
+	void render(float* out, size_t frames, float gain = 1.0f)
+	{
+		process<false>(out, frames, gain);
+	}
+
+	// adds frames mono samples, for summing many oscillators into one buffer
+	void mix(float* out, size_t frames, float gain = 1.0f)
+	{
+		process<true>(out, frames, gain);
+	}
+
+private:
+	static constexpr int FractionBits = 16;
+	static constexpr int IndexShift = 32 - Wavetable::SizeBits;
+
+	template<bool Add>
+	void process(float* out, size_t frames, float gain)
+	{
+		const float* table = m_table->forIncrement(m_increment);
+		Uint32 phase = m_phase;
+		size_t i = 0;
+#if ENGINE_AUDIO_SSE2
+		const __m128i step = _mm_set1_epi32(static_cast<int>(m_increment * 4));
+		__m128i phases = _mm_setr_epi32(static_cast<int>(phase), static_cast<int>(phase + m_increment), static_cast<int>(phase + 2 * m_increment), static_cast<int>(phase + 3 * m_increment));
+		const __m128i fractionMask = _mm_set1_epi32((1 << FractionBits) - 1);
+		const __m128 fractionScale = _mm_set1_ps(1.0f / (1 << FractionBits));
+		const __m128 g = _mm_set1_ps(gain);
+		alignas(16) Uint32 index[4];
+		for(; i + 4 <= frames; i += 4) {
+			_mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_srli_epi32(phases, IndexShift));
+			const __m128 fraction = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(phases, IndexShift - FractionBits), fractionMask)), fractionScale);
+			// SSE2 has no gather, the four table reads stay scalar
+			const __m128 a = _mm_setr_ps(table[index[0]], table[index[1]], table[index[2]], table[index[3]]);
+			const __m128 b = _mm_setr_ps(table[index[0] + 1], table[index[1] + 1], table[index[2] + 1], table[index[3] + 1]);
+			__m128 value = _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fraction)), g);
+			if(Add) {
+				value = _mm_add_ps(value, _mm_loadu_ps(out + i));
+			}
+			_mm_storeu_ps(out + i, value);
+			phases = _mm_add_epi32(phases, step);
+		}
+		phase += static_cast<Uint32>(i) * m_increment;
+#endif
+		for(; i < frames; ++i) {
+			const Uint32 index = phase >> IndexShift;
+			const float fraction = ((phase >> (IndexShift - FractionBits)) & ((1 << FractionBits) - 1)) * (1.0f / (1 << FractionBits));
+			const float value = (table[index] + (table[index + 1] - table[index]) * fraction) * gain;
+			out[i] = Add ? out[i] + value : value;
+			phase += m_increment;
+		}
+		m_phase = phase;
+	}
+
+	const Wavetable* m_table;
+	int m_sampleRate;
+	Uint32 m_increment;
+	Uint32 m_phase = 0;
+};
+
+// Saw and pulse waves computed directly, with the discontinuities smoothed by a polynomial
+// band-limited step (PolyBLEP). Cheaper than wavetables to modulate, e.g. for pulse width sweeps.
+class BlepOscillator
+{
+public:
+	enum class Shape { Saw, Pulse };
+
+	BlepOscillator(Shape shape, double frequency, int sampleRate)
+	: m_shape(shape)
+	, m_sampleRate(sampleRate)
+	, m_increment(phaseIncrement(frequency, sampleRate))
+	{
+	}
+
+	void setFrequency(double frequency)
+	{
+		m_increment = phaseIncrement(frequency, m_sampleRate);
+	}
+
+	// share of the period the pulse is high, 0.5 is a square
+	void setPulseWidth(float width)
+	{
+		m_width = std::min(std::max(width, 0.01f), 0.99f);
+	}
+
+	void reset(Uint32 phase = 0)
+	{
+		m_phase = phase;
+	}
+
+	void render(float* out, size_t frames, float gain = 1.0f)
+	{
+		process<false>(out, frames, gain);
+	}
+
+	void mix(float* out, size_t frames, float gain = 1.0f)
+	{
+		process<true>(out, frames, gain);
+	}
+
+private:
+	// the phase as a float in [0, 1), 24 bits are all a float holds exactly
+	static constexpr float PhaseScale = 1.0f / 16777216.0f;
+
+	static float blep(float t, float dt, float inverseDt)
+	{
+		if(t < dt) {
+			const float x = t * inverseDt;
+			return x + x - x * x - 1.0f;
+		}
+		if(t > 1.0f - dt) {
+			const float x = (t - 1.0f) * inverseDt;
+			return x * x + x + x + 1.0f;
+		}
+		return 0.0f;
+	}
+
+	float sample(float t, float dt, float inverseDt) const
+	{
+		if(m_shape == Shape::Saw) {
+			return 2.0f * t - 1.0f - blep(t, dt, inverseDt);
+		}
+		float t2 = t - m_width;
+		if(t2 < 0.0f) {
+			t2 += 1.0f;
+		}
+		return (t < m_width ? 1.0f : -1.0f) + blep(t, dt, inverseDt) - blep(t2, dt, inverseDt);
+	}
+
+#if ENGINE_AUDIO_SSE2
+	static __m128 blep(__m128 t, __m128 dt, __m128 inverseDt)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 x1 = _mm_mul_ps(t, inverseDt);
+		const __m128 rising = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(x1, x1), _mm_mul_ps(x1, x1)), one);
+		const __m128 x2 = _mm_mul_ps(_mm_sub_ps(t, one), inverseDt);
+		const __m128 falling = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x2, x2), _mm_add_ps(x2, x2)), one);
+		return _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(t, dt), rising), _mm_and_ps(_mm_cmpgt_ps(t, _mm_sub_ps(one, dt)), falling));
+	}
+#endif
+
+	template<bool Add>
+	void process(float* out, size_t frames, float gain)
+	{
+		const float dt = (m_increment >> 8) * PhaseScale;
+		const float inverseDt = dt > 0.0f ? 1.0f / dt : 0.0f;
+		Uint32 phase = m_phase;
+		size_t i = 0;
+#if ENGINE_AUDIO_SSE2
+		const __m128i step = _mm_set1_epi32(static_cast<int>(m_increment * 4));
+		__m128i phases = _mm_setr_epi32(static_cast<int>(phase), static_cast<int>(phase + m_increment), static_cast<int>(phase + 2 * m_increment), static_cast<int>(phase + 3 * m_increment));
+		const __m128 vdt = _mm_set1_ps(dt);
+		const __m128 vinverseDt = _mm_set1_ps(inverseDt);
+		const __m128 scale = _mm_set1_ps(PhaseScale);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 width = _mm_set1_ps(m_width);
+		const __m128 g = _mm_set1_ps(gain);
+		for(; i + 4 <= frames; i += 4) {
+			const __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(phases, 8)), scale);
+			__m128 value;
+			if(m_shape == Shape::Saw) {
+				value = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(t, t), one), blep(t, vdt, vinverseDt));
+			}
+			else {
+				const __m128 high = _mm_cmplt_ps(t, width);
+				const __m128 t2 = _mm_add_ps(_mm_sub_ps(t, width), _mm_and_ps(high, one));
+				const __m128 naive = _mm_or_ps(_mm_and_ps(high, one), _mm_andnot_ps(high, _mm_set1_ps(-1.0f)));
+				value = _mm_sub_ps(_mm_add_ps(naive, blep(t, vdt, vinverseDt)), blep(t2, vdt, vinverseDt));
+			}
+			value = _mm_mul_ps(value, g);
+			if(Add) {
+				value = _mm_add_ps(value, _mm_loadu_ps(out + i));
+			}
+			_mm_storeu_ps(out + i, value);
+			phases = _mm_add_epi32(phases, step);
+		}
+		phase += static_cast<Uint32>(i) * m_increment;
+#endif
+		for(; i < frames; ++i) {
+			const float value = sample((phase >> 8) * PhaseScale, dt, inverseDt) * gain;
+			out[i] = Add ? out[i] + value : value;
+			phase += m_increment;
+		}
+		m_phase = phase;
+	}
+
+	Shape m_shape;
+	int m_sampleRate;
+	Uint32 m_increment;
+	Uint32 m_phase = 0;
+	float m_width = 0.5f;
+};
+
+// Plays an oscillator as a mixer voice with short fades at both ends, optionally sweeping
+// exponentially from its start to an end frequency. A duration of 0 plays until the voice is stopped.
+template<typename Oscillator>
+class OscillatorSource : public IVoiceSource
+{
+public:
+	OscillatorSource(Oscillator oscillator, double frequency, int sampleRate, double duration = 0.0, size_t maxBlockFrames = 1024)
+	: m_oscillator(std::move(oscillator))
+	, m_mono(maxBlockFrames)
+	, m_sampleRate(sampleRate)
+	, m_startFrequency(frequency)
+	, m_endFrequency(frequency)
+	, m_frames(static_cast<size_t>(duration * sampleRate))
+	, m_fadeFrames(static_cast<size_t>(0.005 * sampleRate))
+	{
+	}
+
+	void sweepTo(double frequency)
+	{
+		m_endFrequency = frequency;
+	}
+
+	Oscillator& oscillator()
+	{
+		return m_oscillator;
+	}
+
+	// starts over, only while no voice plays this source
+	void reset()
+	{
+		m_position = 0;
+		m_oscillator.reset();
+		m_oscillator.setFrequency(m_startFrequency);
+	}
+
+	size_t render(float* stereo, size_t frames) override
+	{
+		size_t done = 0;
+		while(done < frames) {
+			size_t count = std::min(frames - done, m_mono.size());
+			if(m_frames) {
+				count = std::min(count, m_frames - m_position);
+				if(count == 0) {
+					break;
+				}
+				if(m_endFrequency != m_startFrequency) {
+					// one frequency per block is plenty for effect sweeps
+					const double progress = static_cast<double>(m_position) / m_frames;
+					m_oscillator.setFrequency(m_startFrequency * std::pow(m_endFrequency / m_startFrequency, progress));
+				}
+			}
+			m_oscillator.render(m_mono.data(), count);
+			for(size_t i = 0; i < count; ++i) {
+				const float value = m_mono[i] * envelope(m_position + i);
+				stereo[2 * (done + i)] = value;
+				stereo[2 * (done + i) + 1] = value;
+			}
+			m_position += count;
+			done += count;
+		}
+		return done;
+	}
+
+private:
+	float envelope(size_t frame) const
+	{
+		float level = 1.0f;
+		if(frame < m_fadeFrames) {
+			level = static_cast<float>(frame) / m_fadeFrames;
+		}
+		if(m_frames && m_frames - frame < m_fadeFrames) {
+			level = std::min(level, static_cast<float>(m_frames - frame) / m_fadeFrames);
+		}
+		return level;
+	}
+
+	Oscillator m_oscillator;
+	std::vector<float> m_mono;
+	int m_sampleRate;
+	double m_startFrequency;
+	double m_endFrequency;
+	size_t m_frames;
+	size_t m_fadeFrames;
+	size_t m_position = 0;
+};
+
+}
+}
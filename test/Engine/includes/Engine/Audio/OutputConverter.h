@@ -0,0 +1,149 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Audio/AudioFormat.h"
+#include "Engine/Audio/Kernels.h"
+#include "Engine/Audio/Resampler.h"
+
+namespace Engine {
+namespace Audio {
+
+// Sits between a stereo float renderer running at its own rate, usually the mixer, and the device
+// in whatever format AudioDevice::open obtained: resamples, maps stereo to the device's channels
+// (mono gets the average, further channels stay silent) and converts to F32, S16 or S32. Works as
+// the device callback or pushes blocks with SDL_QueueAudio from the game thread.
+class OutputConverter
+{
+public:
+	OutputConverter(int sourceRate, const AudioFormat& device, RenderFunc render, void* userdata, size_t maxBlockFrames = 4096)
+	: m_device(device)
+	, m_render(render)
+	, m_userdata(userdata)
+	, m_maxBlock(maxBlockFrames)
+	, m_stereo(maxBlockFrames * 2)
+	, m_queueBuffer(static_cast<size_t>(device.blockFrames) * device.bytesPerFrame())
+	{
+		if(sourceRate != device.sampleRate) {
+			m_resampler.reset(new PolyphaseResampler(sourceRate, device.sampleRate, maxBlockFrames));
+		}
+		if(device.channels != 2) {
+			m_channelBuffer.resize(maxBlockFrames * device.channels);
+		}
+	}
+
+	OutputConverter(const OutputConverter&) = delete;
+	OutputConverter& operator=(const OutputConverter&) = delete;
+
+	// the device formats we can write, open with fewer allowed changes for anything else
+	static bool supports(SDL_AudioFormat format)
+	{
+		return format == AUDIO_F32SYS || format == AUDIO_S16SYS || format == AUDIO_S32SYS;
+	}
+
+	const AudioFormat& deviceFormat() const
+	{
+		return m_device;
+	}
+
+	// fills bytes of device format audio
+	void render(Uint8* stream, size_t bytes)
+	{
+		size_t frames = bytes / m_device.bytesPerFrame();
+		while(frames > 0) {
+			const size_t block = std::min(frames, m_maxBlock);
+			renderBlock(stream, block);
+			stream += block * m_device.bytesPerFrame();
+			frames -= block;
+		}
+	}
+
+	// SDL_AudioCallback, userdata is the converter
+	static void SDLCALL callback(void* userdata, Uint8* stream, int length)
+	{
+		static_cast<OutputConverter*>(userdata)->render(stream, static_cast<size_t>(length));
+	}
+
+	// For devices opened without a callback: queues blocks until at least targetBytes are waiting
+	// in the device. Call it every frame with a target of a few blocks. Returns the bytes queued.
+	size_t queue(ReSDL::AudioDevice& device, Uint32 targetBytes)
+	{
+		size_t queued = 0;
+		Uint32 waiting = static_cast<Uint32>(device.getQueuedAudioSize());
+		while(waiting < targetBytes) {
+			render(m_queueBuffer.data(), m_queueBuffer.size());
+			device.queueAudio(m_queueBuffer.data(), static_cast<Uint32>(m_queueBuffer.size()));
+			waiting += static_cast<Uint32>(m_queueBuffer.size());
+			queued += m_queueBuffer.size();
+		}
+		return queued;
+	}
+
+private:
+	void renderBlock(Uint8* out, size_t frames)
+	{
+		// stereo float at the device rate, straight into the stream if that is all the device wants
+		const bool direct = m_device.format == AUDIO_F32SYS && m_device.channels == 2;
+		float* stereo = direct ? reinterpret_cast<float*>(out) : m_stereo.data();
+		if(m_resampler) {
+			m_resampler->process(stereo, frames, m_render, m_userdata);
+		}
+		else {
+			m_render(m_userdata, stereo, frames);
+		}
+		if(direct) {
+			return;
+		}
+
+		const float* samples = stereo;
+		if(m_device.channels != 2) {
+			float* mapped = m_channelBuffer.data();
+			const int channels = m_device.channels;
+			if(channels == 1) {
+				for(size_t i = 0; i < frames; ++i) {
+					mapped[i] = 0.5f * (stereo[2 * i] + stereo[2 * i + 1]);
+				}
+			}
+			else {
+				// every SDL layout with more than two channels starts with front left and right
+				kernels::clear(mapped, frames * channels);
+				for(size_t i = 0; i < frames; ++i) {
+					mapped[i * channels] = stereo[2 * i];
+					mapped[i * channels + 1] = stereo[2 * i + 1];
+				}
+			}
+			samples = mapped;
+		}
+
+		const size_t count = frames * m_device.channels;
+		switch(m_device.format) {
+		case AUDIO_S16SYS:
+			kernels::floatToS16(samples, reinterpret_cast<Sint16*>(out), count);
+			break;
+		case AUDIO_S32SYS:
+			kernels::floatToS32(samples, reinterpret_cast<Sint32*>(out), count);
+			break;
+		case AUDIO_F32SYS:
+			std::copy(samples, samples + count, reinterpret_cast<float*>(out));
+			break;
+		default:
+			std::fill(out, out + count * m_device.bytesPerSample(), Uint8(0));
+			break;
+		}
+	}
+
+	AudioFormat m_device;
+	RenderFunc m_render;
+	void* m_userdata;
+	const size_t m_maxBlock;
+	std::unique_ptr<PolyphaseResampler> m_resampler;
+	std::vector<float> m_stereo;
+	std::vector<float> m_channelBuffer;
+	std::vector<Uint8> m_queueBuffer;
+};
+
+}
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+#include "Engine/Audio/Kernels.h"
+
+namespace Engine {
+namespace Audio {
+
+// pulls interleaved stereo frames from whatever feeds a converter, e.g. Mixer::render
+using RenderFunc = void (*)(void* userdata, float* stereo, size_t frames);
+
+// Converts interleaved stereo between two sample rates with a polyphase windowed sinc filter.
+// The rate ratio is reduced to up / down; each of the up phases has its own set of taps, so every
+// output sample is two dot products. Ratios that need more than MaxPhases phases are rounded to
+// the nearest one that does not, which changes the pitch by less than 0.1%.
+class PolyphaseResampler
+{
+public:
+	static constexpr Uint32 MaxPhases = 1024;
+
+	PolyphaseResampler(int inputRate, int outputRate, size_t maxOutputFrames = 4096, int taps = 32)
+	: m_taps(static_cast<size_t>((std::max(taps, 8) + 3) / 4 * 4))
+	, m_maxOutput(maxOutputFrames)
+	{
+		const int divisor = std::gcd(inputRate, outputRate);
+		m_up = static_cast<Uint32>(outputRate / divisor);
+		m_down = static_cast<Uint32>(inputRate / divisor);
+		if(m_up > MaxPhases) {
+			m_down = static_cast<Uint32>(std::lround(static_cast<double>(MaxPhases) * inputRate / outputRate));
+			m_up = MaxPhases;
+		}
+		buildFilter();
+		const size_t capacity = static_cast<size_t>(maxOutputFrames) * m_down / m_up + 2 * m_taps + 2;
+		m_left.resize(capacity);
+		m_right.resize(capacity);
+		m_pulled.resize(capacity * 2);
+		reset();
+	}
+
+	// forgets the signal so far, the filter starts from silence
+	void reset()
+	{
+		std::fill(m_left.begin(), m_left.end(), 0.0f);
+		std::fill(m_right.begin(), m_right.end(), 0.0f);
+		m_filled = m_taps / 2;
+		m_phase = 0;
+	}
+
+	double ratio() const
+	{
+		return static_cast<double>(m_up) / m_down;
+	}
+
+	// writes frames stereo frames at the output rate, pulling as many input frames as that takes
+	void process(float* out, size_t frames, RenderFunc pull, void* userdata)
+	{
+		while(frames > 0) {
+			const size_t block = std::min(frames, m_maxOutput);
+			processBlock(out, block, pull, userdata);
+			out += block * 2;
+			frames -= block;
+		}
+	}
+
+private:
+	static double besselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for(int k = 1; k < 32; ++k) {
+			term *= (x / (2 * k)) * (x / (2 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// phase p interpolates at p / up input samples past the middle of its taps
+	void buildFilter()
+	{
+		const double pi = std::acos(-1.0);
+		const double beta = 8.0;
+		// cut off a little below the lower Nyquist frequency, in cycles per input sample
+		const double cutoff = 0.5 * std::min(1.0, static_cast<double>(m_up) / m_down) * 0.92;
+		const double half = static_cast<double>(m_taps) / 2;
+		m_coefficients.resize(m_up * m_taps);
+		for(Uint32 p = 0; p < m_up; ++p) {
+			float* phase = &m_coefficients[p * m_taps];
+			double sum = 0.0;
+			for(size_t k = 0; k < m_taps; ++k) {
+				const double t = static_cast<double>(k) - (half - 1) - static_cast<double>(p) / m_up;
+				const double x = 2.0 * cutoff * t;
+				const double sinc = std::abs(x) < 1e-9 ? 1.0 : std::sin(pi * x) / (pi * x);
+				const double w = t / half;
+				const double window = std::abs(w) < 1.0 ? besselI0(beta * std::sqrt(1.0 - w * w)) / besselI0(beta) : 0.0;
+				phase[k] = static_cast<float>(sinc * window);
+				sum += phase[k];
+			}
+			// unity gain for every phase, so there is no ripple at the phase rate
+			for(size_t k = 0; k < m_taps; ++k) {
+				phase[k] = static_cast<float>(phase[k] / sum);
+			}
+		}
+	}
+
+	void processBlock(float* out, size_t frames, RenderFunc pull, void* userdata)
+	{
+		// input frames the window of the last output reaches, and the frames all outputs step over
+		const Uint64 last = m_phase + static_cast<Uint64>(frames - 1) * m_down;
+		const Uint64 end = m_phase + static_cast<Uint64>(frames) * m_down;
+		const size_t needed = std::max(static_cast<size_t>(last / m_up) + m_taps, static_cast<size_t>(end / m_up));
+		if(needed > m_filled) {
+			const size_t count = needed - m_filled;
+			pull(userdata, m_pulled.data(), count);
+			for(size_t i = 0; i < count; ++i) {
+				m_left[m_filled + i] = m_pulled[2 * i];
+				m_right[m_filled + i] = m_pulled[2 * i + 1];
+			}
+			m_filled = needed;
+		}
+
+		Uint64 position = m_phase;
+		for(size_t i = 0; i < frames; ++i, position += m_down) {
+			const size_t index = static_cast<size_t>(position / m_up);
+			const float* taps = &m_coefficients[(position % m_up) * m_taps];
+			out[2 * i] = kernels::dot(&m_left[index], taps, m_taps);
+			out[2 * i + 1] = kernels::dot(&m_right[index], taps, m_taps);
+		}
+
+		// drop the consumed input and keep the rest for the next block
+		const size_t consumed = static_cast<size_t>(end / m_up);
+		std::copy(m_left.begin() + consumed, m_left.begin() + m_filled, m_left.begin());
+		std::copy(m_right.begin() + consumed, m_right.begin() + m_filled, m_right.begin());
+		m_filled -= consumed;
+		m_phase = static_cast<Uint32>(end % m_up);
+	}
+
+	const size_t m_taps;
+	const size_t m_maxOutput;
+	Uint32 m_up;
+	Uint32 m_down;
+	std::vector<float> m_coefficients;
+	// input history, one array per channel so the taps are contiguous
+	std::vector<float> m_left;
+	std::vector<float> m_right;
+	std::vector<float> m_pulled;
+	size_t m_filled = 0;
+	Uint32 m_phase = 0;
+};
+
+}
+}
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/IO/MappedFile.h"
+#include "Engine/Audio/Mixer.h"
+#include "Engine/Audio/WaveFile.h"
+#include "Engine/Audio/Resampler.h"
+
+namespace Engine {
+namespace Audio {
+
+// Bank layout: a header, a table of entries, a hash table of entry indices, the names and then
+// the samples of every sound. Samples are float PCM at the bank's rate, mono or interleaved
+// stereo, exactly what the mixer reads, and every sound starts on a 64 byte boundary. Names are
+// looked up by their 64 bit FNV-1a hash with linear probing in a table at most half full. All
+// numbers are in the byte order of the machine that built the bank; the header records it.
+namespace detail {
+	constexpr char SoundBankMagic[4] = { 'R', 'S', 'S', 'B' };
+	constexpr uint32_t SoundBankVersion = 1;
+	constexpr uint32_t SoundBankByteOrder = 0x01020304;
+	constexpr size_t SoundBankAlignment = 64;
+
+	struct SoundBankHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint32_t sampleRate;
+		uint32_t count;
+		// a power of two, at least twice count
+		uint32_t slots;
+		uint64_t entriesOffset;
+		uint64_t slotsOffset;
+		uint64_t namesOffset;
+		uint64_t size;
+	};
+
+	struct SoundBankEntry
+	{
+		uint64_t hash;
+		uint64_t samplesOffset;
+		uint32_t frames;
+		uint32_t nameOffset;
+		uint16_t nameLength;
+		uint8_t channels;
+		uint8_t reserved[5];
+	};
+
+	static_assert(sizeof(SoundBankHeader) == 56, "the header is part of the file format");
+	static_assert(sizeof(SoundBankEntry) == 32, "entries are part of the file format");
+
+	inline size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+// stable across runs and builds, so the game can hash names ahead of time
+constexpr uint64_t soundNameHash(const char* name, size_t length)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for(size_t i = 0; i < length; ++i) {
+		hash = (hash ^ static_cast<uint8_t>(name[i])) * 1099511628211ull;
+	}
+	return hash;
+}
+
+inline uint64_t soundNameHash(const std::string& name)
+{
+	return soundNameHash(name.data(), name.size());
+}
+
+// Collects sounds, converts them to float PCM at the bank's sample rate and writes a bank.
+// All the decoding and resampling happens here, at build time.
+class SoundBankBuilder
+{
+public:
+	// use the rate the mixer runs at, e.g. Engine::mixRate
+	explicit SoundBankBuilder(int sampleRate)
+	: m_sampleRate(sampleRate)
+	{
+	}
+
+	// mono files stay mono, all others become stereo
+	void add(const std::string& name, const WaveFile& wave)
+	{
+		std::vector<float> stereo(wave.frames() * 2);
+		wave.readStereo(0, wave.frames(), stereo.data());
+		if(wave.channels() == 1) {
+			std::vector<float> mono(wave.frames());
+			for(size_t i = 0; i < mono.size(); ++i) {
+				mono[i] = stereo[2 * i];
+			}
+			add(name, mono.data(), mono.size(), 1, static_cast<int>(wave.sampleRate()));
+			return;
+		}
+		add(name, stereo.data(), wave.frames(), 2, static_cast<int>(wave.sampleRate()));
+	}
+
+	// samples are interleaved float with one or two channels
+	void add(const std::string& name, const float* samples, size_t frames, int channels, int sampleRate)
+	{
+		if(channels < 1 || channels > 2) {
+			throw std::runtime_error("sound bank: " + name + " has to be mono or stereo");
+		}
+		if(name.size() > 0xFFFF) {
+			throw std::runtime_error("sound bank: the name " + name.substr(0, 32) + "... is too long");
+		}
+		const uint64_t hash = soundNameHash(name);
+		for(const Pending& sound : m_sounds) {
+			if(sound.hash == hash) {
+				throw std::runtime_error("sound bank: " + name + (sound.name == name ? " was added twice" : " has the same hash as " + sound.name));
+			}
+		}
+		Pending sound;
+		sound.name = name;
+		sound.hash = hash;
+		sound.channels = static_cast<uint8_t>(channels);
+		if(sampleRate == m_sampleRate) {
+			sound.samples.assign(samples, samples + frames * channels);
+		}
+		else {
+			sound.samples = resample(samples, frames, channels, sampleRate);
+		}
+		sound.frames = sound.samples.size() / channels;
+		if(sound.frames > UINT32_MAX) {
+			throw std::runtime_error("sound bank: " + name + " is too long");
+		}
+		m_sounds.push_back(std::move(sound));
+	}
+
+	size_t size() const
+	{
+		return m_sounds.size();
+	}
+
+	void write(const std::string& path) const
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if(!file) {
+			throw std::runtime_error("could not open sound bank " + path);
+		}
+		write(file);
+		if(!file) {
+			throw std::runtime_error("could not write sound bank " + path);
+		}
+	}
+
+	void write(std::ostream& out) const
+	{
+		using namespace detail;
+		SoundBankHeader header{};
+		std::memcpy(header.magic, SoundBankMagic, sizeof(header.magic));
+		header.version = SoundBankVersion;
+		header.byteOrder = SoundBankByteOrder;
+		header.sampleRate = static_cast<uint32_t>(m_sampleRate);
+		header.count = static_cast<uint32_t>(m_sounds.size());
+		header.slots = 2;
+		while(header.slots < 2 * header.count) {
+			header.slots *= 2;
+		}
+		header.entriesOffset = sizeof(SoundBankHeader);
+		header.slotsOffset = header.entriesOffset + header.count * sizeof(SoundBankEntry);
+		header.namesOffset = header.slotsOffset + header.slots * sizeof(uint32_t);
+
+		std::vector<SoundBankEntry> entries(m_sounds.size());
+		std::vector<uint32_t> slots(header.slots, 0);
+		std::string names;
+		for(size_t i = 0; i < m_sounds.size(); ++i) {
+			const Pending& sound = m_sounds[i];
+			SoundBankEntry& entry = entries[i];
+			entry.hash = sound.hash;
+			entry.frames = static_cast<uint32_t>(sound.frames);
+			entry.channels = sound.channels;
+			entry.nameOffset = static_cast<uint32_t>(names.size());
+			entry.nameLength = static_cast<uint16_t>(sound.name.size());
+			names += sound.name;
+			// slots hold the entry index plus one, zero is empty
+			size_t slot = sound.hash & (header.slots - 1);
+			while(slots[slot]) {
+				slot = (slot + 1) & (header.slots - 1);
+			}
+			slots[slot] = static_cast<uint32_t>(i + 1);
+		}
+		size_t offset = alignUp(header.namesOffset + names.size(), SoundBankAlignment);
+		for(size_t i = 0; i < m_sounds.size(); ++i) {
+			entries[i].samplesOffset = offset;
+			offset = alignUp(offset + m_sounds[i].samples.size() * sizeof(float), SoundBankAlignment);
+		}
+		header.size = offset;
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(SoundBankEntry));
+		out.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(uint32_t));
+		out.write(names.data(), names.size());
+		size_t written = header.namesOffset + names.size();
+		static const char padding[SoundBankAlignment] = {};
+		for(size_t i = 0; i < m_sounds.size(); ++i) {
+			out.write(padding, entries[i].samplesOffset - written);
+			out.write(reinterpret_cast<const char*>(m_sounds[i].samples.data()), m_sounds[i].samples.size() * sizeof(float));
+			written = entries[i].samplesOffset + m_sounds[i].samples.size() * sizeof(float);
+		}
+		out.write(padding, header.size - written);
+	}
+
+private:
+	struct Pending
+	{
+		std::string name;
+		uint64_t hash = 0;
+		uint8_t channels = 1;
+		size_t frames = 0;
+		std::vector<float> samples;
+	};
+
+	struct ResampleInput
+	{
+		const float* samples;
+		size_t frames;
+		int channels;
+		size_t position;
+	};
+
+	// runs past the end with silence, so the filter flushes the tail of the sound
+	static void pull(void* userdata, float* stereo, size_t frames)
+	{
+		auto* input = static_cast<ResampleInput*>(userdata);
+		for(size_t i = 0; i < frames; ++i, ++input->position) {
+			if(input->position < input->frames) {
+				const float* frame = input->samples + input->position * input->channels;
+				stereo[2 * i] = frame[0];
+				stereo[2 * i + 1] = frame[input->channels - 1];
+			}
+			else {
+				stereo[2 * i] = stereo[2 * i + 1] = 0.0f;
+			}
+		}
+	}
+
+	std::vector<float> resample(const float* samples, size_t frames, int channels, int sampleRate) const
+	{
+		PolyphaseResampler resampler(sampleRate, m_sampleRate);
+		ResampleInput input{ samples, frames, channels, 0 };
+		const size_t outFrames = static_cast<size_t>((static_cast<Uint64>(frames) * m_sampleRate + sampleRate - 1) / sampleRate);
+		std::vector<float> stereo(outFrames * 2);
+		resampler.process(stereo.data(), outFrames, &SoundBankBuilder::pull, &input);
+		if(channels == 2) {
+			return stereo;
+		}
+		std::vector<float> mono(outFrames);
+		for(size_t i = 0; i < outFrames; ++i) {
+			mono[i] = stereo[2 * i];
+		}
+		return mono;
+	}
+
+	const int m_sampleRate;
+	std::vector<Pending> m_sounds;
+};
+
+// A memory mapped sound bank. Opening checks the header and nothing else, lookups hash the name
+// and probe the table in the mapping, and the sounds point straight into the mapped samples, so
+// the mixer plays them without any decoding or copying. The bank has to outlive their voices.
+class SoundBank
+{
+public:
+	explicit SoundBank(const std::string& path)
+	: m_file(path)
+	{
+		using namespace detail;
+		if(m_file.size() < sizeof(SoundBankHeader)) {
+			throw std::runtime_error(path + " is not a sound bank");
+		}
+		std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+		if(std::memcmp(m_header.magic, SoundBankMagic, sizeof(m_header.magic)) != 0) {
+			throw std::runtime_error(path + " is not a sound bank");
+		}
+		if(m_header.version != SoundBankVersion || m_header.byteOrder != SoundBankByteOrder) {
+			throw std::runtime_error(path + " was built by another version or for another byte order, rebuild it");
+		}
+		const bool consistent = m_header.size == m_file.size()
+			&& m_header.slots >= 2 && (m_header.slots & (m_header.slots - 1)) == 0 && m_header.slots >= 2ull * m_header.count
+			&& m_header.entriesOffset == sizeof(SoundBankHeader)
+			&& m_header.slotsOffset == m_header.entriesOffset + uint64_t(m_header.count) * sizeof(SoundBankEntry)
+			&& m_header.namesOffset == m_header.slotsOffset + uint64_t(m_header.slots) * sizeof(uint32_t)
+			&& m_header.namesOffset <= m_header.size;
+		if(!consistent) {
+			throw std::runtime_error(path + " is truncated or damaged");
+		}
+		m_entries = reinterpret_cast<const SoundBankEntry*>(m_file.data() + m_header.entriesOffset);
+		m_slots = reinterpret_cast<const uint32_t*>(m_file.data() + m_header.slotsOffset);
+	}
+
+	SoundBank(const SoundBank&) = delete;
+	SoundBank& operator=(const SoundBank&) = delete;
+
+	int sampleRate() const
+	{
+		return static_cast<int>(m_header.sampleRate);
+	}
+
+	size_t size() const
+	{
+		return m_header.count;
+	}
+
+	// an empty sound if the bank has no sound of that name, the mixer ignores those
+	Sound find(const std::string& name) const
+	{
+		const size_t index = indexOf(soundNameHash(name));
+		if(index == npos || this->name(index) != name) {
+			return Sound{};
+		}
+		return at(index);
+	}
+
+	// for names hashed ahead of time with soundNameHash
+	Sound find(uint64_t hash) const
+	{
+		const size_t index = indexOf(hash);
+		return index == npos ? Sound{} : at(index);
+	}
+
+	// an empty sound for indices past the end
+	Sound at(size_t index) const
+	{
+		if(index >= size()) {
+			return Sound{};
+		}
+		const detail::SoundBankEntry& entry = m_entries[index];
+		// a damaged entry gives an empty sound rather than reads outside the mapping
+		if(entry.channels < 1 || entry.channels > 2
+			|| entry.samplesOffset % detail::SoundBankAlignment != 0
+			|| entry.samplesOffset > m_header.size
+			|| uint64_t(entry.frames) * entry.channels * sizeof(float) > m_header.size - entry.samplesOffset) {
+			return Sound{};
+		}
+		Sound sound;
+		sound.samples = reinterpret_cast<const float*>(m_file.data() + entry.samplesOffset);
+		sound.frames = entry.frames;
+		sound.channels = entry.channels;
+		return sound;
+	}
+
+	std::string name(size_t index) const
+	{
+		if(index >= size()) {
+			return std::string();
+		}
+		const detail::SoundBankEntry& entry = m_entries[index];
+		if(m_header.namesOffset + entry.nameOffset + entry.nameLength > m_header.size) {
+			return std::string();
+		}
+		return std::string(reinterpret_cast<const char*>(m_file.data() + m_header.namesOffset + entry.nameOffset), entry.nameLength);
+	}
+
+	// Loads all samples into memory ahead of time. Without it the first playback of a sound
+	// page faults on the audio thread, which can take long enough to miss a deadline.
+	void prefetch() const
+	{
+		m_file.prefetch(0, m_file.size());
+	}
+
+private:
+	static constexpr size_t npos = static_cast<size_t>(-1);
+
+	size_t indexOf(uint64_t hash) const
+	{
+		const uint32_t mask = m_header.slots - 1;
+		for(uint32_t slot = hash & mask, probes = 0; probes < m_header.slots; slot = (slot + 1) & mask, ++probes) {
+			const uint32_t index = m_slots[slot];
+			if(index == 0 || index > m_header.count) {
+				return npos;
+			}
+			if(m_entries[index - 1].hash == hash) {
+				return index - 1;
+			}
+		}
+		return npos;
+	}
+
+	IO::MappedFile m_file;
+	detail::SoundBankHeader m_header{};
+	const detail::SoundBankEntry* m_entries = nullptr;
+	const uint32_t* m_slots = nullptr;
+};
+
+}
+}
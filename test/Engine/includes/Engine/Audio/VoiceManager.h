@@ -0,0 +1,314 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Audio/Mixer.h"
+
+namespace Engine {
+namespace Audio {
+
+// identifies an emitter of one VoiceManager, 0 is never a valid emitter
+using EmitterId = Uint32;
+
+struct VoiceManagerStats
+{
+	size_t emitters = 0;
+	// emitters the mixer plays
+	size_t real = 0;
+	// emitters that only keep time until they are audible enough again
+	size_t virtualized = 0;
+	// emitters too far away or too quiet to play at all
+	size_t inaudible = 0;
+	// since the manager was created
+	size_t promotions = 0;
+	size_t demotions = 0;
+};
+
+// Tracks any number of positioned sound emitters and lets the mixer play only the maxRealVoices
+// most important ones, by priority first and audibility at the listener second. All others are
+// virtual: they cost nothing but a few comparisons per update, and since an emitter's playback
+// position follows from the time it started, a virtual emitter that becomes real again resumes
+// where it would be had it played all along. Game thread only.
+class VoiceManager
+{
+public:
+	explicit VoiceManager(Mixer& mixer, size_t maxRealVoices = 32)
+	: m_mixer(mixer)
+	, m_maxReal(std::min(maxRealVoices, Mixer::MaxVoices / 2))
+	{
+	}
+
+	VoiceManager(const VoiceManager&) = delete;
+	VoiceManager& operator=(const VoiceManager&) = delete;
+
+	// the rate the mixer runs at, sound lengths are in frames at that rate
+	void setSampleRate(int sampleRate)
+	{
+		m_sampleRate = sampleRate;
+	}
+
+	// full volume up to minDistance, silent from maxDistance
+	void setAttenuation(float minDistance, float maxDistance)
+	{
+		m_minDistance = std::max(minDistance, 0.001f);
+		m_maxDistance = std::max(maxDistance, m_minDistance * 1.001f);
+	}
+
+	void setListener(float x, float y)
+	{
+		m_listenerX = x;
+		m_listenerY = y;
+	}
+
+	// starts virtual, the next update decides whether the mixer plays it
+	EmitterId play(const Sound& sound, float x, float y, float gain = 1.0f, int priority = 0, bool loop = false)
+	{
+		if(!sound.samples || !sound.frames) {
+			return 0;
+		}
+		Emitter emitter;
+		emitter.id = m_nextId++;
+		if(m_nextId == 0) {
+			m_nextId = 1;
+		}
+		emitter.sound = sound;
+		emitter.x = x;
+		emitter.y = y;
+		emitter.gain = gain;
+		emitter.priority = priority;
+		emitter.loop = loop;
+		emitter.startedAt = m_time;
+		m_index[emitter.id] = m_emitters.size();
+		m_emitters.push_back(emitter);
+		return emitter.id;
+	}
+
+	void stop(EmitterId id)
+	{
+		auto found = m_index.find(id);
+		if(found != m_index.end()) {
+			erase(found->second);
+		}
+	}
+
+	void stopAll()
+	{
+		for(const Emitter& emitter : m_emitters) {
+			if(emitter.voice) {
+				m_mixer.stop(emitter.voice);
+			}
+		}
+		m_emitters.clear();
+		m_index.clear();
+	}
+
+	void setPosition(EmitterId id, float x, float y)
+	{
+		if(Emitter* emitter = find(id)) {
+			emitter->x = x;
+			emitter->y = y;
+		}
+	}
+
+	void setGain(EmitterId id, float gain)
+	{
+		if(Emitter* emitter = find(id)) {
+			emitter->gain = gain;
+		}
+	}
+
+	bool isPlaying(EmitterId id) const
+	{
+		return m_index.count(id) != 0;
+	}
+
+	// true while the mixer plays the emitter
+	bool isReal(EmitterId id) const
+	{
+		auto found = m_index.find(id);
+		return found != m_index.end() && m_emitters[found->second].voice != 0;
+	}
+
+	// Advances time by the frame's duration, drops finished emitters and hands the mixer the
+	// most important ones. The work is linear in the number of emitters, the mixer never gets
+	// more than maxRealVoices.
+	void update(double seconds)
+	{
+		m_time += seconds;
+
+		m_candidates.clear();
+		for(size_t i = 0; i < m_emitters.size();) {
+			Emitter& emitter = m_emitters[i];
+			const double elapsed = m_time - emitter.startedAt;
+			if(!emitter.loop && elapsed * m_sampleRate >= emitter.sound.frames) {
+				erase(i);
+				continue;
+			}
+			if(emitter.voice && !m_mixer.isPlaying(emitter.voice)) {
+				// ended early on the audio thread, e.g. because the game and audio clocks drift
+				emitter.voice = 0;
+			}
+			computeAudibility(emitter);
+			if(emitter.audibility >= AudibleGain) {
+				m_candidates.push_back(static_cast<Uint32>(i));
+			}
+			++i;
+		}
+
+		// real voices get an edge so two similar emitters do not keep trading places
+		auto moreImportant = [this](Uint32 a, Uint32 b) {
+			const Emitter& left = m_emitters[a];
+			const Emitter& right = m_emitters[b];
+			if(left.priority != right.priority) {
+				return left.priority > right.priority;
+			}
+			return left.audibility * (left.voice ? Hysteresis : 1.0f) > right.audibility * (right.voice ? Hysteresis : 1.0f);
+		};
+		if(m_candidates.size() > m_maxReal) {
+			std::nth_element(m_candidates.begin(), m_candidates.begin() + m_maxReal, m_candidates.end(), moreImportant);
+			m_candidates.resize(m_maxReal);
+		}
+
+		for(Emitter& emitter : m_emitters) {
+			emitter.wanted = false;
+		}
+		for(Uint32 index : m_candidates) {
+			m_emitters[index].wanted = true;
+		}
+
+		// demote first, so the slots are free again by the time the promotions reach the mixer
+		for(Emitter& emitter : m_emitters) {
+			if(emitter.voice && !emitter.wanted) {
+				m_mixer.stop(emitter.voice);
+				emitter.voice = 0;
+				++m_demotions;
+			}
+		}
+		for(Uint32 index : m_candidates) {
+			Emitter& emitter = m_emitters[index];
+			if(emitter.voice) {
+				if(std::abs(emitter.audibility - emitter.sentGain) > 0.001f) {
+					m_mixer.setGain(emitter.voice, emitter.audibility);
+					emitter.sentGain = emitter.audibility;
+				}
+				if(std::abs(emitter.pan - emitter.sentPan) > 0.01f) {
+					m_mixer.setPan(emitter.voice, emitter.pan);
+					emitter.sentPan = emitter.pan;
+				}
+				continue;
+			}
+			// where the sound would be if it had played all along
+			const Uint64 frame = static_cast<Uint64>((m_time - emitter.startedAt) * m_sampleRate);
+			emitter.voice = m_mixer.play(emitter.sound, emitter.audibility, emitter.pan, emitter.loop, static_cast<Uint32>(frame % emitter.sound.frames));
+			if(emitter.voice) {
+				emitter.sentGain = emitter.audibility;
+				emitter.sentPan = emitter.pan;
+				++m_promotions;
+			}
+		}
+	}
+
+	VoiceManagerStats stats() const
+	{
+		VoiceManagerStats stats;
+		stats.emitters = m_emitters.size();
+		for(const Emitter& emitter : m_emitters) {
+			if(emitter.voice) {
+				++stats.real;
+			}
+			else if(emitter.audibility >= AudibleGain) {
+				++stats.virtualized;
+			}
+			else {
+				++stats.inaudible;
+			}
+		}
+		stats.promotions = m_promotions;
+		stats.demotions = m_demotions;
+		return stats;
+	}
+
+private:
+	// quieter than -60 dB is not worth a voice
+	static constexpr float AudibleGain = 0.001f;
+	static constexpr float Hysteresis = 1.25f;
+
+	struct Emitter
+	{
+		EmitterId id = 0;
+		Sound sound{};
+		float x = 0.0f;
+		float y = 0.0f;
+		float gain = 1.0f;
+		int priority = 0;
+		bool loop = false;
+		double startedAt = 0.0;
+		VoiceId voice = 0;
+		bool wanted = false;
+		float audibility = 0.0f;
+		float pan = 0.0f;
+		float sentGain = 0.0f;
+		float sentPan = 0.0f;
+	};
+
+	Emitter* find(EmitterId id)
+	{
+		auto found = m_index.find(id);
+		return found != m_index.end() ? &m_emitters[found->second] : nullptr;
+	}
+
+	// swap with the last one to keep the emitters dense
+	void erase(size_t index)
+	{
+		if(m_emitters[index].voice) {
+			m_mixer.stop(m_emitters[index].voice);
+		}
+		m_index.erase(m_emitters[index].id);
+		if(index + 1 != m_emitters.size()) {
+			m_emitters[index] = m_emitters.back();
+			m_index[m_emitters[index].id] = index;
+		}
+		m_emitters.pop_back();
+	}
+
+	void computeAudibility(Emitter& emitter) const
+	{
+		const float dx = emitter.x - m_listenerX;
+		const float dy = emitter.y - m_listenerY;
+		const float distance = std::sqrt(dx * dx + dy * dy);
+		float attenuation = 1.0f;
+		if(distance >= m_maxDistance) {
+			attenuation = 0.0f;
+		}
+		else if(distance > m_minDistance) {
+			// inverse distance, tapered to reach zero at maxDistance
+			attenuation = m_minDistance / distance * (m_maxDistance - distance) / (m_maxDistance - m_minDistance);
+		}
+		emitter.audibility = emitter.gain * attenuation;
+		// fully to one side from a quarter of maxDistance
+		emitter.pan = std::min(std::max(dx / m_maxDistance * 4.0f, -1.0f), 1.0f);
+	}
+
+	Mixer& m_mixer;
+	const size_t m_maxReal;
+	int m_sampleRate = 48000;
+	double m_time = 0.0;
+	float m_listenerX = 0.0f;
+	float m_listenerY = 0.0f;
+	float m_minDistance = 1.0f;
+	float m_maxDistance = 100.0f;
+
+	std::vector<Emitter> m_emitters;
+	std::unordered_map<EmitterId, size_t> m_index;
+	std::vector<Uint32> m_candidates;
+	EmitterId m_nextId = 1;
+	size_t m_promotions = 0;
+	size_t m_demotions = 0;
+};
+
+}
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+
+#include "Engine/IO/MappedFile.h"
+
+namespace Engine {
+namespace Audio {
+
+// A memory mapped RIFF WAVE file with 8, 16, 24 or 32 bit integer or 32 bit float PCM. Opening
+// only parses the headers; samples are converted when they are read.
+class WaveFile
+{
+public:
+	enum class Encoding : uint8_t { Integer, Float };
+
+	explicit WaveFile(const std::string& path)
+	: m_file(path)
+	{
+		const uint8_t* data = m_file.data();
+		const size_t size = m_file.size();
+		if(size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0) {
+			throw std::runtime_error(path + " is not a wave file");
+		}
+		bool hasFormat = false;
+		size_t offset = 12;
+		while(offset + 8 <= size) {
+			const uint8_t* chunk = data + offset;
+			const size_t chunkSize = readU32(chunk + 4);
+			const size_t body = offset + 8;
+			if(std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16 && body + 16 <= size) {
+				uint16_t tag = readU16(data + body);
+				m_channels = readU16(data + body + 2);
+				m_sampleRate = readU32(data + body + 4);
+				m_bitsPerSample = readU16(data + body + 14);
+				// WAVE_FORMAT_EXTENSIBLE keeps the actual format in the first two bytes of the sub format
+				if(tag == 0xFFFE && chunkSize >= 26 && body + 26 <= size) {
+					tag = readU16(data + body + 24);
+				}
+				if(tag == 1) {
+					m_encoding = Encoding::Integer;
+				}
+				else if(tag == 3) {
+					m_encoding = Encoding::Float;
+				}
+				else {
+					throw std::runtime_error(path + " is compressed, only PCM is supported");
+				}
+				hasFormat = true;
+			}
+			else if(std::memcmp(chunk, "data", 4) == 0) {
+				m_samples = data + body;
+				// tolerate truncated files and streams that were never finalized
+				m_dataSize = std::min(chunkSize, size - body);
+				break;
+			}
+			// chunks are padded to an even size
+			offset = body + chunkSize + (chunkSize & 1);
+		}
+		const bool supported = m_encoding == Encoding::Float
+			? m_bitsPerSample == 32
+			: (m_bitsPerSample == 8 || m_bitsPerSample == 16 || m_bitsPerSample == 24 || m_bitsPerSample == 32);
+		if(!hasFormat || !m_samples || m_channels == 0 || !supported) {
+			throw std::runtime_error(path + " has no supported format or data chunk");
+		}
+		m_frameSize = m_channels * (m_bitsPerSample / 8);
+		m_frames = m_dataSize / m_frameSize;
+	}
+
+	uint32_t sampleRate() const
+	{
+		return m_sampleRate;
+	}
+
+	uint16_t channels() const
+	{
+		return m_channels;
+	}
+
+	uint16_t bitsPerSample() const
+	{
+		return m_bitsPerSample;
+	}
+
+	Encoding encoding() const
+	{
+		return m_encoding;
+	}
+
+	size_t frames() const
+	{
+		return m_frames;
+	}
+
+	const IO::MappedFile& file() const
+	{
+		return m_file;
+	}
+
+	// byte offset of a frame in the file, for prefetch and release
+	size_t fileOffset(size_t frame) const
+	{
+		return static_cast<size_t>(m_samples - m_file.data()) + frame * m_frameSize;
+	}
+
+	// Converts count frames from frame on to interleaved stereo float. Mono is copied to both sides,
+	// further channels beyond the first two are dropped.
+	void readStereo(size_t frame, size_t count, float* stereo) const
+	{
+		const uint8_t* in = m_samples + frame * m_frameSize;
+		const size_t bytes = m_bitsPerSample / 8;
+		const size_t right = m_channels > 1 ? bytes : 0;
+		switch(m_encoding == Encoding::Float ? 0 : m_bitsPerSample) {
+		case 0:
+			for(size_t i = 0; i < count; ++i, in += m_frameSize) {
+				std::memcpy(&stereo[2 * i], in, 4);
+				std::memcpy(&stereo[2 * i + 1], in + right, 4);
+			}
+			break;
+		case 8:
+			for(size_t i = 0; i < count; ++i, in += m_frameSize) {
+				stereo[2 * i] = (static_cast<int>(in[0]) - 128) * (1.0f / 128);
+				stereo[2 * i + 1] = (static_cast<int>(in[right]) - 128) * (1.0f / 128);
+			}
+			break;
+		case 16:
+			for(size_t i = 0; i < count; ++i, in += m_frameSize) {
+				stereo[2 * i] = static_cast<int16_t>(readU16(in)) * (1.0f / 32768);
+				stereo[2 * i + 1] = static_cast<int16_t>(readU16(in + right)) * (1.0f / 32768);
+			}
+			break;
+		case 24:
+			for(size_t i = 0; i < count; ++i, in += m_frameSize) {
+				stereo[2 * i] = readS24(in) * (1.0f / 8388608);
+				stereo[2 * i + 1] = readS24(in + right) * (1.0f / 8388608);
+			}
+			break;
+		case 32:
+			for(size_t i = 0; i < count; ++i, in += m_frameSize) {
+				stereo[2 * i] = static_cast<int32_t>(readU32(in)) * (1.0f / 2147483648.0f);
+				stereo[2 * i + 1] = static_cast<int32_t>(readU32(in + right)) * (1.0f / 2147483648.0f);
+			}
+			break;
+		}
+	}
+
+private:
+	// wave files are little endian
+	static uint16_t readU16(const uint8_t* p)
+	{
+		return static_cast<uint16_t>(p[0] | (p[1] << 8));
+	}
+
+	static uint32_t readU32(const uint8_t* p)
+	{
+		return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	}
+
+	static int32_t readS24(const uint8_t* p)
+	{
+		return static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+	}
+
+	IO::MappedFile m_file;
+	const uint8_t* m_samples = nullptr;
+	size_t m_dataSize = 0;
+	size_t m_frames = 0;
+	size_t m_frameSize = 0;
+	uint32_t m_sampleRate = 0;
+	uint16_t m_channels = 0;
+	uint16_t m_bitsPerSample = 0;
+	Encoding m_encoding = Encoding::Integer;
+};
+
+}
+}
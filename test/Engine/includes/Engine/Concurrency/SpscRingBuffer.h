@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+namespace Engine {
+namespace Concurrency {
+
+// Bounded queue for exactly one producer thread and one consumer thread. Neither side ever
+// locks or allocates, so it is safe to use from audio callbacks and other real-time threads.
+// The capacity is rounded up to a power of two.
+template<typename T>
+class SpscRingBuffer
+{
+public:
+	explicit SpscRingBuffer(size_t capacity)
+	: m_buffer(roundUp(capacity))
+	, m_mask(m_buffer.size() - 1)
+	{
+	}
+
+	SpscRingBuffer(const SpscRingBuffer&) = delete;
+	SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+	size_t capacity() const
+	{
+		return m_buffer.size();
+	}
+
+	// producer side, returns false when full
+	bool tryPush(const T& value)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if(head - m_cachedTail == m_buffer.size()) {
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if(head - m_cachedTail == m_buffer.size()) {
+				return false;
+			}
+		}
+		m_buffer[head & m_mask] = value;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// producer side, copies as many values as fit and returns how many that were
+	size_t push(const T* values, size_t count)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		m_cachedTail = m_tail.load(std::memory_order_acquire);
+		count = std::min(count, m_buffer.size() - (head - m_cachedTail));
+		for(size_t i = 0; i < count; ++i) {
+			m_buffer[(head + i) & m_mask] = values[i];
+		}
+		m_head.store(head + count, std::memory_order_release);
+		return count;
+	}
+
+	// consumer side, returns false when empty
+	bool tryPop(T& value)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if(tail == m_cachedHead) {
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if(tail == m_cachedHead) {
+				return false;
+			}
+		}
+		value = m_buffer[tail & m_mask];
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side, copies up to count values and returns how many were available
+	size_t pop(T* values, size_t count)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		m_cachedHead = m_head.load(std::memory_order_acquire);
+		count = std::min(count, m_cachedHead - tail);
+		for(size_t i = 0; i < count; ++i) {
+			values[i] = m_buffer[(tail + i) & m_mask];
+		}
+		m_tail.store(tail + count, std::memory_order_release);
+		return count;
+	}
+
+	// only exact when called from one of the two sides while the other is idle
+	size_t size() const
+	{
+		return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+private:
+	static size_t roundUp(size_t capacity)
+	{
+		size_t result = 1;
+		while(result < capacity) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	std::vector<T> m_buffer;
+	const size_t m_mask;
+
+	// head and tail on separate cache lines, each with the side's cached copy of the other index
+	alignas(64) std::atomic<size_t> m_head{ 0 };
+	size_t m_cachedTail = 0;
+	alignas(64) std::atomic<size_t> m_tail{ 0 };
+	size_t m_cachedHead = 0;
+};
+
+}
+}
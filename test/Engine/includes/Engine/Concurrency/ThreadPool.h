@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+
+namespace Engine {
+namespace Concurrency {
+
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1)
+	{
+		for(size_t i = 0; i < threadCount; ++i) {
+			m_threads.emplace_back([this] { work(); });
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_wakeup.notify_all();
+		for(auto &thread : m_threads) {
+			thread.join();
+		}
+	}
+
+	// number of worker threads, not counting the thread calling parallelFor
+	size_t size() const
+	{
+		return m_threads.size();
+	}
+
+	void submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.push_back(std::move(task));
+		}
+		m_wakeup.notify_one();
+	}
+
+	// Calls func(index) for every index in [0, count) and returns when all calls are done.
+	// The calling thread takes part in the work, so this also works with zero workers.
+	// Called from one of this pool's own tasks it runs every index inline, since waiting for
+	// workers that may all be busy waiting as well would deadlock.
+	template<typename Func>
+	void parallelFor(size_t count, Func&& func)
+	{
+		if(count == 0) {
+			return;
+		}
+		if(currentPool() == this) {
+			for(size_t index = 0; index < count; ++index) {
+				func(index);
+			}
+			return;
+		}
+		const size_t helpers = std::min(size(), count - 1);
+		std::atomic<size_t> next{ 0 };
+		// every run has to finish before the locals it references go out of scope
+		size_t exited = 0;
+		std::mutex exitMutex;
+		std::condition_variable exitSignal;
+
+		auto run = [&] {
+			for(size_t index = next++; index < count; index = next++) {
+				func(index);
+			}
+			std::lock_guard<std::mutex> lock(exitMutex);
+			if(++exited == helpers + 1) {
+				exitSignal.notify_all();
+			}
+		};
+
+		for(size_t i = 0; i < helpers; ++i) {
+			submit(run);
+		}
+		run();
+
+		std::unique_lock<std::mutex> lock(exitMutex);
+		exitSignal.wait(lock, [&] { return exited == helpers + 1; });
+	}
+
+private:
+	// the pool the calling thread is a worker of, if any
+	static ThreadPool*& currentPool()
+	{
+		thread_local ThreadPool* pool = nullptr;
+		return pool;
+	}
+
+	void work()
+	{
+		currentPool() = this;
+		for(;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wakeup.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+				if(m_tasks.empty()) {
+					return;
+				}
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeup;
+	bool m_stopping = false;
+};
+
+}
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <ostream>
+#include <cstdint>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Diagnostics/LatencyTracker.h"
+
+namespace Engine {
+namespace Diagnostics {
+
+// LogHistogram that one thread can add to while others read it, without locks.
+class AtomicLogHistogram
+{
+public:
+	AtomicLogHistogram()
+	{
+		clear();
+	}
+
+	void add(uint64_t microseconds)
+	{
+		m_buckets[LogHistogram::bucketOf(microseconds)].fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(microseconds, std::memory_order_relaxed);
+		if(microseconds > m_max.load(std::memory_order_relaxed)) {
+			m_max.store(microseconds, std::memory_order_relaxed);
+		}
+	}
+
+	// a reset racing with add may lose that one value
+	void clear()
+	{
+		for(auto& bucket : m_buckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		m_sum.store(0, std::memory_order_relaxed);
+		m_max.store(0, std::memory_order_relaxed);
+	}
+
+	LogHistogram snapshot() const
+	{
+		std::array<uint64_t, LogHistogram::BucketCount> buckets;
+		for(size_t i = 0; i < buckets.size(); ++i) {
+			buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+		}
+		return LogHistogram::fromCounts(buckets, m_sum.load(std::memory_order_relaxed), m_max.load(std::memory_order_relaxed));
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, LogHistogram::BucketCount> m_buckets;
+	std::atomic<uint64_t> m_sum;
+	std::atomic<uint64_t> m_max;
+};
+
+struct AudioDeadlineStats
+{
+	// length of the block the device asks for, from the obtained spec
+	uint64_t periodMicroseconds = 0;
+	uint64_t callbacks = 0;
+	// started more than half a period after the previous block ran out
+	uint64_t late = 0;
+	// took longer than the block it produced lasts
+	uint64_t overruns = 0;
+	// finished after the device used up the previous block, or found the queue empty in push mode
+	uint64_t underruns = 0;
+	// time spent in the callback
+	LogHistogram duration;
+	// time between the starts of two callbacks
+	LogHistogram interval;
+
+	// longest callback as a fraction of the period
+	double peakLoad() const
+	{
+		return periodMicroseconds ? static_cast<double>(duration.max()) / periodMicroseconds : 0.0;
+	}
+};
+
+inline std::ostream& operator<<(std::ostream& os, const AudioDeadlineStats& stats)
+{
+	return os << "audio callback: " << stats.duration << " (period " << stats.periodMicroseconds / 1000.0 << " ms, peak load "
+		<< stats.peakLoad() * 100.0 << "%)\n"
+		<< "audio interval: " << stats.interval << "\n"
+		<< "audio deadlines: " << stats.callbacks << " callbacks, " << stats.late << " late, "
+		<< stats.overruns << " overruns, " << stats.underruns << " underruns";
+}
+
+// Times the audio callback against the length of the block it produces. SDL asks for the next
+// block while the device still plays the last one, so each callback is expected one block after
+// the previous one started, and has to be done before that block ran out. Wrap the work of the
+// callback in callbackStarted and callbackFinished; the main thread reads stats at any time.
+class AudioDeadlineMonitor
+{
+public:
+	AudioDeadlineMonitor()
+	: m_frequency(SDL_GetPerformanceFrequency())
+	{
+	}
+
+	// call with the obtained spec before the device runs
+	void setFormat(const SDL_AudioSpec& obtained)
+	{
+		m_sampleRate = obtained.freq;
+		m_bytesPerFrame = SDL_AUDIO_BITSIZE(obtained.format) / 8 * obtained.channels;
+		m_period.store(static_cast<uint64_t>(obtained.samples) * 1000000 / obtained.freq, std::memory_order_relaxed);
+		m_expectedAt = 0;
+	}
+
+	// audio thread: returns the start time for callbackFinished
+	Uint64 callbackStarted()
+	{
+		return SDL_GetPerformanceCounter();
+	}
+
+	// audio thread: length is the callback's buffer size in bytes
+	void callbackFinished(Uint64 startedAt, int length)
+	{
+		const Uint64 now = SDL_GetPerformanceCounter();
+		const uint64_t duration = microseconds(now - startedAt);
+		// SDL may ask for other sizes than the spec said, the block's own length is what counts
+		const uint64_t period = static_cast<uint64_t>(length / m_bytesPerFrame) * 1000000 / m_sampleRate;
+
+		m_callbacks.fetch_add(1, std::memory_order_relaxed);
+		m_duration.add(duration);
+		if(duration > period) {
+			m_overruns.fetch_add(1, std::memory_order_relaxed);
+		}
+		if(m_expectedAt) {
+			m_interval.add(microseconds(startedAt - m_lastStartedAt));
+			const uint64_t lateness = startedAt > m_expectedAt ? microseconds(startedAt - m_expectedAt) : 0;
+			if(lateness > m_lastPeriod / 2) {
+				m_late.fetch_add(1, std::memory_order_relaxed);
+			}
+			if(lateness + duration > m_lastPeriod) {
+				m_underruns.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		m_lastStartedAt = startedAt;
+		m_lastPeriod = period;
+		m_expectedAt = startedAt + period * m_frequency / 1000000;
+	}
+
+	// game thread, for devices fed with SDL_QueueAudio: call with the queued size before topping it up
+	void queueSampled(Uint32 queuedBytes)
+	{
+		if(queuedBytes == 0 && m_queueStarted) {
+			m_underruns.fetch_add(1, std::memory_order_relaxed);
+		}
+		m_queueStarted = true;
+	}
+
+	AudioDeadlineStats stats() const
+	{
+		AudioDeadlineStats stats;
+		stats.periodMicroseconds = m_period.load(std::memory_order_relaxed);
+		stats.callbacks = m_callbacks.load(std::memory_order_relaxed);
+		stats.late = m_late.load(std::memory_order_relaxed);
+		stats.overruns = m_overruns.load(std::memory_order_relaxed);
+		stats.underruns = m_underruns.load(std::memory_order_relaxed);
+		stats.duration = m_duration.snapshot();
+		stats.interval = m_interval.snapshot();
+		return stats;
+	}
+
+	void reset()
+	{
+		m_callbacks.store(0, std::memory_order_relaxed);
+		m_late.store(0, std::memory_order_relaxed);
+		m_overruns.store(0, std::memory_order_relaxed);
+		m_underruns.store(0, std::memory_order_relaxed);
+		m_duration.clear();
+		m_interval.clear();
+	}
+
+private:
+	uint64_t microseconds(Uint64 counterDelta) const
+	{
+		return counterDelta * 1000000 / m_frequency;
+	}
+
+	const Uint64 m_frequency;
+	int m_sampleRate = 48000;
+	int m_bytesPerFrame = 8;
+	std::atomic<uint64_t> m_period{ 0 };
+
+	// audio thread side
+	Uint64 m_lastStartedAt = 0;
+	Uint64 m_expectedAt = 0;
+	uint64_t m_lastPeriod = 0;
+	// game thread side in push mode
+	bool m_queueStarted = false;
+
+	std::atomic<uint64_t> m_callbacks{ 0 };
+	std::atomic<uint64_t> m_late{ 0 };
+	std::atomic<uint64_t> m_overruns{ 0 };
+	std::atomic<uint64_t> m_underruns{ 0 };
+	AtomicLogHistogram m_duration;
+	AtomicLogHistogram m_interval;
+};
+
+}
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <cstdint>
+
+#include "ReSDL/ReSDL.h"
+
+namespace Engine {
+namespace Diagnostics {
+
+// Histogram of durations in microseconds with power of two buckets: bucket i counts values in [2^i, 2^(i+1)).
+class LogHistogram
+{
+public:
+	static constexpr size_t BucketCount = 32;
+
+	static size_t bucketOf(uint64_t microseconds)
+	{
+		size_t bucket = 0;
+		while(bucket + 1 < BucketCount && (microseconds >> (bucket + 1)) != 0) {
+			++bucket;
+		}
+		return bucket;
+	}
+
+	// a histogram counted elsewhere, e.g. by another thread
+	static LogHistogram fromCounts(const std::array<uint64_t, BucketCount>& buckets, uint64_t sum, uint64_t max)
+	{
+		LogHistogram histogram;
+		histogram.m_buckets = buckets;
+		for(uint64_t count : buckets) {
+			histogram.m_count += count;
+		}
+		histogram.m_sum = sum;
+		histogram.m_max = max;
+		return histogram;
+	}
+
+	void add(uint64_t microseconds)
+	{
+		++m_buckets[bucketOf(microseconds)];
+		++m_count;
+		m_sum += microseconds;
+		if(microseconds > m_max) {
+			m_max = microseconds;
+		}
+	}
+
+	void clear()
+	{
+		m_buckets.fill(0);
+		m_count = 0;
+		m_sum = 0;
+		m_max = 0;
+	}
+
+	uint64_t count() const
+	{
+		return m_count;
+	}
+
+	double mean() const
+	{
+		return m_count ? static_cast<double>(m_sum) / m_count : 0.0;
+	}
+
+	uint64_t max() const
+	{
+		return m_max;
+	}
+
+	// upper bound of the bucket holding the given fraction of values, e.g. 0.99 for the 99th percentile
+	uint64_t percentile(double fraction) const
+	{
+		const uint64_t rank = static_cast<uint64_t>(fraction * m_count);
+		uint64_t seen = 0;
+		for(size_t i = 0; i < BucketCount; ++i) {
+			seen += m_buckets[i];
+			if(seen > rank) {
+				return std::min<uint64_t>((uint64_t(2) << i) - 1, m_max);
+			}
+		}
+		return m_max;
+	}
+
+	const std::array<uint64_t, BucketCount>& buckets() const
+	{
+		return m_buckets;
+	}
+
+private:
+	std::array<uint64_t, BucketCount> m_buckets{};
+	uint64_t m_count = 0;
+	uint64_t m_sum = 0;
+	uint64_t m_max = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const LogHistogram& histogram)
+{
+	return os << "mean " << histogram.mean() / 1000.0
+		<< " ms, p50 < " << histogram.percentile(0.5) / 1000.0
+		<< " ms, p99 < " << histogram.percentile(0.99) / 1000.0
+		<< " ms, max " << histogram.max() / 1000.0 << " ms";
+}
+
+// Follows each frame from the first input it consumed to the moment it was presented.
+// All points in time are SDL performance counter values; zero means "none".
+class LatencyTracker
+{
+public:
+	// Called at "input" (the frame consumed input received at counter), "frame" (frame started)
+	// and "present" (frame was presented), e.g. to forward the points into an external profiler.
+	using TraceMarkerFunc = std::function<void(const char* name, long frame, Uint64 counter)>;
+
+	LatencyTracker()
+	: m_frequency(SDL_GetPerformanceFrequency())
+	{
+	}
+
+	void frameStarted(Uint64 inputReceivedAt)
+	{
+		m_frameStartedAt = SDL_GetPerformanceCounter();
+		m_inputReceivedAt = inputReceivedAt;
+		if(inputReceivedAt) {
+			mark("input", inputReceivedAt);
+		}
+		mark("frame", m_frameStartedAt);
+	}
+
+	void framePresented(Uint64 presentedAt)
+	{
+		mark("present", presentedAt);
+		if(m_inputReceivedAt) {
+			m_inputToPresent.add(microseconds(presentedAt - m_inputReceivedAt));
+		}
+		m_frameToPresent.add(microseconds(presentedAt - m_frameStartedAt));
+		if(m_lastPresentedAt) {
+			m_presentInterval.add(microseconds(presentedAt - m_lastPresentedAt));
+		}
+		m_lastPresentedAt = presentedAt;
+		m_inputReceivedAt = 0;
+		++m_frame;
+	}
+
+	void setTraceMarker(TraceMarkerFunc marker)
+	{
+		m_marker = std::move(marker);
+	}
+
+	// from receiving the first input event of a frame to presenting that frame, only frames that had input
+	const LogHistogram& inputToPresent() const
+	{
+		return m_inputToPresent;
+	}
+
+	// from the start of the frame's update to its present
+	const LogHistogram& frameToPresent() const
+	{
+		return m_frameToPresent;
+	}
+
+	const LogHistogram& presentInterval() const
+	{
+		return m_presentInterval;
+	}
+
+	void reset()
+	{
+		m_inputToPresent.clear();
+		m_frameToPresent.clear();
+		m_presentInterval.clear();
+	}
+
+private:
+	uint64_t microseconds(Uint64 counterDelta) const
+	{
+		return counterDelta * 1000000 / m_frequency;
+	}
+
+	void mark(const char* name, Uint64 counter)
+	{
+		if(m_marker) {
+			m_marker(name, m_frame, counter);
+		}
+	}
+
+	Uint64 m_frequency;
+	Uint64 m_frameStartedAt = 0;
+	Uint64 m_inputReceivedAt = 0;
+	Uint64 m_lastPresentedAt = 0;
+	long m_frame = 0;
+	TraceMarkerFunc m_marker;
+
+	LogHistogram m_inputToPresent;
+	LogHistogram m_frameToPresent;
+	LogHistogram m_presentInterval;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const LatencyTracker& tracker)
+{
+	return os << "input to present: " << tracker.inputToPresent() << " (" << tracker.inputToPresent().count() << " frames)\n"
+		<< "frame to present: " << tracker.frameToPresent() << "\n"
+		<< "present interval: " << tracker.presentInterval();
+}
+
+}
+}
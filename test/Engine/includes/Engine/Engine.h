@@ -21,7 +21,24 @@
 
 #include "Input/AxisInputManager.h"
 #include "Input/EventManager.h"
+#include "Input/DeviceRegistry.h"
+#include "Diagnostics/LatencyTracker.h"
+#include "Diagnostics/AudioDeadlineMonitor.h"
+#include "Audio/Mixer.h"
+#include "Audio/AudioStream.h"
+#include "Audio/AudioFormat.h"
+#include "Audio/Oscillator.h"
+#include "Audio/OutputConverter.h"
+#include "Audio/DspGraph.h"
+#include "Audio/Effects.h"
+#include "Audio/Capture.h"
+#include "Audio/VoiceManager.h"
+#include "Audio/Midi.h"
+#include "Audio/SoundBank.h"
+#include "Graphics/Pixels.h"
+#include "Graphics/SoftwareRenderer.h"
 #include "Utilities.h"
+#include "Fixed.h"
 
 namespace Engine {
 
@@ -42,7 +59,8 @@ class RttRendererWindow {
 public:
 	RttRendererWindow(int targetWidth, int targetHeight, float pixelAspectRatio);
 	void prepareFrame();
-	void finalizeFrame();
+	// presents the frame, returns the performance counter value right after presenting
+	Uint64 finalizeFrame();
 	void updateDstRect();
 	
 	std::shared_ptr<ReSDL::Renderer> renderer();
@@ -66,12 +84,56 @@ struct Engine {
 	RttRendererWindow window;
 	Input::AxisInputManager axisInputManager;
 	Input::EventManager eventManager;
+	Diagnostics::LatencyTracker latency;
+	Audio::Mixer mixer;
+	// positioned sounds, only the most audible ones get mixer voices; updated every frame
+	Audio::VoiceManager voices{ mixer };
+	// sample rate the mixer and every source run at, independent of the device
+	int mixRate = 48000;
+	// effects on the way to the device, published by start: mixerNode feeds masterBus, the output.
+	// Add buses and effects in between, or publish changes while running.
+	Audio::DspGraph dsp;
+	Audio::NodeId mixerNode = 0;
+	Audio::NodeId masterBus = 0;
+	// the format the audio device actually runs at, valid once start opened it
+	Audio::AudioFormat audioFormat;
+	// resamples and converts the mixer output to audioFormat
+	std::unique_ptr<Audio::OutputConverter> audioOutput;
+	// queue audio from the game loop with SDL_QueueAudio instead of running a device callback
+	bool pushAudio = false;
+	// frames per device block asked for when opening, SDL may pick another size
+	Uint16 audioBlockFrames = 256;
+	// callback times and underruns of the audio device
+	Diagnostics::AudioDeadlineMonitor audioDeadlines;
+	// print audioDeadlines with the frame statistics
+	bool printAudioDeadlines = false;
+	// analyse the default capture device while running, or captureFile instead if it is set;
+	// poll captureAnalyzer for level, voice activity and pitch
+	bool captureAudio = false;
+	std::string captureFile;
+	Audio::AudioCapture capture;
+	std::unique_ptr<Audio::CaptureAnalyzer> captureAnalyzer;
+	// wave file streamed or MIDI file synthesized and looped as background music, empty for none
+	std::string musicPath;
+	// sound effects pre-converted to mixRate by a SoundBankBuilder; start maps soundBankPath into
+	// soundBank and the voices play straight from the mapping
+	std::string soundBankPath;
+	std::unique_ptr<Audio::SoundBank> soundBank;
 	
 	std::vector<std::shared_ptr<IUpdatable>> m_Updateables;
 	std::vector<std::shared_ptr<IRenderable>> m_Renderables;
 	
 	long frameCount;
 	
+	// update input from SDL events and only call handlers on change, instead of polling every frame
+	bool eventDrivenInput = false;
+	// sample controllers and joysticks on their own thread at this rate in Hz, e.g. 1000, instead of once per frame;
+	// implies eventDrivenInput, 0 disables
+	unsigned inputSampleRate = 0;
+	std::unique_ptr<Input::InputSampler> inputSampler;
+	// open game controllers and joysticks, kept up to date on hotplug while running
+	Input::DeviceRegistry inputDevices;
+	
 	Engine(int width, int height, float pixelAspectRatio);
 
 	void start();
@@ -99,7 +161,7 @@ public:
 	}
 	
 	template<typename DurationType>
-	PhysicsPoint advance(Vec2d impulse, DurationType duration) const
+	PhysicsPoint advance(const ImpulseVector &impulse, DurationType duration) const
 	{
 		const auto time = std::chrono::duration_cast<TimeType>(duration);
 		const auto changeInVelocity = impulse / m_mass;
@@ -118,6 +180,11 @@ public:
 		return m_position;
 	}
 	
+	VelocityVector getVelocity() const
+	{
+		return m_velocity;
+	}
+	
 	MassType getMass() const
 	{
 		return m_mass;
@@ -131,6 +198,19 @@ private:
 	
 using PhysicsPoint2d = PhysicsPoint<double, double, std::chrono::milliseconds, 2>;
 
+using PhysicsPoint2fx = PhysicsPoint<Fixed, Fixed, std::chrono::milliseconds, 2>;
+
+// Fixed with ENGINE_DETERMINISTIC, double otherwise
+using PhysicsPoint2s = PhysicsPoint<Scalar, Scalar, std::chrono::milliseconds, 2>;
+
+template<typename MassType, typename SpatialType, typename TimeType, size_t Dimensions>
+void addToChecksum(StateChecksum &checksum, const PhysicsPoint<MassType, SpatialType, TimeType, Dimensions> &point)
+{
+	checksum.add(point.getMass());
+	checksum.add(point.getPosition());
+	checksum.add(point.getVelocity());
+}
+
 	
 class PointDistribution {
 public:
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "Engine/Utilities.h"
+
+namespace Engine {
+
+// Signed fixed-point number with 16 fractional bits in 64-bit storage (Q47.16).
+// All arithmetic is done on integers, so results are bit-identical regardless of
+// compiler, optimization level or floating point environment.
+class Fixed
+{
+public:
+	using Raw = int64_t;
+	static constexpr int FractionBits = 16;
+	static constexpr Raw One = Raw(1) << FractionBits;
+
+	constexpr Fixed()
+	: m_raw(0)
+	{
+	}
+
+	template<typename I, typename = std::enable_if_t<std::is_integral<I>::value>>
+	constexpr Fixed(I value)
+	: m_raw(static_cast<Raw>(value) * One)
+	{
+	}
+
+	// Converting from floating point is only deterministic if the input is; do it at the
+	// edges (loading data, tuning constants), never inside the simulation.
+	constexpr explicit Fixed(double value)
+	: m_raw(static_cast<Raw>(value * static_cast<double>(One) + (value < 0 ? -0.5 : 0.5)))
+	{
+	}
+
+	static constexpr Fixed fromRaw(Raw raw)
+	{
+		Fixed result;
+		result.m_raw = raw;
+		return result;
+	}
+
+	constexpr Raw raw() const
+	{
+		return m_raw;
+	}
+
+	constexpr double toDouble() const
+	{
+		return static_cast<double>(m_raw) / static_cast<double>(One);
+	}
+
+	constexpr explicit operator double() const
+	{
+		return toDouble();
+	}
+
+	constexpr explicit operator float() const
+	{
+		return static_cast<float>(toDouble());
+	}
+
+	// truncates towards negative infinity
+	template<typename I, typename = std::enable_if_t<std::is_integral<I>::value>>
+	constexpr explicit operator I() const
+	{
+		return static_cast<I>(m_raw >> FractionBits);
+	}
+
+	constexpr Fixed operator-() const { return fromRaw(-m_raw); }
+	constexpr Fixed operator+(Fixed other) const { return fromRaw(m_raw + other.m_raw); }
+	constexpr Fixed operator-(Fixed other) const { return fromRaw(m_raw - other.m_raw); }
+	constexpr Fixed operator*(Fixed other) const { return fromRaw(multiply(m_raw, other.m_raw)); }
+	constexpr Fixed operator/(Fixed other) const { return fromRaw(divide(m_raw, other.m_raw)); }
+
+	// multiplying or dividing by an integer is exact and needs no rescaling
+	template<typename I, typename = std::enable_if_t<std::is_integral<I>::value>>
+	constexpr Fixed operator*(I value) const { return fromRaw(m_raw * static_cast<Raw>(value)); }
+	template<typename I, typename = std::enable_if_t<std::is_integral<I>::value>>
+	constexpr Fixed operator/(I value) const { return fromRaw(m_raw / static_cast<Raw>(value)); }
+
+	constexpr Fixed& operator+=(Fixed other) { m_raw += other.m_raw; return *this; }
+	constexpr Fixed& operator-=(Fixed other) { m_raw -= other.m_raw; return *this; }
+	constexpr Fixed& operator*=(Fixed other) { m_raw = multiply(m_raw, other.m_raw); return *this; }
+	constexpr Fixed& operator/=(Fixed other) { m_raw = divide(m_raw, other.m_raw); return *this; }
+
+	constexpr bool operator==(Fixed other) const { return m_raw == other.m_raw; }
+	constexpr bool operator!=(Fixed other) const { return m_raw != other.m_raw; }
+	constexpr bool operator<(Fixed other) const { return m_raw < other.m_raw; }
+	constexpr bool operator<=(Fixed other) const { return m_raw <= other.m_raw; }
+	constexpr bool operator>(Fixed other) const { return m_raw > other.m_raw; }
+	constexpr bool operator>=(Fixed other) const { return m_raw >= other.m_raw; }
+
+private:
+	// Both paths produce the same bits: floor(a * b / 2^16) and trunc(a * 2^16 / b).
+	static constexpr Raw multiply(Raw a, Raw b)
+	{
+#ifdef __SIZEOF_INT128__
+		return static_cast<Raw>((static_cast<__int128>(a) * b) >> FractionBits);
+#else
+		const Raw high = a >> FractionBits;
+		const Raw low = a & (One - 1);
+		return high * b + ((low * b) >> FractionBits);
+#endif
+	}
+
+	static constexpr Raw divide(Raw a, Raw b)
+	{
+#ifdef __SIZEOF_INT128__
+		return static_cast<Raw>((static_cast<__int128>(a) * One) / b);
+#else
+		const Raw quotient = a / b;
+		const Raw remainder = a % b;
+		return quotient * One + (remainder * One) / b;
+#endif
+	}
+
+	Raw m_raw;
+};
+
+template<typename I, typename = std::enable_if_t<std::is_integral<I>::value>>
+constexpr Fixed operator*(I value, Fixed fixed)
+{
+	return fixed * value;
+}
+
+namespace detail {
+
+	constexpr uint32_t isqrt32(uint32_t value)
+	{
+		uint32_t root = 0;
+		while((root + 1) * (root + 1) <= value) {
+			++root;
+		}
+		return root;
+	}
+
+	// sqrt(i) in 4.4 fixed point, the seed for the Newton iteration in sqrt
+	struct SqrtTable
+	{
+		std::array<uint8_t, 256> values{};
+
+		constexpr SqrtTable()
+		{
+			for(uint32_t i = 0; i < 256; ++i) {
+				values[i] = static_cast<uint8_t>(isqrt32(i * 256) > 255 ? 255 : isqrt32(i * 256));
+			}
+		}
+	};
+
+	constexpr double sinTaylor(double x)
+	{
+		double term = x;
+		double sum = x;
+		for(int n = 1; n < 12; ++n) {
+			term *= -x * x / ((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// quarter wave of sine in Q16, generated at compile time so every build embeds the same table
+	struct SinTable
+	{
+		static constexpr int QuarterSteps = 1024;
+		std::array<int32_t, QuarterSteps + 1> values{};
+
+		constexpr SinTable()
+		{
+			constexpr double halfPi = 1.57079632679489661923;
+			for(int i = 0; i <= QuarterSteps; ++i) {
+				const double s = sinTaylor(halfPi * i / QuarterSteps);
+				values[i] = static_cast<int32_t>(s * Fixed::One + 0.5);
+			}
+		}
+	};
+
+	constexpr SqrtTable sqrtTable{};
+	constexpr SinTable sinTable{};
+
+	inline int bitLength(uint64_t value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return value ? 64 - __builtin_clzll(value) : 0;
+#else
+		int length = 0;
+		while(value) {
+			value >>= 1;
+			++length;
+		}
+		return length;
+#endif
+	}
+}
+
+inline Fixed sqrt(Fixed value)
+{
+	if(value.raw() <= 0) {
+		return Fixed();
+	}
+	// sqrt of a Q16 number is the integer sqrt of raw * 2^16
+	const uint64_t x = static_cast<uint64_t>(value.raw()) << Fixed::FractionBits;
+
+	// seed from the top bits, then refine
+	const int shift = (std::max(detail::bitLength(x) - 8, 0) + 1) & ~1;
+	uint64_t root = (static_cast<uint64_t>(detail::sqrtTable.values[x >> shift]) << (shift / 2)) >> 4;
+	if(root == 0) {
+		root = 1;
+	}
+	for(int i = 0; i < 3; ++i) {
+		root = (root + x / root) / 2;
+	}
+	while(root * root > x) {
+		--root;
+	}
+	while((root + 1) * (root + 1) <= x) {
+		++root;
+	}
+	return Fixed::fromRaw(static_cast<Fixed::Raw>(root));
+}
+
+// sine of an angle in radians, table lookup with linear interpolation
+inline Fixed sin(Fixed angle)
+{
+	constexpr Fixed::Raw twoPi = 411775;
+	// 2^32 / (2 pi)
+	constexpr Fixed::Raw turnsPerRadian = 683565276;
+	constexpr int quarter = detail::SinTable::QuarterSteps;
+
+	Fixed::Raw reduced = angle.raw() % twoPi;
+	if(reduced < 0) {
+		reduced += twoPi;
+	}
+	// fraction of a full turn in 32 bits: 12 bits table position, 16 bits interpolation weight
+	const uint64_t turn = static_cast<uint64_t>(reduced * turnsPerRadian) >> Fixed::FractionBits;
+	const int position = static_cast<int>(turn >> 20) & (4 * quarter - 1);
+	const int64_t weight = static_cast<int64_t>((turn >> 4) & 0xFFFF);
+
+	auto lookup = [](int index) -> int64_t {
+		index &= 4 * quarter - 1;
+		if(index < quarter) return detail::sinTable.values[index];
+		if(index < 2 * quarter) return detail::sinTable.values[2 * quarter - index];
+		if(index < 3 * quarter) return -detail::sinTable.values[index - 2 * quarter];
+		return -detail::sinTable.values[4 * quarter - index];
+	};
+
+	const int64_t a = lookup(position);
+	const int64_t b = lookup(position + 1);
+	return Fixed::fromRaw(a + (((b - a) * weight) >> 16));
+}
+
+inline Fixed cos(Fixed angle)
+{
+	constexpr Fixed::Raw halfPi = 102944;
+	return sin(angle + Fixed::fromRaw(halfPi));
+}
+
+inline Fixed abs(Fixed value)
+{
+	return value.raw() < 0 ? -value : value;
+}
+
+inline std::ostream &operator<<(std::ostream &os, Fixed value)
+{
+	return os << value.toDouble();
+}
+
+// FNV-1a over the raw bits of simulation state; equal state gives equal checksums on every build
+class StateChecksum
+{
+public:
+	void add(uint64_t value)
+	{
+		for(int i = 0; i < 8; ++i) {
+			m_hash ^= (value >> (i * 8)) & 0xFF;
+			m_hash *= 1099511628211ull;
+		}
+	}
+
+	void add(Fixed value)
+	{
+		add(static_cast<uint64_t>(value.raw()));
+	}
+
+	// only stable within one build, but lets the double path use the same tooling
+	void add(double value)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		add(bits);
+	}
+
+	template<typename T, size_t N>
+	void add(const Vec<T, N> &vec)
+	{
+		for(size_t i = 0; i < N; ++i) {
+			add(vec[i]);
+		}
+	}
+
+	uint64_t value() const
+	{
+		return m_hash;
+	}
+
+private:
+	uint64_t m_hash = 14695981039346656037ull;
+};
+
+// Engine-wide simulation scalar. Building with ENGINE_DETERMINISTIC switches it to Fixed,
+// which makes simulations reproducible bit for bit (lockstep, replays).
+#ifdef ENGINE_DETERMINISTIC
+using Scalar = Fixed;
+#else
+using Scalar = double;
+#endif
+
+}
+
+template<>
+struct IsVecScalar<Engine::Fixed> : std::true_type {};
+
+using Vec2fx = Vec<Engine::Fixed, 2>;
+
+using Vec2s = Vec<Engine::Scalar, 2>;
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Concurrency/ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ENGINE_GRAPHICS_SSE2 1
+#endif
+
+namespace Engine {
+namespace Graphics {
+
+using ReSDL::PixelRow;
+using ReSDL::PixelView;
+
+// Calls func(row, y) for every row of the view. With a pool the rows are split into bands that
+// run in parallel; each row is visited by exactly one thread, so func may write its row freely.
+template<typename T, typename Func>
+void parallelRows(const PixelView<T>& view, Func&& func, Concurrency::ThreadPool* pool = nullptr, int rowsPerBand = 0)
+{
+	if(view.empty()) {
+		return;
+	}
+	if(!pool || pool->size() == 0) {
+		for(int y = 0; y < view.height; ++y) {
+			func(view.row(y), y);
+		}
+		return;
+	}
+	// a few bands per thread even out rows that take longer than others
+	if(rowsPerBand <= 0) {
+		rowsPerBand = std::max(1, view.height / static_cast<int>((pool->size() + 1) * 4));
+	}
+	const size_t bands = static_cast<size_t>((view.height + rowsPerBand - 1) / rowsPerBand);
+	pool->parallelFor(bands, [&](size_t band) {
+		const int begin = static_cast<int>(band) * rowsPerBand;
+		const int end = std::min(begin + rowsPerBand, view.height);
+		for(int y = begin; y < end; ++y) {
+			func(view.row(y), y);
+		}
+	});
+}
+
+// Calls func(tile, x, y) for tiles of up to tileWidth by tileHeight pixels covering the view,
+// x and y being the tile's position in the view. Tiles keep the working set of a task small
+// when func reads neighbouring rows, e.g. for filters.
+template<typename T, typename Func>
+void parallelTiles(const PixelView<T>& view, int tileWidth, int tileHeight, Func&& func, Concurrency::ThreadPool* pool = nullptr)
+{
+	if(view.empty() || tileWidth <= 0 || tileHeight <= 0) {
+		return;
+	}
+	const int columns = (view.width + tileWidth - 1) / tileWidth;
+	const int rows = (view.height + tileHeight - 1) / tileHeight;
+	auto runTile = [&](size_t tile) {
+		const int x = static_cast<int>(tile % columns) * tileWidth;
+		const int y = static_cast<int>(tile / columns) * tileHeight;
+		func(view.sub(SDL_Rect{ x, y, tileWidth, tileHeight }), x, y);
+	};
+	const size_t tiles = static_cast<size_t>(columns) * rows;
+	if(!pool || pool->size() == 0) {
+		for(size_t tile = 0; tile < tiles; ++tile) {
+			runTile(tile);
+		}
+		return;
+	}
+	pool->parallelFor(tiles, runTile);
+}
+
+namespace detail {
+	inline void fillRow(Uint32* out, int width, Uint32 value)
+	{
+		int x = 0;
+#if ENGINE_GRAPHICS_SSE2
+		const __m128i v = _mm_set1_epi32(static_cast<int>(value));
+		for(; x + 8 <= width; x += 8) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), v);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x + 4), v);
+		}
+#endif
+		for(; x < width; ++x) {
+			out[x] = value;
+		}
+	}
+
+	// out[x] = in[x] unless in[x] == key
+	inline void copyKeyedRow(Uint32* out, const Uint32* in, int width, Uint32 key)
+	{
+		int x = 0;
+#if ENGINE_GRAPHICS_SSE2
+		const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+		for(; x + 4 <= width; x += 4) {
+			const __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+			const __m128i target = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + x));
+			const __m128i keep = _mm_cmpeq_epi32(source, k);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_or_si128(_mm_and_si128(keep, target), _mm_andnot_si128(keep, source)));
+		}
+#endif
+		for(; x < width; ++x) {
+			if(in[x] != key) {
+				out[x] = in[x];
+			}
+		}
+	}
+
+	// view[x] = with wherever view[x] == key
+	inline void replaceRow(Uint32* pixels, int width, Uint32 key, Uint32 with)
+	{
+		int x = 0;
+#if ENGINE_GRAPHICS_SSE2
+		const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+		const __m128i w = _mm_set1_epi32(static_cast<int>(with));
+		for(; x + 4 <= width; x += 4) {
+			const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + x));
+			const __m128i match = _mm_cmpeq_epi32(value, k);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + x), _mm_or_si128(_mm_and_si128(match, w), _mm_andnot_si128(match, value)));
+		}
+#endif
+		for(; x < width; ++x) {
+			if(pixels[x] == key) {
+				pixels[x] = with;
+			}
+		}
+	}
+}
+
+// Pixel values are in the surface's format, e.g. from SDL_MapRGBA(&lock.format(), ...).
+// The 32 bit versions are vectorized; all of them take an optional pool to split the rows.
+
+template<typename T>
+void fill(const PixelView<T>& view, T value, Concurrency::ThreadPool* pool = nullptr)
+{
+	parallelRows(view, [value](PixelRow<T> row, int) { std::fill(row.begin(), row.end(), value); }, pool);
+}
+
+inline void fill(const PixelView<Uint32>& view, Uint32 value, Concurrency::ThreadPool* pool = nullptr)
+{
+	parallelRows(view, [value](PixelRow<Uint32> row, int) { detail::fillRow(row.data, row.width, value); }, pool);
+}
+
+// copies the overlapping top left part of from into to
+template<typename T, typename U>
+void copy(const PixelView<T>& to, const PixelView<U>& from, Concurrency::ThreadPool* pool = nullptr)
+{
+	static_assert(std::is_same<typename std::remove_const<U>::type, T>::value, "copy needs views of the same pixel type");
+	const int width = std::min(to.width, from.width);
+	const int height = std::min(to.height, from.height);
+	const PixelView<T> target = to.sub(SDL_Rect{ 0, 0, width, height });
+	if(target.empty()) {
+		return;
+	}
+	if(!pool && target.contiguous() && from.contiguous() && width == from.width) {
+		std::memcpy(target.pixels, from.pixels, static_cast<size_t>(width) * height * sizeof(T));
+		return;
+	}
+	parallelRows(target, [&from, width](PixelRow<T> row, int y) { std::memcpy(row.data, from.rowData(y), width * sizeof(T)); }, pool);
+}
+
+// like copy, but pixels of from that equal key leave to unchanged
+inline void copyColorKeyed(const PixelView<Uint32>& to, const PixelView<const Uint32>& from, Uint32 key, Concurrency::ThreadPool* pool = nullptr)
+{
+	const int width = std::min(to.width, from.width);
+	const PixelView<Uint32> target = to.sub(SDL_Rect{ 0, 0, width, std::min(to.height, from.height) });
+	parallelRows(target, [&from, width, key](PixelRow<Uint32> row, int y) { detail::copyKeyedRow(row.data, from.rowData(y), width, key); }, pool);
+}
+
+// replaces every key pixel with another value, e.g. to turn a color key into alpha
+inline void replaceColor(const PixelView<Uint32>& view, Uint32 key, Uint32 with, Concurrency::ThreadPool* pool = nullptr)
+{
+	parallelRows(view, [key, with](PixelRow<Uint32> row, int) { detail::replaceRow(row.data, row.width, key, with); }, pool);
+}
+
+}
+}
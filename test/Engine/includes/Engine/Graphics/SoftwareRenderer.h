@@ -0,0 +1,934 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Concurrency/ThreadPool.h"
+#include "Engine/Graphics/Pixels.h"
+
+namespace Engine {
+namespace Graphics {
+
+namespace detail {
+	// round(x / 255) for x up to 255 * 255
+	inline Uint32 div255(Uint32 x)
+	{
+		x += 128;
+		return (x + (x >> 8)) >> 8;
+	}
+
+	// Blending works on the four bytes of a pixel alike, with alpha in the top byte, which holds
+	// for every 32 bit format SoftwareRenderer accepts. The scalar and SSE2 paths give identical
+	// results.
+	inline Uint32 blendPixel(Uint32 source, Uint32 target, SDL_BlendMode mode)
+	{
+		const Uint32 alpha = source >> 24;
+		Uint32 out = 0;
+		for(int shift = 0; shift < 32; shift += 8) {
+			const Uint32 s = (source >> shift) & 0xFF;
+			const Uint32 d = (target >> shift) & 0xFF;
+			Uint32 c;
+			switch(mode) {
+			case SDL_BLENDMODE_ADD:
+				c = shift == 24 ? d : std::min<Uint32>(d + div255(s * alpha), 255);
+				break;
+			case SDL_BLENDMODE_MOD:
+				c = shift == 24 ? d : div255(s * d);
+				break;
+			default:
+				// alpha ends up as srcA + dstA * (1 - srcA)
+				c = div255((shift == 24 ? 255 : s) * alpha + d * (255 - alpha));
+				break;
+			}
+			out |= c << shift;
+		}
+		return out;
+	}
+
+#if ENGINE_GRAPHICS_SSE2
+	inline __m128i div255(__m128i x)
+	{
+		x = _mm_add_epi16(x, _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+	}
+
+	// the alpha of each of the two pixels in x copied to all four of its 16 bit lanes
+	inline __m128i broadcastAlpha(__m128i x)
+	{
+		x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+		return _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	inline __m128i blendPixels(__m128i source, __m128i target, SDL_BlendMode mode)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+		const __m128i full = _mm_set1_epi16(255);
+		const __m128i srcLo = _mm_unpacklo_epi8(source, zero);
+		const __m128i srcHi = _mm_unpackhi_epi8(source, zero);
+		const __m128i alphaLo = broadcastAlpha(srcLo);
+		const __m128i alphaHi = broadcastAlpha(srcHi);
+		if(mode == SDL_BLENDMODE_ADD) {
+			const __m128i color = _mm_andnot_si128(alphaMask, source);
+			const __m128i lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(color, zero), alphaLo));
+			const __m128i hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(color, zero), alphaHi));
+			return _mm_adds_epu8(target, _mm_packus_epi16(lo, hi));
+		}
+		const __m128i opaque = _mm_or_si128(source, alphaMask);
+		const __m128i sLo = _mm_unpacklo_epi8(opaque, zero);
+		const __m128i sHi = _mm_unpackhi_epi8(opaque, zero);
+		const __m128i dLo = _mm_unpacklo_epi8(target, zero);
+		const __m128i dHi = _mm_unpackhi_epi8(target, zero);
+		if(mode == SDL_BLENDMODE_MOD) {
+			return _mm_packus_epi16(div255(_mm_mullo_epi16(sLo, dLo)), div255(_mm_mullo_epi16(sHi, dHi)));
+		}
+		// both products are at most 255 * 255, so their sum still fits unsigned 16 bit lanes
+		const __m128i lo = div255(_mm_add_epi16(_mm_mullo_epi16(sLo, alphaLo), _mm_mullo_epi16(dLo, _mm_sub_epi16(full, alphaLo))));
+		const __m128i hi = div255(_mm_add_epi16(_mm_mullo_epi16(sHi, alphaHi), _mm_mullo_epi16(dHi, _mm_sub_epi16(full, alphaHi))));
+		return _mm_packus_epi16(lo, hi);
+	}
+#endif
+
+	inline void blendSpan(Uint32* target, const Uint32* source, int count, SDL_BlendMode mode)
+	{
+		if(mode == SDL_BLENDMODE_NONE) {
+			std::copy(source, source + count, target);
+			return;
+		}
+		int x = 0;
+#if ENGINE_GRAPHICS_SSE2
+		for(; x + 4 <= count; x += 4) {
+			const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+			const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(target + x));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), blendPixels(s, d, mode));
+		}
+#endif
+		for(; x < count; ++x) {
+			target[x] = blendPixel(source[x], target[x], mode);
+		}
+	}
+
+	// multiplies every byte of the pixels with the matching byte of factors / 255
+	inline void modulateSpan(Uint32* pixels, int count, Uint32 factors)
+	{
+		int x = 0;
+#if ENGINE_GRAPHICS_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i f = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(factors)), zero);
+		for(; x + 4 <= count; x += 4) {
+			const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + x));
+			const __m128i lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), f));
+			const __m128i hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), f));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + x), _mm_packus_epi16(lo, hi));
+		}
+#endif
+		for(; x < count; ++x) {
+			Uint32 out = 0;
+			for(int shift = 0; shift < 32; shift += 8) {
+				out |= div255(((pixels[x] >> shift) & 0xFF) * ((factors >> shift) & 0xFF)) << shift;
+			}
+			pixels[x] = out;
+		}
+	}
+
+	inline SDL_Rect intersect(const SDL_Rect& a, const SDL_Rect& b)
+	{
+		const int x0 = std::max(a.x, b.x);
+		const int y0 = std::max(a.y, b.y);
+		const int x1 = std::min(a.x + a.w, b.x + b.w);
+		const int y1 = std::min(a.y + a.h, b.y + b.h);
+		return SDL_Rect{ x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0) };
+	}
+}
+
+class SoftwareRenderer;
+
+// Pixels a SoftwareRenderer copies from or renders into, in the layout of that renderer's
+// target surface. Create them with SoftwareRenderer::createTexture.
+class SoftwareTexture
+{
+public:
+	int getWidth() const
+	{
+		return m_width;
+	}
+
+	int getHeight() const
+	{
+		return m_height;
+	}
+
+	void setColorMod(Uint8 r, Uint8 g, Uint8 b)
+	{
+		m_colorMod[0] = r;
+		m_colorMod[1] = g;
+		m_colorMod[2] = b;
+	}
+
+	void setAlphaMod(Uint8 alpha)
+	{
+		m_alphaMod = alpha;
+	}
+
+	void setBlendMode(SDL_BlendMode blendMode)
+	{
+		m_blendMode = blendMode;
+	}
+
+	PixelView<Uint32> view()
+	{
+		return PixelView<Uint32>(m_pixels.data(), m_width, m_height, m_width * 4);
+	}
+
+	PixelView<const Uint32> view() const
+	{
+		return PixelView<const Uint32>(m_pixels.data(), m_width, m_height, m_width * 4);
+	}
+
+private:
+	friend class SoftwareRenderer;
+
+	SoftwareTexture(int width, int height, SDL_BlendMode blendMode)
+	: m_pixels(static_cast<size_t>(std::max(width, 0)) * std::max(height, 0), 0)
+	, m_width(std::max(width, 0))
+	, m_height(std::max(height, 0))
+	, m_blendMode(blendMode)
+	{
+	}
+
+	std::vector<Uint32> m_pixels;
+	int m_width;
+	int m_height;
+	SDL_BlendMode m_blendMode;
+	Uint8 m_colorMod[3] = { 255, 255, 255 };
+	Uint8 m_alphaMod = 255;
+};
+
+// Implements the ReSDL::Renderer operations on the CPU into a 32 bit Surface, for machines
+// without a GPU. Calls only record commands; present, or switching the render target, bins
+// them into TileSize squares and rasterizes the tiles in parallel on the pool. Every tile runs
+// its commands in order, so the result is the same as drawing them one after another.
+// Textures have to be SoftwareTextures instead of SDL_Textures, since the pixels of those can
+// not be read back. Scaling is nearest neighbour, like SDL's default scale quality.
+class SoftwareRenderer
+{
+public:
+	static constexpr int TileSize = 64;
+
+	// target has to be 32 bit with alpha, if any, in the top byte, e.g. ARGB8888 or ABGR8888
+	explicit SoftwareRenderer(ReSDL::Surface& target, Concurrency::ThreadPool* pool = nullptr)
+	: m_surface(target)
+	, m_pool(pool)
+	{
+		const SDL_PixelFormat& format = *target.handle->format;
+		auto isByte = [](Uint32 mask, Uint8 shift) { return mask == (0xFFu << shift) && shift % 8 == 0; };
+		if(format.BytesPerPixel != 4 || (format.Amask != 0 && format.Amask != 0xFF000000u)
+			|| !isByte(format.Rmask, format.Rshift) || !isByte(format.Gmask, format.Gshift) || !isByte(format.Bmask, format.Bshift)) {
+			throw std::runtime_error("SoftwareRenderer: the target surface needs a 32 bit format with alpha in the top byte");
+		}
+		m_rShift = format.Rshift;
+		m_gShift = format.Gshift;
+		m_bShift = format.Bshift;
+		resetTarget();
+	}
+
+	SoftwareRenderer(const SoftwareRenderer&) = delete;
+	SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+	// a render target, transparent black
+	SoftwareTexture createTexture(int width, int height)
+	{
+		return SoftwareTexture(width, height, SDL_BLENDMODE_NONE);
+	}
+
+	// a copy of the surface's pixels; blended like SDL_CreateTextureFromSurface does if it has alpha
+	SoftwareTexture createTexture(ReSDL::Surface& surface)
+	{
+		ReSDL::SurfaceLock lock(surface);
+		const SDL_PixelFormat& format = lock.format();
+		SoftwareTexture texture(surface.getWidth(), surface.getHeight(), format.Amask ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+		const SDL_PixelFormat& own = *m_surface.handle->format;
+		if(format.BytesPerPixel == 4 && format.Rmask == own.Rmask && format.Gmask == own.Gmask && format.Bmask == own.Bmask && format.Amask == own.Amask) {
+			Graphics::copy(texture.view(), lock.view<const Uint32>());
+			if(!format.Amask) {
+				replaceAlpha(texture.view());
+			}
+			return texture;
+		}
+		// any other format goes through SDL one pixel at a time, this only happens once per texture
+		const auto pixels = static_cast<const Uint8*>(surface.handle->pixels);
+		const int bytes = format.BytesPerPixel;
+		PixelView<Uint32> out = texture.view();
+		for(int y = 0; y < texture.getHeight(); ++y) {
+			const Uint8* in = pixels + y * surface.handle->pitch;
+			for(int x = 0; x < texture.getWidth(); ++x, in += bytes) {
+				Uint32 value = 0;
+				std::memcpy(&value, in, bytes);
+				if(bytes < 4 && SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+					value >>= (4 - bytes) * 8;
+				}
+				Uint8 r, g, b, a;
+				SDL_GetRGBA(value, &format, &r, &g, &b, &a);
+				out(x, y) = mapColor(r, g, b, a);
+			}
+		}
+		return texture;
+	}
+
+	// a color in the pixel layout of the target
+	Uint32 mapColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a) const
+	{
+		return (Uint32(r) << m_rShift) | (Uint32(g) << m_gShift) | (Uint32(b) << m_bShift) | (Uint32(a) << 24);
+	}
+
+	void drawRect(const SDL_Rect& rect)
+	{
+		if(rect.w <= 0 || rect.h <= 0) {
+			return;
+		}
+		const SDL_Rect target = toTarget(rect);
+		// the four edges, without drawing the corners twice
+		addFill(SDL_Rect{ target.x, target.y, target.w, m_lineWidth });
+		if(target.h > m_lineWidth) {
+			addFill(SDL_Rect{ target.x, target.y + target.h - m_lineWidth, target.w, m_lineWidth });
+		}
+		if(target.h > 2 * m_lineWidth) {
+			addFill(SDL_Rect{ target.x, target.y + m_lineWidth, m_lineWidth, target.h - 2 * m_lineWidth });
+			if(target.w > m_lineWidth) {
+				addFill(SDL_Rect{ target.x + target.w - m_lineWidth, target.y + m_lineWidth, m_lineWidth, target.h - 2 * m_lineWidth });
+			}
+		}
+	}
+
+	void drawEntireRenderTarget()
+	{
+		drawRect(SDL_Rect{ 0, 0, m_viewport.w, m_viewport.h });
+	}
+
+	void fillRect(const SDL_Rect& rect)
+	{
+		if(rect.w > 0 && rect.h > 0) {
+			addFill(toTarget(rect));
+		}
+	}
+
+	void fillEntireRenderTarget()
+	{
+		fillRect(SDL_Rect{ 0, 0, m_viewport.w, m_viewport.h });
+	}
+
+	void drawPoints(const SDL_Point* points, size_t count)
+	{
+		for(size_t i = 0; i < count; ++i) {
+			addFill(toTarget(SDL_Rect{ points[i].x, points[i].y, 1, 1 }));
+		}
+	}
+
+	template<class Collection>
+	void drawPoints(const Collection& points)
+	{
+		if(points.empty()) {
+			return;
+		}
+		drawPoints(points.data(), points.size());
+	}
+
+	void drawLine(int x1, int y1, int x2, int y2)
+	{
+		Command command = makeCommand(Command::Type::Line);
+		command.x1 = toTargetX(x1);
+		command.y1 = toTargetY(y1);
+		command.x2 = toTargetX(x2);
+		command.y2 = toTargetY(y2);
+		const SDL_Rect box{ std::min(command.x1, command.x2), std::min(command.y1, command.y2),
+			std::abs(command.x2 - command.x1) + 1, std::abs(command.y2 - command.y1) + 1 };
+		addLine(command, box);
+	}
+
+	void setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+	{
+		m_color = ReSDL::Color{ r, g, b, a };
+	}
+
+	void getDrawColor(Uint8* r, Uint8* g, Uint8* b, Uint8* a) const
+	{
+		*r = m_color.r;
+		*g = m_color.g;
+		*b = m_color.b;
+		*a = m_color.a;
+	}
+
+	ReSDL::Color getDrawColor() const
+	{
+		return m_color;
+	}
+
+	void setDrawColor(const ReSDL::Color& c)
+	{
+		m_color = c;
+	}
+
+	// The texture has to stay alive and unchanged until the next present or target change.
+	void copy(const SoftwareTexture& texture, const SDL_Rect* srcrect, const SDL_Rect* dstrect)
+	{
+		copyEx(texture, srcrect, dstrect, 0.0);
+	}
+
+	// angle in degrees clockwise around center, which is relative to dstrect
+	void copyEx(const SoftwareTexture& texture,
+		const SDL_Rect* srcrect,
+		const SDL_Rect* dstrect,
+		const double angle,
+		const SDL_Point* center = nullptr,
+		const SDL_RendererFlip flip = SDL_FLIP_NONE)
+	{
+		const SDL_Rect bounds{ 0, 0, texture.m_width, texture.m_height };
+		const SDL_Rect requested = srcrect ? *srcrect : bounds;
+		const SDL_Rect source = detail::intersect(requested, bounds);
+		SDL_Rect dest = dstrect ? *dstrect : SDL_Rect{ 0, 0, m_viewport.w, m_viewport.h };
+		if(source.w <= 0 || source.h <= 0 || dest.w <= 0 || dest.h <= 0) {
+			return;
+		}
+		double centerX = center ? center->x : dest.w * 0.5;
+		double centerY = center ? center->y : dest.h * 0.5;
+		if(source.x != requested.x || source.y != requested.y || source.w != requested.w || source.h != requested.h) {
+			// like SDL, the part of srcrect outside the texture is cut off dest as well instead of
+			// stretching the rest over all of it; flipped, the cut is on the opposite side
+			const double scaleX = static_cast<double>(dest.w) / requested.w;
+			const double scaleY = static_cast<double>(dest.h) / requested.h;
+			const int left = flip & SDL_FLIP_HORIZONTAL ? requested.x + requested.w - (source.x + source.w) : source.x - requested.x;
+			const int top = flip & SDL_FLIP_VERTICAL ? requested.y + requested.h - (source.y + source.h) : source.y - requested.y;
+			const int x0 = dest.x + static_cast<int>(std::lround(left * scaleX));
+			const int y0 = dest.y + static_cast<int>(std::lround(top * scaleY));
+			const int x1 = dest.x + static_cast<int>(std::lround((left + source.w) * scaleX));
+			const int y1 = dest.y + static_cast<int>(std::lround((top + source.h) * scaleY));
+			// keep rotating around the same point
+			centerX -= x0 - dest.x;
+			centerY -= y0 - dest.y;
+			dest = SDL_Rect{ x0, y0, x1 - x0, y1 - y0 };
+			if(dest.w <= 0 || dest.h <= 0) {
+				return;
+			}
+		}
+		Command command = makeCommand(Command::Type::Copy);
+		command.texture = &texture;
+		command.source = source;
+		command.dest = toTarget(dest);
+		command.blend = texture.m_blendMode;
+		command.modulate = mapColor(texture.m_colorMod[0], texture.m_colorMod[1], texture.m_colorMod[2], texture.m_alphaMod);
+		command.flip = flip;
+		const SDL_Rect& d = command.dest;
+		const double radians = std::fmod(angle, 360.0) * std::acos(-1.0) / 180.0;
+		command.rotated = std::abs(std::fmod(angle, 360.0)) > 1e-9;
+		if(!command.rotated) {
+			add(command, d);
+			return;
+		}
+		command.centerX = d.x + centerX * m_scale;
+		command.centerY = d.y + centerY * m_scale;
+		command.cosine = std::cos(radians);
+		command.sine = std::sin(radians);
+		// bounding box of the rotated corners
+		double x0 = 1e30, y0 = 1e30, x1 = -1e30, y1 = -1e30;
+		for(int corner = 0; corner < 4; ++corner) {
+			const double x = (corner & 1 ? d.x + d.w : d.x) - command.centerX;
+			const double y = (corner & 2 ? d.y + d.h : d.y) - command.centerY;
+			const double rx = command.centerX + x * command.cosine - y * command.sine;
+			const double ry = command.centerY + x * command.sine + y * command.cosine;
+			x0 = std::min(x0, rx);
+			y0 = std::min(y0, ry);
+			x1 = std::max(x1, rx);
+			y1 = std::max(y1, ry);
+		}
+		const int bx = static_cast<int>(std::floor(x0));
+		const int by = static_cast<int>(std::floor(y0));
+		add(command, SDL_Rect{ bx, by, static_cast<int>(std::ceil(x1)) - bx, static_cast<int>(std::ceil(y1)) - by });
+	}
+
+	// fills the whole target with the draw color, ignoring the viewport and blend mode
+	void clear()
+	{
+		Command command = makeCommand(Command::Type::Fill);
+		command.blend = SDL_BLENDMODE_NONE;
+		command.clip = SDL_Rect{ 0, 0, m_targetWidth, m_targetHeight };
+		add(command, command.clip);
+	}
+
+	// rasterizes everything recorded so far
+	void present()
+	{
+		flush();
+	}
+
+	// Scales drawing on the surface, not on texture targets, from a w by h area to the largest
+	// integer-free fit that keeps the aspect ratio, centered like SDL does it.
+	void setLogicalSize(int w, int h)
+	{
+		m_logicalWidth = w;
+		m_logicalHeight = h;
+		if(!m_texture) {
+			resetTarget();
+		}
+	}
+
+	// draws into texture from now on, or into the surface again for nullptr
+	void setRenderTarget(SoftwareTexture* texture)
+	{
+		flush();
+		m_texture = texture;
+		resetTarget();
+	}
+
+	SoftwareTexture* getRenderTarget() const
+	{
+		return m_texture;
+	}
+
+	bool isRenderTargetSupported() const
+	{
+		return true;
+	}
+
+	void setViewport(const SDL_Rect& rect)
+	{
+		m_viewport = rect;
+		updateClip();
+	}
+
+	void setViewportToEntireTarget()
+	{
+		m_viewport = SDL_Rect{ 0, 0, m_logicalTargetWidth, m_logicalTargetHeight };
+		updateClip();
+	}
+
+	void setDrawBlendMode(SDL_BlendMode blendMode)
+	{
+		m_blendMode = blendMode;
+	}
+
+	size_t pendingCommands() const
+	{
+		return m_commands.size();
+	}
+
+private:
+	struct Command
+	{
+		enum class Type : Uint8 { Fill, Line, Copy };
+
+		Type type;
+		SDL_BlendMode blend;
+		Uint32 color;
+		// target pixels the command may touch
+		SDL_Rect clip;
+		// Fill
+		SDL_Rect rect;
+		// Line
+		int x1, y1, x2, y2;
+		// Copy
+		const SoftwareTexture* texture;
+		SDL_Rect source;
+		SDL_Rect dest;
+		Uint32 modulate;
+		SDL_RendererFlip flip;
+		bool rotated;
+		double centerX, centerY, cosine, sine;
+	};
+
+	void replaceAlpha(const PixelView<Uint32>& view) const
+	{
+		parallelRows(view, [](PixelRow<Uint32> row, int) {
+			for(Uint32& pixel : row) {
+				pixel |= 0xFF000000u;
+			}
+		});
+	}
+
+	int toTargetX(int x) const
+	{
+		return m_offsetX + static_cast<int>(std::lround((m_viewport.x + x) * m_scale));
+	}
+
+	int toTargetY(int y) const
+	{
+		return m_offsetY + static_cast<int>(std::lround((m_viewport.y + y) * m_scale));
+	}
+
+	SDL_Rect toTarget(const SDL_Rect& rect) const
+	{
+		const int x0 = toTargetX(rect.x);
+		const int y0 = toTargetY(rect.y);
+		return SDL_Rect{ x0, y0, std::max(toTargetX(rect.x + rect.w) - x0, 1), std::max(toTargetY(rect.y + rect.h) - y0, 1) };
+	}
+
+	void resetTarget()
+	{
+		m_targetWidth = m_texture ? m_texture->m_width : m_surface.getWidth();
+		m_targetHeight = m_texture ? m_texture->m_height : m_surface.getHeight();
+		m_scale = 1.0;
+		m_offsetX = m_offsetY = 0;
+		m_logicalTargetWidth = m_targetWidth;
+		m_logicalTargetHeight = m_targetHeight;
+		if(!m_texture && m_logicalWidth > 0 && m_logicalHeight > 0) {
+			m_scale = std::min(static_cast<double>(m_targetWidth) / m_logicalWidth, static_cast<double>(m_targetHeight) / m_logicalHeight);
+			m_offsetX = static_cast<int>((m_targetWidth - m_logicalWidth * m_scale) / 2);
+			m_offsetY = static_cast<int>((m_targetHeight - m_logicalHeight * m_scale) / 2);
+			m_logicalTargetWidth = m_logicalWidth;
+			m_logicalTargetHeight = m_logicalHeight;
+		}
+		m_lineWidth = std::max(1, static_cast<int>(m_scale));
+		setViewportToEntireTarget();
+	}
+
+	void updateClip()
+	{
+		const int x0 = toTargetX(0);
+		const int y0 = toTargetY(0);
+		m_clip = detail::intersect(SDL_Rect{ x0, y0, toTargetX(m_viewport.w) - x0, toTargetY(m_viewport.h) - y0 }, SDL_Rect{ 0, 0, m_targetWidth, m_targetHeight });
+	}
+
+	Command makeCommand(Command::Type type) const
+	{
+		Command command{};
+		command.type = type;
+		command.blend = m_blendMode;
+		command.color = mapColor(m_color.r, m_color.g, m_color.b, m_color.a);
+		command.clip = m_clip;
+		return command;
+	}
+
+	void addFill(const SDL_Rect& rect)
+	{
+		Command command = makeCommand(Command::Type::Fill);
+		command.rect = rect;
+		add(command, rect);
+	}
+
+	// bins the command into every tile its bounds overlap
+	void add(Command& command, const SDL_Rect& bounds)
+	{
+		if(!record(command, bounds)) {
+			return;
+		}
+		const SDL_Rect& c = command.clip;
+		for(int ty = c.y / TileSize; ty <= (c.y + c.h - 1) / TileSize; ++ty) {
+			for(int tx = c.x / TileSize; tx <= (c.x + c.w - 1) / TileSize; ++tx) {
+				bin(tx, ty);
+			}
+		}
+	}
+
+	// only into the tiles the line passes through, long diagonals would touch most of the screen
+	void addLine(Command& command, const SDL_Rect& bounds)
+	{
+		if(!record(command, bounds)) {
+			return;
+		}
+		const LineSteps line(command);
+		const SDL_Rect& c = command.clip;
+		const int majorClipStart = line.xMajor ? c.x : c.y;
+		const int majorClipEnd = majorClipStart + (line.xMajor ? c.w : c.h) - 1;
+		const int minorClipStart = line.xMajor ? c.y : c.x;
+		const int minorClipEnd = minorClipStart + (line.xMajor ? c.h : c.w) - 1;
+		for(int band = majorClipStart / TileSize; band <= majorClipEnd / TileSize; ++band) {
+			int first, last;
+			line.range(std::max(band * TileSize, majorClipStart), std::min(band * TileSize + TileSize - 1, majorClipEnd), first, last);
+			if(first > last) {
+				continue;
+			}
+			const int a = std::max(std::min(line.across(first), line.across(last)), minorClipStart);
+			const int b = std::min(std::max(line.across(first), line.across(last)), minorClipEnd);
+			for(int tile = a / TileSize; tile <= b / TileSize; ++tile) {
+				bin(line.xMajor ? band : tile, line.xMajor ? tile : band);
+			}
+		}
+	}
+
+	// keeps the command if any of it is inside its clip
+	bool record(Command& command, const SDL_Rect& bounds)
+	{
+		command.clip = detail::intersect(command.clip, bounds);
+		if(command.clip.w <= 0 || command.clip.h <= 0) {
+			return false;
+		}
+		const int columns = (m_targetWidth + TileSize - 1) / TileSize;
+		const int rows = (m_targetHeight + TileSize - 1) / TileSize;
+		m_tiles.resize(static_cast<size_t>(columns) * rows);
+		m_commands.push_back(command);
+		return true;
+	}
+
+	// adds the last recorded command to a tile
+	void bin(int tx, int ty)
+	{
+		const int columns = (m_targetWidth + TileSize - 1) / TileSize;
+		std::vector<Uint32>& tile = m_tiles[static_cast<size_t>(ty) * columns + tx];
+		if(tile.empty()) {
+			m_busyTiles.push_back(static_cast<Uint32>(ty * columns + tx));
+		}
+		tile.push_back(static_cast<Uint32>(m_commands.size() - 1));
+	}
+
+	void flush()
+	{
+		if(m_commands.empty()) {
+			return;
+		}
+		const int columns = (m_targetWidth + TileSize - 1) / TileSize;
+		auto run = [&](PixelView<Uint32> target) {
+			auto rasterizeTile = [&](size_t busy) {
+				const Uint32 tile = m_busyTiles[busy];
+				const int x = static_cast<int>(tile % columns) * TileSize;
+				const int y = static_cast<int>(tile / columns) * TileSize;
+				const SDL_Rect area{ x, y, TileSize, TileSize };
+				for(Uint32 index : m_tiles[tile]) {
+					rasterize(m_commands[index], target, detail::intersect(m_commands[index].clip, area));
+				}
+			};
+			if(m_pool && m_busyTiles.size() > 1) {
+				m_pool->parallelFor(m_busyTiles.size(), rasterizeTile);
+			}
+			else {
+				for(size_t busy = 0; busy < m_busyTiles.size(); ++busy) {
+					rasterizeTile(busy);
+				}
+			}
+		};
+		if(m_texture) {
+			run(m_texture->view());
+		}
+		else {
+			ReSDL::SurfaceLock lock(m_surface);
+			run(lock.view<Uint32>());
+		}
+		for(Uint32 tile : m_busyTiles) {
+			m_tiles[tile].clear();
+		}
+		m_busyTiles.clear();
+		m_commands.clear();
+	}
+
+	// draws the part of the command inside area, which lies within one tile
+	void rasterize(const Command& command, const PixelView<Uint32>& target, const SDL_Rect& area) const
+	{
+		if(area.w <= 0 || area.h <= 0) {
+			return;
+		}
+		Uint32 scratch[TileSize];
+		switch(command.type) {
+		case Command::Type::Fill:
+			if(command.blend == SDL_BLENDMODE_NONE) {
+				for(int y = area.y; y < area.y + area.h; ++y) {
+					detail::fillRow(&target(area.x, y), area.w, command.color);
+				}
+				break;
+			}
+			std::fill(scratch, scratch + area.w, command.color);
+			for(int y = area.y; y < area.y + area.h; ++y) {
+				detail::blendSpan(&target(area.x, y), scratch, area.w, command.blend);
+			}
+			break;
+		case Command::Type::Line:
+			rasterizeLine(command, target, area);
+			break;
+		case Command::Type::Copy:
+			rasterizeCopy(command, target, area, scratch);
+			break;
+		}
+	}
+
+	// Bresenham's line, evaluated in closed form so every tile can start at its first step
+	struct LineSteps
+	{
+		explicit LineSteps(const Command& command)
+		{
+			const int dx = command.x2 - command.x1;
+			const int dy = command.y2 - command.y1;
+			xMajor = std::abs(dx) >= std::abs(dy);
+			const int major = xMajor ? dx : dy;
+			const int minor = xMajor ? dy : dx;
+			steps = std::abs(major);
+			direction = major >= 0 ? 1 : -1;
+			minorDirection = minor >= 0 ? 1 : -1;
+			majorStart = xMajor ? command.x1 : command.y1;
+			minorStart = xMajor ? command.y1 : command.x1;
+			minorLength = std::abs(minor);
+		}
+
+		// the steps whose major coordinate lies within [from, to]
+		void range(int from, int to, int& first, int& last) const
+		{
+			first = std::max(direction > 0 ? from - majorStart : majorStart - to, 0);
+			last = std::min(direction > 0 ? to - majorStart : majorStart - from, steps);
+		}
+
+		int along(int step) const
+		{
+			return majorStart + direction * step;
+		}
+
+		// minor coordinate of a step, rounded half up as the error term of Bresenham does
+		int across(int step) const
+		{
+			const Sint64 offset = steps ? (2 * static_cast<Sint64>(step) * minorLength + steps) / (2 * static_cast<Sint64>(steps)) : 0;
+			return minorStart + minorDirection * static_cast<int>(offset);
+		}
+
+		bool xMajor;
+		int steps;
+		int direction;
+		int minorDirection;
+		int majorStart;
+		int minorStart;
+		int minorLength;
+	};
+
+	void rasterizeLine(const Command& command, const PixelView<Uint32>& target, const SDL_Rect& area) const
+	{
+		const LineSteps line(command);
+		int first, last;
+		if(line.xMajor) {
+			line.range(area.x, area.x + area.w - 1, first, last);
+		}
+		else {
+			line.range(area.y, area.y + area.h - 1, first, last);
+		}
+		for(int i = first; i <= last; ++i) {
+			const int x = line.xMajor ? line.along(i) : line.across(i);
+			const int y = line.xMajor ? line.across(i) : line.along(i);
+			if(x >= area.x && x < area.x + area.w && y >= area.y && y < area.y + area.h) {
+				Uint32& pixel = target(x, y);
+				pixel = command.blend == SDL_BLENDMODE_NONE ? command.color : detail::blendPixel(command.color, pixel, command.blend);
+			}
+		}
+	}
+
+	void rasterizeCopy(const Command& command, const PixelView<Uint32>& target, const SDL_Rect& area, Uint32* scratch) const
+	{
+		const PixelView<const Uint32> texture = command.texture->view();
+		const SDL_Rect& src = command.source;
+		const SDL_Rect& dst = command.dest;
+		const bool flipX = (command.flip & SDL_FLIP_HORIZONTAL) != 0;
+		const bool flipY = (command.flip & SDL_FLIP_VERTICAL) != 0;
+		const bool modulate = command.modulate != mapColor(255, 255, 255, 255);
+		// source texel of a destination pixel, sampled at its center in 16.16 fixed point
+		const Sint64 stepX = (static_cast<Sint64>(src.w) << 16) / dst.w;
+		const Sint64 stepY = (static_cast<Sint64>(src.h) << 16) / dst.h;
+		for(int y = area.y; y < area.y + area.h; ++y) {
+			int begin = area.x;
+			int end = area.x + area.w;
+			if(!command.rotated) {
+				int v = static_cast<int>(((y - dst.y) * stepY + stepY / 2) >> 16);
+				v = flipY ? src.h - 1 - v : v;
+				const Uint32* row = texture.rowData(src.y + v);
+				if(!flipX && src.w == dst.w && !modulate) {
+					// unscaled, blend straight from the texture
+					detail::blendSpan(&target(begin, y), row + src.x + (begin - dst.x), end - begin, command.blend);
+					continue;
+				}
+				Sint64 u = (begin - dst.x) * stepX + stepX / 2;
+				for(int x = begin; x < end; ++x, u += stepX) {
+					const int texel = static_cast<int>(u >> 16);
+					scratch[x - begin] = row[src.x + (flipX ? src.w - 1 - texel : texel)];
+				}
+			}
+			else {
+				// rotated: map pixel centers back into the destination rectangle. Those inside form
+				// one run per row, since the rectangle is convex; solve for its ends, then test the
+				// pixels at the ends exactly
+				const double py = y + 0.5 - command.centerY;
+				const double rowX = command.centerX + py * command.sine - dst.x;
+				const double rowY = command.centerY + py * command.cosine - dst.y;
+				double lo = area.x, hi = area.x + area.w;
+				const double origin = area.x;
+				auto limit = [&lo, &hi, origin](double start, double slope, double length) {
+					// pixels origin + k with start + slope * k in [0, length)
+					if(std::abs(slope) < 1e-12) {
+						if(start < 0.0 || start >= length) {
+							hi = lo;
+						}
+						return;
+					}
+					const double a = -start / slope;
+					const double b = (length - start) / slope;
+					lo = std::max(lo, origin + std::floor(std::min(a, b)) - 1.0);
+					hi = std::min(hi, origin + std::ceil(std::max(a, b)) + 1.0);
+				};
+				const double originX = area.x + 0.5 - command.centerX;
+				limit(rowX + originX * command.cosine, command.cosine, dst.w);
+				limit(rowY - originX * command.sine, -command.sine, dst.h);
+				if(hi <= lo) {
+					continue;
+				}
+				// texel coordinates in 16.16 fixed point, stepped along the row
+				const double scaleU = 65536.0 * src.w / dst.w;
+				const double scaleV = 65536.0 * src.h / dst.h;
+				const int from = static_cast<int>(lo);
+				const double px = from + 0.5 - command.centerX;
+				Sint64 u = static_cast<Sint64>(std::floor((rowX + px * command.cosine) * scaleU));
+				Sint64 v = static_cast<Sint64>(std::floor((rowY - px * command.sine) * scaleV));
+				const Sint64 stepU = static_cast<Sint64>(command.cosine * scaleU);
+				const Sint64 stepV = static_cast<Sint64>(-command.sine * scaleV);
+				const Sint64 endU = static_cast<Sint64>(src.w) << 16;
+				const Sint64 endV = static_cast<Sint64>(src.h) << 16;
+				int count = 0;
+				for(int x = from; x < static_cast<int>(hi); ++x, u += stepU, v += stepV) {
+					if(u < 0 || v < 0 || u >= endU || v >= endV) {
+						if(count) {
+							break;
+						}
+						continue;
+					}
+					if(!count) {
+						begin = x;
+					}
+					const int tu = static_cast<int>(u >> 16);
+					const int tv = static_cast<int>(v >> 16);
+					scratch[count++] = texture(src.x + (flipX ? src.w - 1 - tu : tu), src.y + (flipY ? src.h - 1 - tv : tv));
+				}
+				if(!count) {
+					continue;
+				}
+				end = begin + count;
+			}
+			if(modulate) {
+				detail::modulateSpan(scratch, end - begin, command.modulate);
+			}
+			detail::blendSpan(&target(begin, y), scratch, end - begin, command.blend);
+		}
+	}
+
+	ReSDL::Surface& m_surface;
+	Concurrency::ThreadPool* m_pool;
+	Uint8 m_rShift = 16;
+	Uint8 m_gShift = 8;
+	Uint8 m_bShift = 0;
+
+	ReSDL::Color m_color{ 0, 0, 0, 255 };
+	SDL_BlendMode m_blendMode = SDL_BLENDMODE_NONE;
+	SoftwareTexture* m_texture = nullptr;
+	int m_targetWidth = 0;
+	int m_targetHeight = 0;
+	int m_logicalWidth = 0;
+	int m_logicalHeight = 0;
+	int m_logicalTargetWidth = 0;
+	int m_logicalTargetHeight = 0;
+	double m_scale = 1.0;
+	int m_offsetX = 0;
+	int m_offsetY = 0;
+	int m_lineWidth = 1;
+	SDL_Rect m_viewport{};
+	SDL_Rect m_clip{};
+
+	std::vector<Command> m_commands;
+	// command indices per tile, in recording order
+	std::vector<std::vector<Uint32>> m_tiles;
+	std::vector<Uint32> m_busyTiles;
+};
+
+}
+}
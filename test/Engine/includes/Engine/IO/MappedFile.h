@@ -0,0 +1,170 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+#include <algorithm>
+#include <cstdint>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace Engine {
+namespace IO {
+
+// A read-only memory mapping of a whole file. Pages are loaded by the OS on first access, so
+// opening is cheap no matter how large the file is; prefetch and release are hints to load
+// pages ahead of use and to drop pages that will not be read again.
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& path)
+	{
+#if defined(_WIN32)
+		m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if(m_file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("could not open " + path);
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(m_file, &size);
+		m_size = static_cast<size_t>(size.QuadPart);
+		if(m_size > 0) {
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			m_data = m_mapping ? static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+			if(!m_data) {
+				close();
+				throw std::runtime_error("could not map " + path);
+			}
+		}
+#else
+		m_file = ::open(path.c_str(), O_RDONLY);
+		if(m_file < 0) {
+			throw std::runtime_error("could not open " + path);
+		}
+		struct stat info;
+		if(fstat(m_file, &info) != 0) {
+			close();
+			throw std::runtime_error("could not stat " + path);
+		}
+		m_size = static_cast<size_t>(info.st_size);
+		if(m_size > 0) {
+			void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+			if(data == MAP_FAILED) {
+				close();
+				throw std::runtime_error("could not map " + path);
+			}
+			m_data = static_cast<const uint8_t*>(data);
+		}
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	const uint8_t* data() const
+	{
+		return m_data;
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	// asks the OS to start reading the range in
+	void prefetch(size_t offset, size_t length) const
+	{
+#if !defined(_WIN32)
+		advise(offset, length, MADV_WILLNEED);
+#else
+		(void)offset;
+		(void)length;
+#endif
+	}
+
+	// the range will not be read again soon, its pages may be dropped from memory
+	void release(size_t offset, size_t length) const
+	{
+#if !defined(_WIN32)
+		advise(offset, length, MADV_DONTNEED);
+#else
+		(void)offset;
+		(void)length;
+#endif
+	}
+
+	// the file is read front to back, the OS can read ahead more aggressively
+	void adviseSequential() const
+	{
+#if !defined(_WIN32)
+		advise(0, m_size, MADV_SEQUENTIAL);
+#endif
+	}
+
+private:
+#if !defined(_WIN32)
+	void advise(size_t offset, size_t length, int advice) const
+	{
+		if(!m_data || offset >= m_size) {
+			return;
+		}
+		// madvise wants page aligned addresses
+		const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		const size_t begin = offset / page * page;
+		const size_t end = std::min(offset + length, m_size);
+		madvise(const_cast<uint8_t*>(m_data) + begin, end - begin, advice);
+	}
+#endif
+
+	void close()
+	{
+#if defined(_WIN32)
+		if(m_data) {
+			UnmapViewOfFile(m_data);
+		}
+		if(m_mapping) {
+			CloseHandle(m_mapping);
+		}
+		if(m_file != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_file);
+		}
+		m_mapping = nullptr;
+		m_file = INVALID_HANDLE_VALUE;
+#else
+		if(m_data) {
+			munmap(const_cast<uint8_t*>(m_data), m_size);
+		}
+		if(m_file >= 0) {
+			::close(m_file);
+		}
+		m_file = -1;
+#endif
+		m_data = nullptr;
+	}
+
+#if defined(_WIN32)
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+#else
+	int m_file = -1;
+#endif
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+}
+}
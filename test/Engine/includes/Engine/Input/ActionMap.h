@@ -0,0 +1,432 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <initializer_list>
+#include <algorithm>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <Engine/Input/AxisInputManager.h>
+
+namespace Engine {
+	namespace Input {
+
+		using ActionId = uint16_t;
+
+		// A physical input in the dense numbering ActionMap uses for its input bitset.
+		// Controller and joystick buttons are per slot, see ActionMap::assignController.
+		using InputCode = uint16_t;
+
+		namespace InputCodes {
+			constexpr size_t Slots = 4;
+			constexpr size_t ButtonsPerSlot = 32;
+
+			constexpr InputCode KeyBase = 0;
+			constexpr InputCode MouseBase = SDL_NUM_SCANCODES;
+			constexpr InputCode ControllerBase = MouseBase + 32;
+			constexpr InputCode JoystickBase = ControllerBase + Slots * ButtonsPerSlot;
+			constexpr InputCode Count = JoystickBase + Slots * ButtonsPerSlot;
+
+			constexpr InputCode key(SDL_Scancode scancode)
+			{
+				return static_cast<InputCode>(KeyBase + scancode);
+			}
+
+			// SDL_BUTTON_LEFT and friends
+			constexpr InputCode mouse(Uint8 button)
+			{
+				return static_cast<InputCode>(MouseBase + (button & 31));
+			}
+
+			constexpr InputCode controller(size_t slot, SDL_GameControllerButton button)
+			{
+				return static_cast<InputCode>(ControllerBase + slot * ButtonsPerSlot + (button & 31));
+			}
+
+			constexpr InputCode joystick(size_t slot, int button)
+			{
+				return static_cast<InputCode>(JoystickBase + slot * ButtonsPerSlot + (button & 31));
+			}
+		}
+
+		// Maps physical inputs to named actions. Input and action states are kept as bitsets, so update
+		// derives Push, Hold and Release for every action with a couple of operations per 64 actions,
+		// and game code polls the result instead of registering callbacks. An action can have any number
+		// of bindings (keyboard, mouse, any controller slot) and a binding can be a chord of up to four
+		// inputs that all have to be down. Presses shorter than a frame still show up for one frame.
+		class ActionMap
+		{
+			using Word = uint64_t;
+			static constexpr size_t WordBits = 64;
+			static constexpr size_t InputWords = (InputCodes::Count + WordBits - 1) / WordBits;
+			static constexpr size_t MaxChord = 4;
+
+			struct Binding {
+				ActionId action;
+				uint8_t count;
+				std::array<InputCode, MaxChord> inputs;
+			};
+
+			std::vector<std::string> names;
+			std::unordered_map<std::string, ActionId> ids;
+
+			// single input bindings are the common case and only need a bit test
+			std::vector<std::pair<InputCode, ActionId>> singles;
+			std::vector<Binding> chords;
+
+			std::array<Word, InputWords> inputsDown{};
+			// inputs that went down since the last update, so a tap inside one frame still counts
+			std::array<Word, InputWords> inputsLatched{};
+
+			std::vector<Word> current;
+			std::vector<Word> previous;
+			std::vector<Word> pushed;
+			std::vector<Word> released;
+
+			std::array<SDL_JoystickID, InputCodes::Slots> controllerSlots;
+			std::array<SDL_JoystickID, InputCodes::Slots> joystickSlots;
+			// slots taken by slotOf rather than assigned, they are freed again when the device goes away
+			std::array<bool, InputCodes::Slots> controllerSlotsAutomatic{};
+			std::array<bool, InputCodes::Slots> joystickSlotsAutomatic{};
+
+			static bool test(const std::array<Word, InputWords>& bits, InputCode code)
+			{
+				return (bits[code / WordBits] >> (code % WordBits)) & 1;
+			}
+
+			static bool test(const std::vector<Word>& bits, ActionId action)
+			{
+				return (bits[action / WordBits] >> (action % WordBits)) & 1;
+			}
+
+			static int findSlot(const std::array<SDL_JoystickID, InputCodes::Slots>& slots, SDL_JoystickID which)
+			{
+				for (size_t slot = 0; slot < slots.size(); ++slot) {
+					if (slots[slot] == which) {
+						return static_cast<int>(slot);
+					}
+				}
+				return -1;
+			}
+
+			static int slotOf(std::array<SDL_JoystickID, InputCodes::Slots>& slots, std::array<bool, InputCodes::Slots>& automatic, SDL_JoystickID which)
+			{
+				const int found = findSlot(slots, which);
+				if (found >= 0) {
+					return found;
+				}
+				// devices nobody assigned take the first free slot
+				for (size_t slot = 0; slot < slots.size(); ++slot) {
+					if (slots[slot] == -1) {
+						slots[slot] = which;
+						automatic[slot] = true;
+						return static_cast<int>(slot);
+					}
+				}
+				return -1;
+			}
+
+			// Releases every button of the device's slot, so its actions do not stay held, and frees
+			// the slot if slotOf took it. Assigned slots stay assigned.
+			void removeDevice(std::array<SDL_JoystickID, InputCodes::Slots>& slots, std::array<bool, InputCodes::Slots>& automatic, InputCode base, SDL_JoystickID which)
+			{
+				const int slot = findSlot(slots, which);
+				if (slot < 0) {
+					return;
+				}
+				for (size_t button = 0; button < InputCodes::ButtonsPerSlot; ++button) {
+					setInput(static_cast<InputCode>(base + slot * InputCodes::ButtonsPerSlot + button), false);
+				}
+				if (automatic[slot]) {
+					slots[slot] = -1;
+					automatic[slot] = false;
+				}
+			}
+
+		public:
+			ActionMap()
+			{
+				controllerSlots.fill(-1);
+				joystickSlots.fill(-1);
+			}
+
+			// returns the id of the action with that name, adding it if necessary
+			ActionId action(const std::string& name)
+			{
+				auto it = ids.find(name);
+				if (it != ids.end()) {
+					return it->second;
+				}
+				const ActionId id = static_cast<ActionId>(names.size());
+				names.push_back(name);
+				ids.emplace(name, id);
+				const size_t words = (names.size() + WordBits - 1) / WordBits;
+				current.resize(words);
+				previous.resize(words);
+				pushed.resize(words);
+				released.resize(words);
+				return id;
+			}
+
+			const std::string& name(ActionId action) const
+			{
+				return names[action];
+			}
+
+			size_t actionCount() const
+			{
+				return names.size();
+			}
+
+			void bind(ActionId action, InputCode input)
+			{
+				singles.push_back({ input, action });
+			}
+
+			// all inputs have to be down at the same time, in any order
+			void bindChord(ActionId action, std::initializer_list<InputCode> inputs)
+			{
+				if (inputs.size() == 1) {
+					bind(action, *inputs.begin());
+					return;
+				}
+				Binding binding{ action, 0, {} };
+				for (InputCode input : inputs) {
+					if (binding.count < MaxChord) {
+						binding.inputs[binding.count++] = input;
+					}
+				}
+				chords.push_back(binding);
+			}
+
+			// binds the button on every controller slot
+			void bindAnyController(ActionId action, SDL_GameControllerButton button)
+			{
+				for (size_t slot = 0; slot < InputCodes::Slots; ++slot) {
+					bind(action, InputCodes::controller(slot, button));
+				}
+			}
+
+			void unbind(ActionId action)
+			{
+				singles.erase(std::remove_if(singles.begin(), singles.end(), [action](const auto& entry) { return entry.second == action; }), singles.end());
+				chords.erase(std::remove_if(chords.begin(), chords.end(), [action](const Binding& entry) { return entry.action == action; }), chords.end());
+			}
+
+			// pins a controller to a slot, e.g. for local multiplayer; -1 frees the slot
+			void assignController(size_t slot, SDL_JoystickID which)
+			{
+				controllerSlots[slot] = which;
+				controllerSlotsAutomatic[slot] = false;
+			}
+
+			void assignJoystick(size_t slot, SDL_JoystickID which)
+			{
+				joystickSlots[slot] = which;
+				joystickSlotsAutomatic[slot] = false;
+			}
+
+			// called for SDL_CONTROLLERDEVICEREMOVED and SDL_JOYDEVICEREMOVED by handleEvent
+			void removeController(SDL_JoystickID which)
+			{
+				removeDevice(controllerSlots, controllerSlotsAutomatic, InputCodes::ControllerBase, which);
+			}
+
+			void removeJoystick(SDL_JoystickID which)
+			{
+				removeDevice(joystickSlots, joystickSlotsAutomatic, InputCodes::JoystickBase, which);
+			}
+
+			void setInput(InputCode input, bool down)
+			{
+				if (input >= InputCodes::Count) {
+					return;
+				}
+				const Word bit = Word(1) << (input % WordBits);
+				if (down) {
+					inputsDown[input / WordBits] |= bit;
+					inputsLatched[input / WordBits] |= bit;
+				}
+				else {
+					inputsDown[input / WordBits] &= ~bit;
+				}
+			}
+
+			// reads the whole keyboard at once, for polling instead of key events
+			void captureKeyboard(const Uint8* state)
+			{
+				for (int code = 0; code < SDL_NUM_SCANCODES; ++code) {
+					setInput(InputCodes::key(static_cast<SDL_Scancode>(code)), state[code] != 0);
+				}
+			}
+
+			// key, mouse button, controller button and joystick button events, and device removal
+			void handleEvent(const SDL_Event& e)
+			{
+				switch (e.type) {
+				case SDL_KEYDOWN:
+				case SDL_KEYUP:
+					if (!e.key.repeat) {
+						setInput(InputCodes::key(e.key.keysym.scancode), e.type == SDL_KEYDOWN);
+					}
+					break;
+				case SDL_MOUSEBUTTONDOWN:
+				case SDL_MOUSEBUTTONUP:
+					setInput(InputCodes::mouse(e.button.button), e.type == SDL_MOUSEBUTTONDOWN);
+					break;
+				case SDL_CONTROLLERBUTTONDOWN:
+				case SDL_CONTROLLERBUTTONUP: {
+					const int slot = slotOf(controllerSlots, controllerSlotsAutomatic, e.cbutton.which);
+					if (slot >= 0) {
+						setInput(InputCodes::controller(slot, static_cast<SDL_GameControllerButton>(e.cbutton.button)), e.type == SDL_CONTROLLERBUTTONDOWN);
+					}
+					break;
+				}
+				case SDL_JOYBUTTONDOWN:
+				case SDL_JOYBUTTONUP: {
+					const int slot = slotOf(joystickSlots, joystickSlotsAutomatic, e.jbutton.which);
+					if (slot >= 0) {
+						setInput(InputCodes::joystick(slot, e.jbutton.button), e.type == SDL_JOYBUTTONDOWN);
+					}
+					break;
+				}
+				case SDL_CONTROLLERDEVICEREMOVED:
+					removeController(e.cdevice.which);
+					break;
+				case SDL_JOYDEVICEREMOVED:
+					removeJoystick(e.jdevice.which);
+					break;
+				}
+			}
+
+			// subscribes handleEvent to all event types it understands
+			std::vector<EventManager::Subscription> subscribe(EventManager& events, int priority = 0)
+			{
+				std::vector<EventManager::Subscription> subscriptions;
+				for (auto type : { SDL_KEYDOWN, SDL_KEYUP, SDL_MOUSEBUTTONDOWN, SDL_MOUSEBUTTONUP, SDL_CONTROLLERBUTTONDOWN, SDL_CONTROLLERBUTTONUP, SDL_JOYBUTTONDOWN, SDL_JOYBUTTONUP, SDL_CONTROLLERDEVICEREMOVED, SDL_JOYDEVICEREMOVED }) {
+					subscriptions.push_back(events.subscribe(type, [this](const SDL_Event& e) { handleEvent(e); }, priority));
+				}
+				return subscriptions;
+			}
+
+			// Computes the action states for this frame from the inputs seen since the last update.
+			void update()
+			{
+				std::array<Word, InputWords> effective;
+				for (size_t w = 0; w < InputWords; ++w) {
+					effective[w] = inputsDown[w] | inputsLatched[w];
+					inputsLatched[w] = 0;
+				}
+
+				previous.swap(current);
+				std::fill(current.begin(), current.end(), 0);
+				for (const auto& [input, action] : singles) {
+					current[action / WordBits] |= Word(test(effective, input)) << (action % WordBits);
+				}
+				for (const auto& binding : chords) {
+					bool down = true;
+					for (uint8_t i = 0; i < binding.count; ++i) {
+						down = down && test(effective, binding.inputs[i]);
+					}
+					current[binding.action / WordBits] |= Word(down) << (binding.action % WordBits);
+				}
+
+				for (size_t w = 0; w < current.size(); ++w) {
+					pushed[w] = current[w] & ~previous[w];
+					released[w] = previous[w] & ~current[w];
+				}
+			}
+
+			bool isDown(ActionId action) const
+			{
+				return test(current, action);
+			}
+
+			bool wasPushed(ActionId action) const
+			{
+				return test(pushed, action);
+			}
+
+			bool wasReleased(ActionId action) const
+			{
+				return test(released, action);
+			}
+
+			bool isHeld(ActionId action) const
+			{
+				return test(current, action) && test(previous, action);
+			}
+
+			ButtonState state(ActionId action) const
+			{
+				if (test(pushed, action)) {
+					return ButtonState::Push;
+				}
+				if (test(released, action)) {
+					return ButtonState::Release;
+				}
+				return test(current, action) ? ButtonState::Hold : ButtonState::Off;
+			}
+
+			bool anyPushed() const
+			{
+				return std::any_of(pushed.begin(), pushed.end(), [](Word word) { return word != 0; });
+			}
+
+			// calls func(action) for every action pushed this frame, in id order
+			template<typename Func>
+			void forEachPushed(Func&& func) const
+			{
+				forEachSet(pushed, func);
+			}
+
+			template<typename Func>
+			void forEachReleased(Func&& func) const
+			{
+				forEachSet(released, func);
+			}
+
+			template<typename Func>
+			void forEachDown(Func&& func) const
+			{
+				forEachSet(current, func);
+			}
+
+		private:
+			static size_t lowestBit(Word word)
+			{
+#if defined(__GNUC__) || defined(__clang__)
+				return static_cast<size_t>(__builtin_ctzll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+				unsigned long index;
+				_BitScanForward64(&index, word);
+				return index;
+#else
+				size_t bit = 0;
+				while (!((word >> bit) & 1)) {
+					++bit;
+				}
+				return bit;
+#endif
+			}
+
+			template<typename Func>
+			static void forEachSet(const std::vector<Word>& bits, Func& func)
+			{
+				for (size_t w = 0; w < bits.size(); ++w) {
+					Word word = bits[w];
+					while (word) {
+						func(static_cast<ActionId>(w * WordBits + lowestBit(word)));
+						word &= word - 1;
+					}
+				}
+			}
+		};
+
+	}
+}
@@ -7,6 +7,14 @@
 //
 
 #pragma once
+#include <array>
+#include <bitset>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <Engine/Input/EventManager.h>
+#include <Engine/Input/InputSampler.h>
 #include <Engine/Utilities.h>
 
 namespace Engine {
@@ -120,184 +128,755 @@ namespace Engine {
 			}
 		};
 
+		constexpr size_t AxisCount = static_cast<size_t>(Axis::Aux_9) + 1;
+		constexpr size_t RadialCount = static_cast<size_t>(Radial::Aux_9) + 1;
+		constexpr size_t ButtonCount = static_cast<size_t>(Button::Stick_Right) + 1;
+
+		template<typename Enum>
+		constexpr size_t indexOf(Enum value)
+		{
+			return static_cast<size_t>(value);
+		}
+
+		enum class InputMode {
+			// every mapped input is read every frame and every handler is called every frame
+			Polling,
+			// inputs are updated from SDL events and handlers are only called on change
+			EventDriven
+		};
+
+		// Everything the devices reported for one frame, indexed by Axis, Radial and Button.
+		// Axes and radials without a value this frame are left out of the *Set masks.
+		// In event driven mode the *Timestamps hold the SDL timestamp of the last event that changed a value.
+		struct InputSnapshot {
+			std::array<double, AxisCount> axes{};
+			std::array<Vec2d, RadialCount> radials{};
+			std::array<ButtonState, ButtonCount> buttons{};
+			std::bitset<AxisCount> axisSet;
+			std::bitset<RadialCount> radialSet;
+			std::array<Uint32, AxisCount> axisTimestamps{};
+			std::array<Uint32, RadialCount> radialTimestamps{};
+			std::array<Uint32, ButtonCount> buttonTimestamps{};
+
+			void clear()
+			{
+				axisSet.reset();
+				radialSet.reset();
+				buttons.fill(ButtonState::Off);
+			}
+
+			void setAxis(Axis axis, double value)
+			{
+				axes[indexOf(axis)] = value;
+				axisSet.set(indexOf(axis));
+			}
+
+			void setRadial(Radial radial, const Vec2d& value)
+			{
+				radials[indexOf(radial)] = value;
+				radialSet.set(indexOf(radial));
+			}
+
+			void setButton(Button button, ButtonState state)
+			{
+				buttons[indexOf(button)] = state;
+			}
+		};
+
+		struct ButtonTransition {
+			Button button;
+			ButtonState state;
+			Uint32 timestamp;
+		};
+
+		// replaces device polling, e.g. to replay a recorded session
+		class IInputSource {
+		public:
+			virtual ~IInputSource() = default;
+			// fills the values for the next frame, returns false when there are no more frames
+			virtual bool read(InputSnapshot& snapshot) = 0;
+		};
+
+		// receives the values of every frame before they are submitted to the handlers
+		class IInputSink {
+		public:
+			virtual ~IInputSink() = default;
+			virtual void write(const InputSnapshot& snapshot) = 0;
+		};
+
 		class AxisInputManager
 		{
 			using SDL_JoystickAxisId = int;
-			std::map<Uint8, KeyMapping> keys;
-			std::map<std::pair<Uint8, Uint8>, KeyMapping> keyPairs;
-			std::map<Radial, KeyCross> keyQuads;
-			std::map<std::shared_ptr<ReSDL::Joystick>, std::map<SDL_JoystickAxisId, S16Mapping>> joysticks;
-			std::map<std::shared_ptr<ReSDL::GameController>, std::map<SDL_GameControllerAxis, S16Mapping>> controllerMapping;
-			std::map<std::shared_ptr<ReSDL::GameController>, std::map<std::pair<SDL_GameControllerAxis, SDL_GameControllerAxis>, S16RadialMapping>> controllerRadialMapping;
-			std::map<std::shared_ptr<ReSDL::GameController>, RadialControllerMapping> controllerRadialButtonMapping;
-			std::map<Axis, AxisInputHandlerFunc> handlers;
-			std::map<Radial, RadialInputHandlerFunc> radialHandlers;
-
-			std::map<Uint8, Button> keyButtons;
-			std::map<std::shared_ptr<ReSDL::Joystick>, std::map<Uint8, Button>> joystickButtons;
-			std::map<std::shared_ptr<ReSDL::GameController>, std::map<SDL_GameControllerButton, Button>> controllerButtons;
-			
-			std::map<Button, ButtonStateHandler> buttonHandlers;
-			
+
+			struct KeyAxisMapping {
+				Uint8 key;
+				KeyMapping mapping;
+			};
+
+			struct KeyPairMapping {
+				Uint8 keyMin;
+				Uint8 keyMax;
+				KeyMapping mapping;
+			};
+
+			struct KeyCrossMapping {
+				Radial radial;
+				KeyCross cross;
+			};
+
+			struct KeyButtonMapping {
+				Uint8 key;
+				Button button;
+			};
+
+			// instanceId identifies the device in SDL events, the raw fields keep the last
+			// value seen in event driven mode
+
+			struct JoystickAxisMapping {
+				ReSDL::Joystick* joystick;
+				SDL_JoystickAxisId joystickAxis;
+				S16Mapping mapping;
+				SDL_JoystickID instanceId;
+			};
+
+			struct ControllerAxisMapping {
+				ReSDL::GameController* controller;
+				SDL_GameControllerAxis controllerAxis;
+				S16Mapping mapping;
+				SDL_JoystickID instanceId;
+			};
+
+			struct ControllerRadialMapping {
+				ReSDL::GameController* controller;
+				SDL_GameControllerAxis controllerAxisX;
+				SDL_GameControllerAxis controllerAxisY;
+				S16RadialMapping mapping;
+				SDL_JoystickID instanceId;
+				Sint16 rawX;
+				Sint16 rawY;
+			};
+
+			struct ControllerCrossMapping {
+				ReSDL::GameController* controller;
+				RadialControllerMapping mapping;
+				SDL_JoystickID instanceId;
+				Cross<bool> pressed;
+			};
+
+			struct ControllerButtonMapping {
+				ReSDL::GameController* controller;
+				SDL_GameControllerButton controllerButton;
+				Button button;
+				SDL_JoystickID instanceId;
+				bool pressed;
+			};
+
+			// mapping tables are flat and walked in order every frame; the shared_ptrs only keep the devices alive
+			std::vector<KeyButtonMapping> keyButtons;
+			std::vector<KeyAxisMapping> keys;
+			std::vector<KeyPairMapping> keyPairs;
+			std::vector<KeyCrossMapping> keyQuads;
+			std::vector<JoystickAxisMapping> joystickAxes;
+			std::vector<ControllerAxisMapping> controllerAxes;
+			std::vector<ControllerRadialMapping> controllerRadials;
+			std::vector<ControllerCrossMapping> controllerCrosses;
+			std::vector<ControllerButtonMapping> controllerButtons;
+			std::vector<std::shared_ptr<ReSDL::Joystick>> joysticks;
+			std::vector<std::shared_ptr<ReSDL::GameController>> controllers;
+
+			std::array<AxisInputHandlerFunc, AxisCount> handlers;
+			std::array<RadialInputHandlerFunc, RadialCount> radialHandlers;
+			std::array<ButtonStateHandler, ButtonCount> buttonHandlers;
+
+			InputSnapshot snapshot;
+
 			const Sint16 deadZone = 1000;
 
-			void handleKeyState(std::map<Axis, double> &values, std::map<Radial, Vec2d>& radialValues, std::map<Button, ButtonState>& buttonValues) const
+			// event driven mode
+			InputMode mode = InputMode::Polling;
+			double changeThreshold = 0.01;
+			bool needsSeed = true;
+			std::bitset<SDL_NUM_SCANCODES> keyState;
+			std::array<Uint8, ButtonCount> buttonSources{};
+			std::array<double, AxisCount> submittedAxes{};
+			std::array<Vec2d, RadialCount> submittedRadials{};
+			std::bitset<AxisCount> submittedAxisSet;
+			std::bitset<RadialCount> submittedRadialSet;
+			// reserved when event driven mode starts; only a burst of more changes in one frame than
+			// ever before grows it
+			std::vector<ButtonTransition> transitions;
+			bool seeding = false;
+			Uint32 currentTimestamp = 0;
+			Uint64 pendingInputReceivedAt = 0;
+			Uint64 frameInputReceivedAt = 0;
+
+			EventManager* subscribedEvents = nullptr;
+			std::vector<EventManager::Subscription> subscriptions;
+
+			InputSampler* sampler = nullptr;
+			IInputSource* source = nullptr;
+			IInputSink* sink = nullptr;
+
+			template<typename Entry, typename Predicate>
+			void insertOrAssign(std::vector<Entry>& table, const Entry& entry, Predicate matches)
+			{
+				auto it = std::find_if(table.begin(), table.end(), matches);
+				if (it != table.end()) {
+					*it = entry;
+				}
+				else {
+					table.push_back(entry);
+				}
+				needsSeed = true;
+			}
+
+			template<typename Device>
+			static void retain(std::vector<std::shared_ptr<Device>>& devices, const std::shared_ptr<Device>& device)
+			{
+				if (std::find(devices.begin(), devices.end(), device) == devices.end()) {
+					devices.push_back(device);
+				}
+			}
+
+			static Vec2d crossValue(bool l, bool r, bool u, bool d)
+			{
+				Vec2d value{};
+				const double val = (l || r) && (u || d) ? 0.707 : 1.0;
+				value.x() = l ? -val : r ?  val : 0.0;
+				value.y() = d ?  val : u ? -val : 0.0;
+				return value;
+			}
+
+			void handleKeyState(InputSnapshot& values) const
 			{
 				const Uint8 *state = SDL_GetKeyboardState(NULL);
 				
 				for (const auto& [key, button] : keyButtons) 
 				{
 					if (state[key]) {
-						buttonValues[button] = ButtonState::Hold;
+						values.setButton(button, ButtonState::Hold);
 					}
 				}
 
 				for (const auto& [key, mapping] : keys)
 				{
-					values[mapping.axis] = state[key] ? mapping.maxValue : mapping.offValue;
+					values.setAxis(mapping.axis, state[key] ? mapping.maxValue : mapping.offValue);
 				}
 
-				for (const auto& [ keypair, mapping ] : keyPairs)
+				for (const auto& [keyMin, keyMax, mapping] : keyPairs)
 				{
-					values[mapping.axis] = state[keypair.first] ? mapping.minValue : state[keypair.second] ? mapping.maxValue : mapping.offValue;
+					values.setAxis(mapping.axis, state[keyMin] ? mapping.minValue : state[keyMax] ? mapping.maxValue : mapping.offValue);
 				}
 				
-				for (const auto& [ radial, keycross] : keyQuads)
+				for (const auto& [radial, keycross] : keyQuads)
 				{
-					Vec2d value{};
-					const bool
-						l = state[keycross.left],
-						r = state[keycross.right],
-						u = state[keycross.up],
-						d = state[keycross.down];
-
-					const double val = (l || r) && (u || d) ? 0.707 : 1.0;
-					value.x() = l ? -val : r ?  val : 0.0;
-					value.y() = d ?  val : u ? -val : 0.0;
-					
-					radialValues[radial] = value;
+					values.setRadial(radial, crossValue(state[keycross.left], state[keycross.right], state[keycross.up], state[keycross.down]));
 				}
 			}
 			
-			void handleJoysticks(std::map<Axis, double> &values) const
+			void handleJoysticks(InputSnapshot& values) const
 			{
-				for(const auto& [ joystick, mappings ] : joysticks)
+				for (const auto& entry : joystickAxes)
 				{
-					for(const auto& [ joyAxis, mapping ] : mappings)
-					{
-						const Sint16 axisValue = joystick->getAxis(joyAxis);
-						if (abs(axisValue) > deadZone) {
-							values[mapping.axis] = mapping.mappingFunc(axisValue);
-						}
+					const Sint16 axisValue = entry.joystick->getAxis(entry.joystickAxis);
+					if (abs(axisValue) > deadZone) {
+						values.setAxis(entry.mapping.axis, entry.mapping.mappingFunc(axisValue));
 					}
 				}
 			}
 			
-			void handleGameControllers(std::map<Axis, double> &values, std::map<Radial, Vec2d>& radialValues, std::map<Button, ButtonState>& buttonValues) const
+			void handleGameControllers(InputSnapshot& values) const
 			{
-				for(const auto& [ controller, mappings ] : controllerButtons)
+				for (const auto& entry : controllerButtons)
 				{
-					for(const auto& [ controllerButton, button ] : mappings)
-					{					
-						if (controller->getButton(controllerButton)) {
-							buttonValues[button] = ButtonState::Hold;
-						}
+					if (entry.controller->getButton(entry.controllerButton)) {
+						values.setButton(entry.button, ButtonState::Hold);
 					}
 				}
 
-				for(const auto& [ controller, mappings ] : controllerMapping)
+				for (const auto& entry : controllerAxes)
 				{
-					for(const auto& [ conAxis, mapping ] : mappings)
-					{
-						const Sint16 axisValue = controller->getAxis(conAxis);
-						if (abs(axisValue) > deadZone) {
-							values[mapping.axis] = mapping.mappingFunc(axisValue);
-						}
+					const Sint16 axisValue = entry.controller->getAxis(entry.controllerAxis);
+					if (abs(axisValue) > deadZone) {
+						values.setAxis(entry.mapping.axis, entry.mapping.mappingFunc(axisValue));
 					}
 				}
 
-				for (const auto& [controller, mappings] : controllerRadialMapping)
+				for (const auto& entry : controllerRadials)
 				{
-					for (const auto& [conAxis, mapping] : mappings)
-					{
-						const auto valueX = controller->getAxis(conAxis.first);
-						const auto valueY = controller->getAxis(conAxis.second);
-						if (abs(valueX) > deadZone || abs(valueY) > deadZone) {
-							radialValues[mapping.radial] = mapping.mappingFunc(valueX, valueY);
-						}
+					const auto valueX = entry.controller->getAxis(entry.controllerAxisX);
+					const auto valueY = entry.controller->getAxis(entry.controllerAxisY);
+					if (abs(valueX) > deadZone || abs(valueY) > deadZone) {
+						values.setRadial(entry.mapping.radial, entry.mapping.mappingFunc(valueX, valueY));
 					}
 				}
 
-				for (const auto& [ controller, mapping] : controllerRadialButtonMapping)
+				for (const auto& entry : controllerCrosses)
 				{
-					Vec2d value{};
-					const bool
-						l = controller->getButton(mapping.cross.left),
-						r = controller->getButton(mapping.cross.right),
-						u = controller->getButton(mapping.cross.up),
-						d = controller->getButton(mapping.cross.down);
-
-					const double val = (l || r) && (u || d) ? 0.707 : 1.0;
-					value.x() = l ? -val : r ?  val : 0.0;
-					value.y() = d ?  val : u ? -val : 0.0;
-					
-					radialValues[mapping.radial] = value;
+					const auto& cross = entry.mapping.cross;
+					values.setRadial(entry.mapping.radial, crossValue(
+						entry.controller->getButton(cross.left),
+						entry.controller->getButton(cross.right),
+						entry.controller->getButton(cross.up),
+						entry.controller->getButton(cross.down)));
 				}
 			}
 			
-			void submitValues(const std::map<Axis, double> &values, const std::map<Radial, Vec2d>& radialValues, const std::map<Button, ButtonState>& buttonValues)
+			double mapAxis(const S16Mapping& mapping, Sint16 value) const
+			{
+				return mapping.mappingFunc(abs(value) > deadZone ? value : 0);
+			}
+
+			Vec2d mapRadial(const S16RadialMapping& mapping, Sint16 x, Sint16 y) const
+			{
+				return abs(x) > deadZone || abs(y) > deadZone ? mapping.mappingFunc(x, y) : mapping.mappingFunc(0, 0);
+			}
+
+			void changeAxis(Axis axis, double value, Uint32 timestamp)
 			{
-				for(const auto& [axis, handler] : handlers) {
-					if(values.count(axis))
-					{
-						handler(axis, values.at(axis));
+				snapshot.setAxis(axis, value);
+				snapshot.axisTimestamps[indexOf(axis)] = timestamp;
+			}
+
+			void changeRadial(Radial radial, const Vec2d& value, Uint32 timestamp)
+			{
+				snapshot.setRadial(radial, value);
+				snapshot.radialTimestamps[indexOf(radial)] = timestamp;
+			}
+
+			// several inputs may be bound to one button, it is held while any of them is down
+			void changeButtonSource(Button button, bool pressed, Uint32 timestamp)
+			{
+				Uint8& sources = buttonSources[indexOf(button)];
+				if (pressed) {
+					if (sources++ != 0) {
+						return;
+					}
+				}
+				else {
+					if (sources == 0 || --sources != 0) {
+						return;
 					}
 				}
+				snapshot.setButton(button, pressed ? ButtonState::Hold : ButtonState::Off);
+				snapshot.buttonTimestamps[indexOf(button)] = timestamp;
+				// seed compares the replayed state with what the handlers saw instead
+				if (!seeding) {
+					transitions.push_back({ button, pressed ? ButtonState::Push : ButtonState::Release, timestamp });
+				}
+			}
 
-				for (const auto& [radial, handler] : radialHandlers) {
-					if (radialValues.count(radial))
-					{
-						handler(radial, radialValues.at(radial));
+			// Hold or Off as the button's handler will have seen it once the pending transitions are submitted
+			ButtonState reportedState(size_t button) const
+			{
+				for (auto it = transitions.rbegin(); it != transitions.rend(); ++it) {
+					if (indexOf(it->button) == button) {
+						return it->state == ButtonState::Push ? ButtonState::Hold : ButtonState::Off;
 					}
 				}
+				return buttonHandlers[button].previousState == ButtonState::Hold ? ButtonState::Hold : ButtonState::Off;
+			}
 
-				for (auto& [button, handler] : buttonHandlers) {
-					if (buttonValues.count(button))
-					{
-						handler.handle(button, buttonValues.at(button));
+			void changeKey(Uint32 code, bool pressed, Uint32 timestamp)
+			{
+				if (code >= keyState.size() || keyState[code] == pressed) {
+					return;
+				}
+				keyState[code] = pressed;
+
+				for (const auto& [key, button] : keyButtons) {
+					if (key == code) {
+						changeButtonSource(button, pressed, timestamp);
+					}
+				}
+				for (const auto& [key, mapping] : keys) {
+					if (key == code) {
+						changeAxis(mapping.axis, pressed ? mapping.maxValue : mapping.offValue, timestamp);
+					}
+				}
+				for (const auto& [keyMin, keyMax, mapping] : keyPairs) {
+					if (keyMin == code || keyMax == code) {
+						changeAxis(mapping.axis, keyState[keyMin] ? mapping.minValue : keyState[keyMax] ? mapping.maxValue : mapping.offValue, timestamp);
+					}
+				}
+				for (const auto& [radial, keycross] : keyQuads) {
+					if (keycross.left == code || keycross.right == code || keycross.up == code || keycross.down == code) {
+						changeRadial(radial, crossValue(keyState[keycross.left], keyState[keycross.right], keyState[keycross.up], keyState[keycross.down]), timestamp);
+					}
+				}
+			}
+
+			void changeControllerAxis(SDL_JoystickID which, Uint8 axis, Sint16 value, Uint32 timestamp)
+			{
+				for (const auto& entry : controllerAxes) {
+					if (entry.instanceId == which && entry.controllerAxis == axis) {
+						changeAxis(entry.mapping.axis, mapAxis(entry.mapping, value), timestamp);
+					}
+				}
+				for (auto& entry : controllerRadials) {
+					const bool isX = entry.controllerAxisX == axis;
+					if (entry.instanceId != which || (!isX && entry.controllerAxisY != axis)) {
+						continue;
+					}
+					(isX ? entry.rawX : entry.rawY) = value;
+					changeRadial(entry.mapping.radial, mapRadial(entry.mapping, entry.rawX, entry.rawY), timestamp);
+				}
+			}
+
+			void changeControllerButton(SDL_JoystickID which, Uint8 controllerButton, bool pressed, Uint32 timestamp)
+			{
+				for (auto& entry : controllerButtons) {
+					if (entry.instanceId == which && entry.controllerButton == controllerButton && entry.pressed != pressed) {
+						entry.pressed = pressed;
+						changeButtonSource(entry.button, pressed, timestamp);
+					}
+				}
+				for (auto& entry : controllerCrosses) {
+					if (entry.instanceId != which) {
+						continue;
+					}
+					const auto& cross = entry.mapping.cross;
+					bool* target = cross.left == controllerButton ? &entry.pressed.left
+						: cross.right == controllerButton ? &entry.pressed.right
+						: cross.up == controllerButton ? &entry.pressed.up
+						: cross.down == controllerButton ? &entry.pressed.down
+						: nullptr;
+					if (target) {
+						*target = pressed;
+						changeRadial(entry.mapping.radial, crossValue(entry.pressed.left, entry.pressed.right, entry.pressed.up, entry.pressed.down), timestamp);
+					}
+				}
+			}
+
+			void changeJoystickAxis(SDL_JoystickID which, Uint8 axis, Sint16 value, Uint32 timestamp)
+			{
+				for (const auto& entry : joystickAxes) {
+					if (entry.instanceId == which && entry.joystickAxis == axis) {
+						changeAxis(entry.mapping.axis, mapAxis(entry.mapping, value), timestamp);
+					}
+				}
+			}
+
+			void unsubscribe()
+			{
+				if (subscribedEvents) {
+					for (auto subscription : subscriptions) {
+						subscribedEvents->unsubscribe(subscription);
+					}
+				}
+				subscriptions.clear();
+				subscribedEvents = nullptr;
+			}
+
+			// Reads the current device state once, so event driven mode starts from the right values.
+			// Runs again after mappings or devices change; buttons only report a transition if
+			// the state read differs from the one their handler last saw.
+			void seed()
+			{
+				const Uint32 now = SDL_GetTicks();
+				seeding = true;
+				const Uint8 *state = SDL_GetKeyboardState(NULL);
+				keyState.reset();
+				buttonSources.fill(0);
+				snapshot.clear();
+				for (const auto& [key, mapping] : keys) {
+					changeAxis(mapping.axis, mapping.offValue, now);
+				}
+				for (const auto& [keyMin, keyMax, mapping] : keyPairs) {
+					changeAxis(mapping.axis, mapping.offValue, now);
+				}
+				for (const auto& [radial, keycross] : keyQuads) {
+					changeRadial(radial, Vec2d{}, now);
+				}
+				for (size_t code = 0; code < keyState.size(); ++code) {
+					if (state[code]) {
+						changeKey(static_cast<Uint32>(code), true, now);
+					}
+				}
+				for (auto& entry : controllerButtons) {
+					entry.pressed = false;
+				}
+				for (auto& entry : controllerButtons) {
+					changeControllerButton(entry.instanceId, static_cast<Uint8>(entry.controllerButton), entry.controller->getButton(entry.controllerButton), now);
+				}
+				for (auto& entry : controllerCrosses) {
+					entry.pressed = {};
+					changeRadial(entry.mapping.radial, Vec2d{}, now);
+					const auto& cross = entry.mapping.cross;
+					for (auto button : { cross.up, cross.down, cross.left, cross.right }) {
+						changeControllerButton(entry.instanceId, static_cast<Uint8>(button), entry.controller->getButton(button), now);
+					}
+				}
+				for (auto& entry : controllerAxes) {
+					changeControllerAxis(entry.instanceId, static_cast<Uint8>(entry.controllerAxis), entry.controller->getAxis(entry.controllerAxis), now);
+				}
+				for (auto& entry : controllerRadials) {
+					entry.rawX = entry.controller->getAxis(entry.controllerAxisX);
+					entry.rawY = entry.controller->getAxis(entry.controllerAxisY);
+					changeRadial(entry.mapping.radial, mapRadial(entry.mapping, entry.rawX, entry.rawY), now);
+				}
+				for (auto& entry : joystickAxes) {
+					changeJoystickAxis(entry.instanceId, static_cast<Uint8>(entry.joystickAxis), entry.joystick->getAxis(entry.joystickAxis), now);
+				}
+				seeding = false;
+				for (size_t i = 0; i < ButtonCount; ++i) {
+					const bool held = buttonSources[i] != 0;
+					if (held != (reportedState(i) == ButtonState::Hold)) {
+						transitions.push_back({ static_cast<Button>(i), held ? ButtonState::Push : ButtonState::Release, now });
+					}
+				}
+				needsSeed = false;
+			}
+
+			void submitChanges()
+			{
+				for (size_t i = 0; i < AxisCount; ++i) {
+					if (!handlers[i] || !snapshot.axisSet[i]) {
+						continue;
+					}
+					if (submittedAxisSet[i] && std::abs(snapshot.axes[i] - submittedAxes[i]) <= changeThreshold) {
+						continue;
+					}
+					submittedAxes[i] = snapshot.axes[i];
+					submittedAxisSet.set(i);
+					currentTimestamp = snapshot.axisTimestamps[i];
+					handlers[i](static_cast<Axis>(i), snapshot.axes[i]);
+				}
+
+				for (size_t i = 0; i < RadialCount; ++i) {
+					if (!radialHandlers[i] || !snapshot.radialSet[i]) {
+						continue;
+					}
+					const Vec2d& value = snapshot.radials[i];
+					if (submittedRadialSet[i]
+						&& std::abs(value[0] - submittedRadials[i][0]) <= changeThreshold
+						&& std::abs(value[1] - submittedRadials[i][1]) <= changeThreshold) {
+						continue;
+					}
+					submittedRadials[i] = value;
+					submittedRadialSet.set(i);
+					currentTimestamp = snapshot.radialTimestamps[i];
+					radialHandlers[i](static_cast<Radial>(i), value);
+				}
+
+				// transitions are kept in event order, so a tap shorter than a frame still arrives as Push and Release
+				for (const auto& transition : transitions) {
+					auto& handler = buttonHandlers[indexOf(transition.button)];
+					handler.previousState = transition.state == ButtonState::Push ? ButtonState::Hold : ButtonState::Off;
+					if (handler.handler && (static_cast<int>(handler.filter) & static_cast<int>(transition.state))) {
+						currentTimestamp = transition.timestamp;
+						handler.handler(transition.button, transition.state);
+					}
+				}
+				transitions.clear();
+			}
+
+			void submitValues(const InputSnapshot& values)
+			{
+				for (size_t i = 0; i < AxisCount; ++i) {
+					if (handlers[i] && values.axisSet[i]) {
+						handlers[i](static_cast<Axis>(i), values.axes[i]);
+					}
+				}
+
+				for (size_t i = 0; i < RadialCount; ++i) {
+					if (radialHandlers[i] && values.radialSet[i]) {
+						radialHandlers[i](static_cast<Radial>(i), values.radials[i]);
+					}
+				}
+
+				for (size_t i = 0; i < ButtonCount; ++i) {
+					if (buttonHandlers[i].handler) {
+						buttonHandlers[i].handle(static_cast<Button>(i), values.buttons[i]);
 					}
 				}
 			}
 
 		public:
 			void handleAndSubmitEvents() {
-				std::map<Axis, double> values{};
-				std::map<Radial, Vec2d> radialValues{};
-				std::map<Button, ButtonState> buttonValues{};
-				for (auto& [button, handler] : buttonHandlers) {
-					buttonValues[button] = ButtonState::Off;
+				if (sampler && mode == InputMode::EventDriven) {
+					InputSample sample;
+					while (sampler->poll(sample)) {
+						handleSample(sample);
+					}
+				}
+				frameInputReceivedAt = pendingInputReceivedAt;
+				pendingInputReceivedAt = 0;
+				if (source) {
+					snapshot.clear();
+					source->read(snapshot);
+					if (sink) {
+						sink->write(snapshot);
+					}
+					this->submitValues(snapshot);
+					return;
+				}
+				if (mode == InputMode::EventDriven) {
+					if (needsSeed) {
+						this->seed();
+					}
+					if (sink) {
+						sink->write(snapshot);
+					}
+					this->submitChanges();
+					return;
 				}
-				this->handleKeyState(values, radialValues, buttonValues);
-				this->handleJoysticks(values);
-				this->handleGameControllers(values, radialValues, buttonValues);
-				this->submitValues(values, radialValues, buttonValues);
+				snapshot.clear();
+				this->handleKeyState(snapshot);
+				this->handleJoysticks(snapshot);
+				this->handleGameControllers(snapshot);
+				if (sink) {
+					sink->write(snapshot);
+				}
+				this->submitValues(snapshot);
+			}
+
+			// Takes frame values from source instead of the devices while set. Values from a source
+			// are always dispatched like in polling mode. Pass nullptr to go back to the devices.
+			void setSource(IInputSource* inputSource)
+			{
+				source = inputSource;
+			}
+
+			// Passes every frame's values to sink, e.g. an InputRecorder. Pass nullptr to stop.
+			void setSink(IInputSink* inputSink)
+			{
+				sink = inputSink;
+			}
+
+			// Switches to event driven input: values are updated from key, controller and joystick
+			// events as the event manager delivers them, and handleAndSubmitEvents only calls handlers
+			// whose value changed by more than threshold, plus one call per button Push and Release.
+			void setEventDriven(EventManager& events, double threshold = 0.01)
+			{
+				mode = InputMode::EventDriven;
+				changeThreshold = threshold;
+				needsSeed = true;
+				submittedAxisSet.reset();
+				submittedRadialSet.reset();
+				transitions.clear();
+				transitions.reserve(64);
+				unsubscribe();
+				subscribedEvents = &events;
+				for (auto type : { SDL_KEYDOWN, SDL_KEYUP, SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERBUTTONDOWN, SDL_CONTROLLERBUTTONUP, SDL_JOYAXISMOTION }) {
+					subscriptions.push_back(events.subscribe(type, [this, &events](const SDL_Event& e) {
+						if (sampler && e.type != SDL_KEYDOWN && e.type != SDL_KEYUP) {
+							return;
+						}
+						stampInput(events.eventReceivedAt());
+						handleEvent(e);
+					}));
+				}
+			}
+
+			void setPolling()
+			{
+				mode = InputMode::Polling;
+				unsubscribe();
+			}
+
+			InputMode inputMode() const
+			{
+				return mode;
 			}
-			
 
+			// feeds one SDL event into event driven mode
+			void handleEvent(const SDL_Event& e)
+			{
+				switch (e.type) {
+				case SDL_KEYDOWN:
+				case SDL_KEYUP:
+					if (!e.key.repeat) {
+						changeKey(e.key.keysym.scancode, e.type == SDL_KEYDOWN, e.key.timestamp);
+					}
+					break;
+				case SDL_CONTROLLERAXISMOTION:
+					changeControllerAxis(e.caxis.which, e.caxis.axis, e.caxis.value, e.caxis.timestamp);
+					break;
+				case SDL_CONTROLLERBUTTONDOWN:
+				case SDL_CONTROLLERBUTTONUP:
+					changeControllerButton(e.cbutton.which, e.cbutton.button, e.cbutton.state == SDL_PRESSED, e.cbutton.timestamp);
+					break;
+				case SDL_JOYAXISMOTION:
+					changeJoystickAxis(e.jaxis.which, e.jaxis.axis, e.jaxis.value, e.jaxis.timestamp);
+					break;
+				}
+			}
+
+			// Notes that input was received at the given performance counter value; the earliest note
+			// is handed to the next handleAndSubmitEvents, see inputReceivedAt.
+			void stampInput(Uint64 receivedAt)
+			{
+				if (receivedAt && (!pendingInputReceivedAt || receivedAt < pendingInputReceivedAt)) {
+					pendingInputReceivedAt = receivedAt;
+				}
+			}
+
+			// performance counter value of the earliest input consumed by the current or last
+			// handleAndSubmitEvents, 0 if no input arrived, so latency can be measured up to present
+			Uint64 inputReceivedAt() const
+			{
+				return frameInputReceivedAt;
+			}
+
+			// Takes controller and joystick changes from the sampler's thread instead of SDL events, drained at the
+			// start of every handleAndSubmitEvents. Only used in event driven mode. Pass nullptr to go back to events.
+			void setSampler(InputSampler* inputSampler)
+			{
+				sampler = inputSampler;
+			}
+
+			// feeds one sampled change into event driven mode
+			void handleSample(const InputSample& sample)
+			{
+				stampInput(sample.counter);
+				switch (sample.kind) {
+				case InputSample::Kind::ControllerAxis:
+					changeControllerAxis(sample.which, sample.index, sample.value, sample.timestamp);
+					break;
+				case InputSample::Kind::ControllerButton:
+					changeControllerButton(sample.which, sample.index, sample.value != 0, sample.timestamp);
+					break;
+				case InputSample::Kind::JoystickAxis:
+					changeJoystickAxis(sample.which, sample.index, sample.value, sample.timestamp);
+					break;
+				}
+			}
+
+			// SDL timestamp of the input that caused the handler call currently running (event driven mode)
+			Uint32 eventTimestamp() const
+			{
+				return currentTimestamp;
+			}
+
+			// values submitted by the last handleAndSubmitEvents
+			const InputSnapshot& lastSnapshot() const
+			{
+				return snapshot;
+			}
 
 			void setKeyMapping(const Axis& axis, Uint8 keyCode, double offValue, double maxValue)
 			{
-				keys[keyCode] = KeyMapping{ axis, maxValue, offValue, std::numeric_limits<double>::quiet_NaN() };
+				insertOrAssign(keys, KeyAxisMapping{ keyCode, KeyMapping{ axis, maxValue, offValue, std::numeric_limits<double>::quiet_NaN() } },
+					[keyCode](const KeyAxisMapping& m) { return m.key == keyCode; });
 			}
 			
 			void setKeyMapping(const Axis& axis, Uint8 keyCodeMin, Uint8 keyCodeMax, double minValue, double offValue, double maxValue)
 			{
-				keyPairs[std::make_pair(keyCodeMin, keyCodeMax)] = KeyMapping{ axis, maxValue, offValue, minValue };
+				insertOrAssign(keyPairs, KeyPairMapping{ keyCodeMin, keyCodeMax, KeyMapping{ axis, maxValue, offValue, minValue } },
+					[=](const KeyPairMapping& m) { return m.keyMin == keyCodeMin && m.keyMax == keyCodeMax; });
 			}
 
 			void setKeyMapping(const Radial& radial, Uint8 keyCodeUp, Uint8 keyCodeDown, Uint8 keyCodeLeft, Uint8 keyCodeRight)
 			{
-				keyQuads[radial] = { keyCodeUp, keyCodeDown, keyCodeLeft, keyCodeRight }; 
+				insertOrAssign(keyQuads, KeyCrossMapping{ radial, { keyCodeUp, keyCodeDown, keyCodeLeft, keyCodeRight } },
+					[radial](const KeyCrossMapping& m) { return m.radial == radial; });
+			}
+
+			void setKeyMapping(Uint8 keyCode, Button button)
+			{
+				insertOrAssign(keyButtons, KeyButtonMapping{ keyCode, button },
+					[keyCode](const KeyButtonMapping& m) { return m.key == keyCode; });
 			}
 
 			void setJoystickMapping(std::shared_ptr<ReSDL::Joystick> joystick,
@@ -305,7 +884,9 @@ namespace Engine {
 				Axis axis,
 				AxisValueMappingS16 mapping)
 			{
-				joysticks[joystick][joystickAxis] = S16Mapping{ mapping, axis };
+				retain(joysticks, joystick);
+				insertOrAssign(joystickAxes, JoystickAxisMapping{ joystick.get(), joystickAxis, S16Mapping{ mapping, axis }, joystick->instanceId() },
+					[&](const JoystickAxisMapping& m) { return m.joystick == joystick.get() && m.joystickAxis == joystickAxis; });
 			}
 			
 			void setGameControllerMapping(std::shared_ptr<ReSDL::GameController> controller,
@@ -313,7 +894,9 @@ namespace Engine {
 				Axis axis,
 				AxisValueMappingS16 mapping)
 			{
-				controllerMapping[controller][controllerAxis] = S16Mapping{ mapping, axis };
+				retain(controllers, controller);
+				insertOrAssign(controllerAxes, ControllerAxisMapping{ controller.get(), controllerAxis, S16Mapping{ mapping, axis }, controller->instanceId() },
+					[&](const ControllerAxisMapping& m) { return m.controller == controller.get() && m.controllerAxis == controllerAxis; });
 			}
 
 			void setGameControllerMapping(std::shared_ptr<ReSDL::GameController> controller,
@@ -322,7 +905,9 @@ namespace Engine {
 				Radial radial,
 				RadialValueMappingS16 mapping)
 			{
-				controllerRadialMapping[controller][std::make_pair(controllerAxisX, controllerAxisY)] = S16RadialMapping{ mapping, radial };
+				retain(controllers, controller);
+				insertOrAssign(controllerRadials, ControllerRadialMapping{ controller.get(), controllerAxisX, controllerAxisY, S16RadialMapping{ mapping, radial }, controller->instanceId(), 0, 0 },
+					[&](const ControllerRadialMapping& m) { return m.controller == controller.get() && m.controllerAxisX == controllerAxisX && m.controllerAxisY == controllerAxisY; });
 			}
 
 			void setGameControllerMapping(std::shared_ptr<ReSDL::GameController> controller,
@@ -332,48 +917,66 @@ namespace Engine {
 				SDL_GameControllerButton buttonRight,
 				Radial radial)
 			{
-				controllerRadialButtonMapping[controller] = { radial, GameControllerButtonCross{buttonUp, buttonDown, buttonLeft, buttonRight }};
+				retain(controllers, controller);
+				insertOrAssign(controllerCrosses, ControllerCrossMapping{ controller.get(), { radial, GameControllerButtonCross{buttonUp, buttonDown, buttonLeft, buttonRight } }, controller->instanceId(), {} },
+					[&](const ControllerCrossMapping& m) { return m.controller == controller.get(); });
 			}
 
 			void setGameControllerMapping(std::shared_ptr<ReSDL::GameController> controller,
 				SDL_GameControllerButton controllerButton, 
 				Button button)
 			{
-				controllerButtons[controller][controllerButton] = button;
+				retain(controllers, controller);
+				insertOrAssign(controllerButtons, ControllerButtonMapping{ controller.get(), controllerButton, button, controller->instanceId(), false },
+					[&](const ControllerButtonMapping& m) { return m.controller == controller.get() && m.controllerButton == controllerButton; });
 			}
 			
-			void setAxisHandler(Axis axis, AxisInputHandlerFunc handler)
+			// Drops all mappings of a device and releases it, e.g. after it was unplugged. In event driven
+			// mode buttons it still held are released first, so handlers see a Release instead of a stuck Hold.
+			void removeDevice(SDL_JoystickID instanceId)
 			{
-				if(handler) {
-					handlers[axis] = handler;
-				}
-				else {
-					handlers.erase(axis);
+				if (mode == InputMode::EventDriven) {
+					const Uint32 now = SDL_GetTicks();
+					for (const auto& entry : controllerButtons) {
+						if (entry.instanceId == instanceId && entry.pressed) {
+							changeControllerButton(instanceId, static_cast<Uint8>(entry.controllerButton), false, now);
+						}
+					}
+					for (auto& entry : controllerCrosses) {
+						if (entry.instanceId == instanceId) {
+							entry.pressed = {};
+							changeRadial(entry.mapping.radial, crossValue(false, false, false, false), now);
+						}
+					}
 				}
+				auto matches = [instanceId](const auto& entry) { return entry.instanceId == instanceId; };
+				joystickAxes.erase(std::remove_if(joystickAxes.begin(), joystickAxes.end(), matches), joystickAxes.end());
+				controllerAxes.erase(std::remove_if(controllerAxes.begin(), controllerAxes.end(), matches), controllerAxes.end());
+				controllerRadials.erase(std::remove_if(controllerRadials.begin(), controllerRadials.end(), matches), controllerRadials.end());
+				controllerCrosses.erase(std::remove_if(controllerCrosses.begin(), controllerCrosses.end(), matches), controllerCrosses.end());
+				controllerButtons.erase(std::remove_if(controllerButtons.begin(), controllerButtons.end(), matches), controllerButtons.end());
+				auto isDevice = [instanceId](const auto& device) { return device->instanceId() == instanceId; };
+				joysticks.erase(std::remove_if(joysticks.begin(), joysticks.end(), isDevice), joysticks.end());
+				controllers.erase(std::remove_if(controllers.begin(), controllers.end(), isDevice), controllers.end());
+				needsSeed = true;
+			}
+
+			void setAxisHandler(Axis axis, AxisInputHandlerFunc handler)
+			{
+				handlers[indexOf(axis)] = handler;
 			}
 
 			void setRadialHandler(Radial radial, RadialInputHandlerFunc handler)
 			{
-				if (handler) {
-					radialHandlers[radial] = handler;
-				}
-				else {
-					radialHandlers.erase(radial);
-				}
+				radialHandlers[indexOf(radial)] = handler;
 			}
 
 			void setButtonHandler(Button button, ButtonStateHandlerFunc handler, ButtonState filter = ButtonState::All) 
 			{
-				if (handler) {
-					buttonHandlers[button] = { filter, ButtonState::Off, handler };
-				}
-				else {
-					buttonHandlers.erase(button);
-				}
+				buttonHandlers[indexOf(button)] = { filter, ButtonState::Off, handler };
 			}
 
 		};
-
 		
 	}
 }
\ No newline at end of file
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Input/EventManager.h"
+
+namespace Engine {
+	namespace Input {
+
+		// An open game controller or joystick. Devices SDL recognizes as game controllers are only
+		// opened as such, controller is null for plain joysticks and joystick is null otherwise.
+		struct InputDevice {
+			SDL_JoystickID instanceId;
+			int player;
+			std::shared_ptr<ReSDL::GameController> controller;
+			std::shared_ptr<ReSDL::Joystick> joystick;
+			ReSDL::GameControllerState controllerState;
+			ReSDL::JoystickState joystickState;
+
+			bool isController() const
+			{
+				return controller != nullptr;
+			}
+
+			// fills the matching state struct from the device in one pass
+			void snapshot()
+			{
+				if (controller) {
+					controller->snapshot(controllerState);
+				}
+				else {
+					joystick->snapshot(joystickState);
+				}
+			}
+		};
+
+		using InputDeviceHandlerFunc = std::function<void(InputDevice&)>;
+
+		// Keeps the open devices in one dense array with an index by instance id, so looking up the device
+		// of an SDL event is a single hash lookup. Hotplug events open and close devices as they come and go
+		// and every device gets the lowest free player slot. Pointers and references to devices are only
+		// valid until the next device is added or removed.
+		class DeviceRegistry
+		{
+		public:
+			static constexpr int MaxPlayers = 8;
+
+			DeviceRegistry()
+			{
+				players.fill(-1);
+			}
+
+			DeviceRegistry(const DeviceRegistry&) = delete;
+			DeviceRegistry& operator=(const DeviceRegistry&) = delete;
+
+			// called after a device was opened and before a device is closed
+			void setAddedHandler(InputDeviceHandlerFunc handler)
+			{
+				onAdded = handler;
+			}
+
+			void setRemovedHandler(InputDeviceHandlerFunc handler)
+			{
+				onRemoved = handler;
+			}
+
+			// opens every device that is connected right now
+			void openAll()
+			{
+				for (int i = 0; i < ReSDL::Joystick::numJoysticks(); ++i) {
+					open(i);
+				}
+			}
+
+			// Opens the device at that device index unless it is open already, which happens for devices
+			// that were connected at startup and are announced again by SDL. Returns null if it failed.
+			InputDevice* open(int deviceIndex)
+			{
+				const SDL_JoystickID instanceId = ReSDL::Joystick::instanceIdForIndex(deviceIndex);
+				if (instanceId < 0) {
+					return nullptr;
+				}
+				if (InputDevice* existing = find(instanceId)) {
+					return existing;
+				}
+				InputDevice device{ instanceId, -1, nullptr, nullptr, {}, {} };
+				if (ReSDL::GameController::isGameController(deviceIndex)) {
+					device.controller = std::make_shared<ReSDL::GameController>(deviceIndex);
+					if (!device.controller->handle) {
+						return nullptr;
+					}
+				}
+				else {
+					device.joystick = std::make_shared<ReSDL::Joystick>(deviceIndex);
+					if (!device.joystick->handle) {
+						return nullptr;
+					}
+				}
+				for (int player = 0; player < MaxPlayers; ++player) {
+					if (players[player] < 0) {
+						players[player] = instanceId;
+						device.player = player;
+						break;
+					}
+				}
+				device.snapshot();
+				index.emplace(instanceId, devices.size());
+				devices.push_back(std::move(device));
+				if (onAdded) {
+					onAdded(devices.back());
+				}
+				return &devices.back();
+			}
+
+			// closes the device with that instance id, returns false if it was not open
+			bool close(SDL_JoystickID instanceId)
+			{
+				auto it = index.find(instanceId);
+				if (it == index.end()) {
+					return false;
+				}
+				const size_t position = it->second;
+				if (onRemoved) {
+					onRemoved(devices[position]);
+				}
+				if (devices[position].player >= 0) {
+					players[devices[position].player] = -1;
+				}
+				index.erase(it);
+				// the last device takes the free spot to keep the array dense
+				if (position + 1 != devices.size()) {
+					devices[position] = std::move(devices.back());
+					index[devices[position].instanceId] = position;
+				}
+				devices.pop_back();
+				return true;
+			}
+
+			void closeAll()
+			{
+				while (!devices.empty()) {
+					close(devices.back().instanceId);
+				}
+			}
+
+			// device added and removed events, SDL sends both the joystick and the controller variant for controllers
+			void handleEvent(const SDL_Event& e)
+			{
+				switch (e.type) {
+				case SDL_CONTROLLERDEVICEADDED:
+					open(e.cdevice.which);
+					break;
+				case SDL_JOYDEVICEADDED:
+					if (!ReSDL::GameController::isGameController(e.jdevice.which)) {
+						open(e.jdevice.which);
+					}
+					break;
+				case SDL_CONTROLLERDEVICEREMOVED:
+					close(e.cdevice.which);
+					break;
+				case SDL_JOYDEVICEREMOVED:
+					close(e.jdevice.which);
+					break;
+				}
+			}
+
+			std::vector<EventManager::Subscription> subscribe(EventManager& events, int priority = 0)
+			{
+				std::vector<EventManager::Subscription> subscriptions;
+				for (auto type : { SDL_CONTROLLERDEVICEADDED, SDL_CONTROLLERDEVICEREMOVED, SDL_JOYDEVICEADDED, SDL_JOYDEVICEREMOVED }) {
+					subscriptions.push_back(events.subscribe(type, [this](const SDL_Event& e) { handleEvent(e); }, priority));
+				}
+				return subscriptions;
+			}
+
+			// refreshes the state of every device, once per frame instead of one SDL call per value
+			void snapshotAll()
+			{
+				for (auto& device : devices) {
+					device.snapshot();
+				}
+			}
+
+			InputDevice* find(SDL_JoystickID instanceId)
+			{
+				auto it = index.find(instanceId);
+				return it != index.end() ? &devices[it->second] : nullptr;
+			}
+
+			// the device in that player slot or null
+			InputDevice* player(int slot)
+			{
+				return slot >= 0 && slot < MaxPlayers && players[slot] >= 0 ? find(players[slot]) : nullptr;
+			}
+
+			size_t size() const
+			{
+				return devices.size();
+			}
+
+			std::vector<InputDevice>::iterator begin()
+			{
+				return devices.begin();
+			}
+
+			std::vector<InputDevice>::iterator end()
+			{
+				return devices.end();
+			}
+
+		private:
+			std::vector<InputDevice> devices;
+			std::unordered_map<SDL_JoystickID, size_t> index;
+			std::array<SDL_JoystickID, MaxPlayers> players;
+			InputDeviceHandlerFunc onAdded;
+			InputDeviceHandlerFunc onRemoved;
+		};
+
+	}
+}
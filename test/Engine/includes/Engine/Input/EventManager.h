@@ -1,30 +1,237 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+#include "ReSDL/ReSDL.h"
+
 namespace Engine {
 namespace Input {
-	
+
 using EventHandlerFunc = std::function<void(const SDL_Event&)>;
 
-struct EventManager {
-	
-	void pollAndHandle() const {
-		SDL_Event e;
-		while (SDL_PollEvent(&e)){
-			const SDL_EventType type = static_cast<SDL_EventType>(e.type);
-			if(handlers.count(type)) {
-				handlers.at(type)(e);
+// Dispatches SDL events to subscribers. Handlers live in a table indexed directly by event type:
+// SDL groups its types in ranges of 0x100, so the table is split into pages of 256 entries that are
+// only allocated for ranges someone subscribed to. Events are drained in batches with SDL_PeepEvents.
+class EventManager {
+public:
+	// identifies a subscription for unsubscribe, 0 is never a valid subscription
+	using Subscription = uint64_t;
+
+	explicit EventManager(size_t batchSize = 128)
+		: buffer(batchSize)
+	{
+	}
+
+	EventManager(const EventManager&) = delete;
+	EventManager& operator=(const EventManager&) = delete;
+
+	// Calls handler for every event of the given type. Handlers with a higher priority are called
+	// first, handlers with equal priority in the order they subscribed. A handler subscribed from inside
+	// another handler is called from the next event on; an unsubscribed handler is never called again.
+	Subscription subscribe(Uint32 type, EventHandlerFunc handler, int priority = 0) {
+		const Uint32 id = ++lastId;
+		const Subscription subscription = (static_cast<Subscription>(type) << 32) | id;
+		if (dispatching) {
+			pending.push_back({ type, { priority, id, std::move(handler) } });
+		}
+		else {
+			insert(type, { priority, id, std::move(handler) });
+		}
+		return subscription;
+	}
+
+	void unsubscribe(Subscription subscription) {
+		const Uint32 type = static_cast<Uint32>(subscription >> 32);
+		const Uint32 id = static_cast<Uint32>(subscription);
+		auto pendingEntry = std::find_if(pending.begin(), pending.end(), [id](const PendingSubscriber& entry) { return entry.subscriber.id == id; });
+		if (pendingEntry != pending.end()) {
+			pending.erase(pendingEntry);
+			return;
+		}
+		auto* subscribers = find(type);
+		if (!subscribers) {
+			return;
+		}
+		auto it = std::find_if(subscribers->begin(), subscribers->end(), [id](const Subscriber& entry) { return entry.id == id; });
+		if (it == subscribers->end()) {
+			return;
+		}
+		if (dispatching) {
+			// keep indices stable for the running dispatch, the slot is dropped afterwards
+			it->handler = nullptr;
+			compactTypes.push_back(type);
+		}
+		else {
+			subscribers->erase(it);
+		}
+	}
+
+	bool hasSubscribers(Uint32 type) const {
+		const auto* subscribers = find(type);
+		return subscribers && !subscribers->empty();
+	}
+
+	// Merges runs of consecutive mouse motion events of the same mouse into one event with the last
+	// position and the summed relative motion. High polling rate mice otherwise flood the handlers.
+	void setCoalesceMouseMotion(bool coalesce) {
+		coalesceMouseMotion = coalesce;
+	}
+
+	void pollAndHandle() {
+		SDL_PumpEvents();
+		for (;;) {
+			const int count = SDL_PeepEvents(buffer.data(), static_cast<int>(buffer.size()), SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+			if (count <= 0) {
+				break;
+			}
+			handleBatch(static_cast<size_t>(count));
+			if (static_cast<size_t>(count) < buffer.size()) {
+				break;
 			}
 		}
-	} 
-	
-	void waitAndHandle() const {
-		SDL_Event e;
-		SDL_WaitEvent(&e);
-		const SDL_EventType type = static_cast<SDL_EventType>(e.type);
-		if(handlers.count(type)) {
-			handlers.at(type)(e);
+	}
+
+	// blocks until an event arrives, then handles it and everything else already queued
+	void waitAndHandle() {
+		if (!SDL_WaitEvent(buffer.data())) {
+			return;
 		}
+		handleBatch(1);
+		pollAndHandle();
+	}
+
+	// performance counter value when the event currently being handled was received
+	Uint64 eventReceivedAt() const {
+		return receivedAt;
 	}
-	
-	std::map<SDL_EventType, EventHandlerFunc> handlers;
+
+	// performance counter value when the first input event since the last call was received, 0 if there was none
+	Uint64 takeInputReceivedAt() {
+		const Uint64 result = inputReceivedAt;
+		inputReceivedAt = 0;
+		return result;
+	}
+
+private:
+	struct Subscriber {
+		int priority;
+		Uint32 id;
+		EventHandlerFunc handler;
+	};
+
+	struct PendingSubscriber {
+		Uint32 type;
+		Subscriber subscriber;
+	};
+
+	using Page = std::array<std::vector<Subscriber>, 256>;
+
+	// keyboard, mouse, joystick, controller, touch and gesture events
+	static bool isInputEvent(Uint32 type) {
+		return type >= SDL_KEYDOWN && type < SDL_CLIPBOARDUPDATE;
+	}
+
+	std::vector<Subscriber>* find(Uint32 type) {
+		if (type > SDL_LASTEVENT || !pages[type >> 8]) {
+			return nullptr;
+		}
+		return &(*pages[type >> 8])[type & 0xFF];
+	}
+
+	const std::vector<Subscriber>* find(Uint32 type) const {
+		if (type > SDL_LASTEVENT || !pages[type >> 8]) {
+			return nullptr;
+		}
+		return &(*pages[type >> 8])[type & 0xFF];
+	}
+
+	void insert(Uint32 type, Subscriber subscriber) {
+		if (type > SDL_LASTEVENT) {
+			return;
+		}
+		auto& page = pages[type >> 8];
+		if (!page) {
+			page.reset(new Page());
+		}
+		auto& subscribers = (*page)[type & 0xFF];
+		auto position = std::find_if(subscribers.begin(), subscribers.end(), [&subscriber](const Subscriber& entry) { return entry.priority < subscriber.priority; });
+		subscribers.insert(position, std::move(subscriber));
+	}
+
+	// merges motion events in place, returns the new event count
+	size_t coalesce(size_t count) {
+		size_t out = 0;
+		for (size_t i = 0; i < count; ++i) {
+			const SDL_Event& e = buffer[i];
+			if (out > 0 && e.type == SDL_MOUSEMOTION) {
+				SDL_Event& last = buffer[out - 1];
+				if (last.type == SDL_MOUSEMOTION && last.motion.which == e.motion.which && last.motion.windowID == e.motion.windowID) {
+					const Sint32 xrel = last.motion.xrel + e.motion.xrel;
+					const Sint32 yrel = last.motion.yrel + e.motion.yrel;
+					last.motion = e.motion;
+					last.motion.xrel = xrel;
+					last.motion.yrel = yrel;
+					continue;
+				}
+			}
+			buffer[out++] = e;
+		}
+		return out;
+	}
+
+	void handleBatch(size_t count) {
+		receivedAt = SDL_GetPerformanceCounter();
+		if (coalesceMouseMotion) {
+			count = coalesce(count);
+		}
+		++dispatching;
+		for (size_t i = 0; i < count; ++i) {
+			const SDL_Event& e = buffer[i];
+			if (!inputReceivedAt && isInputEvent(e.type)) {
+				inputReceivedAt = receivedAt;
+			}
+			auto* subscribers = find(e.type);
+			if (!subscribers) {
+				continue;
+			}
+			for (size_t s = 0; s < subscribers->size(); ++s) {
+				if ((*subscribers)[s].handler) {
+					(*subscribers)[s].handler(e);
+				}
+			}
+			if (dispatching == 1 && (!compactTypes.empty() || !pending.empty())) {
+				applyPending();
+			}
+		}
+		--dispatching;
+	}
+
+	void applyPending() {
+		for (Uint32 type : compactTypes) {
+			auto* subscribers = find(type);
+			subscribers->erase(std::remove_if(subscribers->begin(), subscribers->end(), [](const Subscriber& entry) { return !entry.handler; }), subscribers->end());
+		}
+		compactTypes.clear();
+		for (auto& entry : pending) {
+			insert(entry.type, std::move(entry.subscriber));
+		}
+		pending.clear();
+	}
+
+	std::array<std::unique_ptr<Page>, (SDL_LASTEVENT >> 8) + 1> pages;
+	std::vector<PendingSubscriber> pending;
+	std::vector<Uint32> compactTypes;
+	std::vector<SDL_Event> buffer;
+	Uint32 lastId = 0;
+	int dispatching = 0;
+	bool coalesceMouseMotion = false;
+
+	Uint64 receivedAt = 0;
+	Uint64 inputReceivedAt = 0;
 };
 
 }
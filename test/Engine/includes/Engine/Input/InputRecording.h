@@ -0,0 +1,388 @@
+#pragma once
+
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "Engine/Input/AxisInputManager.h"
+
+namespace Engine {
+	namespace Input {
+
+		// Stream layout: a header, then one record per frame that differs from the frame before.
+		// A record starts with the number of unchanged frames preceding it and a flags byte saying
+		// which parts changed; only those parts follow. Values are stored as the XOR with the
+		// previous value, byte swapped so the usually zero low mantissa bytes end up in the high
+		// bits, and written as varints. Typical digital values (0, 1, -1) take one or two bytes.
+		namespace detail {
+			constexpr char RecordingMagic[4] = { 'R', 'S', 'I', 'R' };
+			constexpr uint8_t RecordingVersion = 1;
+
+			enum RecordFlags : uint8_t {
+				AxisSetChanged = 0b00001,
+				RadialSetChanged = 0b00010,
+				AxesChanged = 0b00100,
+				RadialsChanged = 0b01000,
+				ButtonsChanged = 0b10000,
+				EndOfStream = 0xFF
+			};
+
+			inline uint64_t byteSwap(uint64_t value)
+			{
+				uint64_t result = 0;
+				for (int i = 0; i < 8; ++i) {
+					result = (result << 8) | ((value >> (i * 8)) & 0xFF);
+				}
+				return result;
+			}
+
+			inline uint64_t bitsOf(double value)
+			{
+				uint64_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				return bits;
+			}
+
+			inline double doubleOf(uint64_t bits)
+			{
+				double value;
+				std::memcpy(&value, &bits, sizeof(value));
+				return value;
+			}
+
+			inline void writeVarint(std::ostream& out, uint64_t value)
+			{
+				char bytes[10];
+				int count = 0;
+				do {
+					uint8_t byte = value & 0x7F;
+					value >>= 7;
+					if (value) {
+						byte |= 0x80;
+					}
+					bytes[count++] = static_cast<char>(byte);
+				} while (value);
+				out.write(bytes, count);
+			}
+
+			inline bool readVarint(std::istream& in, uint64_t& value)
+			{
+				value = 0;
+				for (int shift = 0; shift < 64; shift += 7) {
+					const int byte = in.get();
+					if (byte == std::char_traits<char>::eof()) {
+						return false;
+					}
+					value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+					if (!(byte & 0x80)) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			// four bits per button
+			inline uint64_t packButtons(const std::array<ButtonState, ButtonCount>& buttons)
+			{
+				static_assert(ButtonCount * 4 <= 64, "buttons do not fit into one word");
+				uint64_t packed = 0;
+				for (size_t i = 0; i < ButtonCount; ++i) {
+					packed |= static_cast<uint64_t>(buttons[i]) << (i * 4);
+				}
+				return packed;
+			}
+
+			inline void unpackButtons(uint64_t packed, std::array<ButtonState, ButtonCount>& buttons)
+			{
+				for (size_t i = 0; i < ButtonCount; ++i) {
+					buttons[i] = static_cast<ButtonState>((packed >> (i * 4)) & 0xF);
+				}
+			}
+		}
+
+		// Writes every frame AxisInputManager submits to a stream, see setSink.
+		// Timestamps are not recorded; a replay is frame accurate, not time accurate.
+		class InputRecorder : public IInputSink
+		{
+			std::unique_ptr<std::ofstream> file;
+			std::ostream& out;
+			InputSnapshot previous;
+			uint64_t unchangedFrames = 0;
+			uint64_t frames = 0;
+			bool finished = false;
+
+			void writeHeader()
+			{
+				out.write(detail::RecordingMagic, sizeof(detail::RecordingMagic));
+				out.put(static_cast<char>(detail::RecordingVersion));
+				out.put(static_cast<char>(AxisCount));
+				out.put(static_cast<char>(RadialCount));
+				out.put(static_cast<char>(ButtonCount));
+			}
+
+			void writeValue(double value, double before)
+			{
+				detail::writeVarint(out, detail::byteSwap(detail::bitsOf(value) ^ detail::bitsOf(before)));
+			}
+
+		public:
+			explicit InputRecorder(const std::string& path)
+				: file(new std::ofstream(path, std::ios::binary | std::ios::trunc))
+				, out(*file)
+			{
+				if (!*file) {
+					throw std::runtime_error("could not open input recording " + path);
+				}
+				writeHeader();
+			}
+
+			explicit InputRecorder(std::ostream& stream)
+				: out(stream)
+			{
+				writeHeader();
+			}
+
+			InputRecorder(const InputRecorder&) = delete;
+			InputRecorder& operator=(const InputRecorder&) = delete;
+
+			~InputRecorder()
+			{
+				finish();
+			}
+
+			void write(const InputSnapshot& snapshot) override
+			{
+				++frames;
+				// values of unset entries are stale and not worth recording
+				std::bitset<AxisCount> axesChanged;
+				for (size_t i = 0; i < AxisCount; ++i) {
+					axesChanged[i] = snapshot.axisSet[i] && detail::bitsOf(snapshot.axes[i]) != detail::bitsOf(previous.axes[i]);
+				}
+				std::bitset<RadialCount> radialsChanged;
+				for (size_t i = 0; i < RadialCount; ++i) {
+					radialsChanged[i] = snapshot.radialSet[i]
+						&& (detail::bitsOf(snapshot.radials[i][0]) != detail::bitsOf(previous.radials[i][0])
+						|| detail::bitsOf(snapshot.radials[i][1]) != detail::bitsOf(previous.radials[i][1]));
+				}
+				const uint64_t buttons = detail::packButtons(snapshot.buttons);
+				const uint64_t previousButtons = detail::packButtons(previous.buttons);
+
+				uint8_t flags = 0;
+				if (snapshot.axisSet != previous.axisSet) flags |= detail::AxisSetChanged;
+				if (snapshot.radialSet != previous.radialSet) flags |= detail::RadialSetChanged;
+				if (axesChanged.any()) flags |= detail::AxesChanged;
+				if (radialsChanged.any()) flags |= detail::RadialsChanged;
+				if (buttons != previousButtons) flags |= detail::ButtonsChanged;
+
+				if (!flags) {
+					++unchangedFrames;
+					return;
+				}
+
+				detail::writeVarint(out, unchangedFrames);
+				out.put(static_cast<char>(flags));
+				unchangedFrames = 0;
+
+				if (flags & detail::AxisSetChanged) {
+					detail::writeVarint(out, snapshot.axisSet.to_ullong());
+				}
+				if (flags & detail::RadialSetChanged) {
+					detail::writeVarint(out, snapshot.radialSet.to_ullong());
+				}
+				if (flags & detail::AxesChanged) {
+					detail::writeVarint(out, axesChanged.to_ullong());
+					for (size_t i = 0; i < AxisCount; ++i) {
+						if (axesChanged[i]) {
+							writeValue(snapshot.axes[i], previous.axes[i]);
+							previous.axes[i] = snapshot.axes[i];
+						}
+					}
+				}
+				if (flags & detail::RadialsChanged) {
+					detail::writeVarint(out, radialsChanged.to_ullong());
+					for (size_t i = 0; i < RadialCount; ++i) {
+						if (radialsChanged[i]) {
+							writeValue(snapshot.radials[i][0], previous.radials[i][0]);
+							writeValue(snapshot.radials[i][1], previous.radials[i][1]);
+							previous.radials[i] = snapshot.radials[i];
+						}
+					}
+				}
+				if (flags & detail::ButtonsChanged) {
+					detail::writeVarint(out, buttons ^ previousButtons);
+				}
+				previous.axisSet = snapshot.axisSet;
+				previous.radialSet = snapshot.radialSet;
+				previous.buttons = snapshot.buttons;
+			}
+
+			// Writes the trailing run of unchanged frames and the end marker. Called by the destructor.
+			void finish()
+			{
+				if (finished) {
+					return;
+				}
+				finished = true;
+				detail::writeVarint(out, unchangedFrames);
+				out.put(static_cast<char>(detail::EndOfStream));
+				out.flush();
+			}
+
+			uint64_t frameCount() const
+			{
+				return frames;
+			}
+		};
+
+		// Plays a recording back in place of the devices, see AxisInputManager::setSource.
+		// Nothing here waits for real time, so headless loops run as fast as they can step.
+		class InputReplay : public IInputSource
+		{
+			std::unique_ptr<std::ifstream> file;
+			std::istream& in;
+			InputSnapshot current;
+			InputSnapshot next;
+			uint64_t repeat = 0;
+			uint64_t frames = 0;
+			bool pending = false;
+			bool ended = false;
+
+			double readValue(double before)
+			{
+				uint64_t delta = 0;
+				if (!detail::readVarint(in, delta)) {
+					ended = true;
+				}
+				return detail::doubleOf(detail::bitsOf(before) ^ detail::byteSwap(delta));
+			}
+
+			void readHeader()
+			{
+				char magic[sizeof(detail::RecordingMagic)];
+				in.read(magic, sizeof(magic));
+				const int version = in.get();
+				const int axes = in.get();
+				const int radials = in.get();
+				const int buttons = in.get();
+				if (!in || std::memcmp(magic, detail::RecordingMagic, sizeof(magic)) != 0) {
+					throw std::runtime_error("not an input recording");
+				}
+				if (version != detail::RecordingVersion || axes != AxisCount || radials != RadialCount || buttons != ButtonCount) {
+					throw std::runtime_error("input recording was made with an incompatible version");
+				}
+			}
+
+			// reads the next record: a run of repeats of the current frame, then the changed frame
+			void readRecord()
+			{
+				if (!detail::readVarint(in, repeat)) {
+					ended = true;
+					return;
+				}
+				const int flagByte = in.get();
+				if (flagByte == std::char_traits<char>::eof() || flagByte == detail::EndOfStream) {
+					pending = false;
+					return;
+				}
+				const uint8_t flags = static_cast<uint8_t>(flagByte);
+				pending = true;
+				uint64_t mask = 0;
+
+				if (flags & detail::AxisSetChanged) {
+					detail::readVarint(in, mask);
+					next.axisSet = std::bitset<AxisCount>(mask);
+				}
+				if (flags & detail::RadialSetChanged) {
+					detail::readVarint(in, mask);
+					next.radialSet = std::bitset<RadialCount>(mask);
+				}
+				if (flags & detail::AxesChanged) {
+					detail::readVarint(in, mask);
+					for (size_t i = 0; i < AxisCount; ++i) {
+						if (mask & (uint64_t(1) << i)) {
+							next.axes[i] = readValue(next.axes[i]);
+						}
+					}
+				}
+				if (flags & detail::RadialsChanged) {
+					detail::readVarint(in, mask);
+					for (size_t i = 0; i < RadialCount; ++i) {
+						if (mask & (uint64_t(1) << i)) {
+							next.radials[i][0] = readValue(next.radials[i][0]);
+							next.radials[i][1] = readValue(next.radials[i][1]);
+						}
+					}
+				}
+				if (flags & detail::ButtonsChanged) {
+					detail::readVarint(in, mask);
+					detail::unpackButtons(detail::packButtons(next.buttons) ^ mask, next.buttons);
+				}
+				if (!in) {
+					ended = true;
+				}
+			}
+
+		public:
+			explicit InputReplay(const std::string& path)
+				: file(new std::ifstream(path, std::ios::binary))
+				, in(*file)
+			{
+				if (!*file) {
+					throw std::runtime_error("could not open input recording " + path);
+				}
+				readHeader();
+				readRecord();
+			}
+
+			explicit InputReplay(std::istream& stream)
+				: in(stream)
+			{
+				readHeader();
+				readRecord();
+			}
+
+			InputReplay(const InputReplay&) = delete;
+			InputReplay& operator=(const InputReplay&) = delete;
+
+			bool read(InputSnapshot& snapshot) override
+			{
+				if (repeat == 0 && pending) {
+					current = next;
+					readRecord();
+				}
+				else if (repeat > 0) {
+					--repeat;
+				}
+				else {
+					ended = true;
+				}
+				if (ended) {
+					return false;
+				}
+				++frames;
+				snapshot.axes = current.axes;
+				snapshot.radials = current.radials;
+				snapshot.buttons = current.buttons;
+				snapshot.axisSet = current.axisSet;
+				snapshot.radialSet = current.radialSet;
+				return true;
+			}
+
+			bool atEnd() const
+			{
+				return ended || (repeat == 0 && !pending);
+			}
+
+			uint64_t frameCount() const
+			{
+				return frames;
+			}
+		};
+
+	}
+}
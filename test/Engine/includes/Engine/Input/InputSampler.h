@@ -0,0 +1,194 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <array>
+#include <algorithm>
+
+#include "ReSDL/ReSDL.h"
+#include "Engine/Concurrency/SpscRingBuffer.h"
+
+namespace Engine {
+	namespace Input {
+
+		// one changed device value, as seen by the sampling thread
+		struct InputSample {
+			enum class Kind : Uint8 { ControllerAxis, ControllerButton, JoystickAxis };
+
+			Uint64 counter;
+			Uint32 timestamp;
+			SDL_JoystickID which;
+			Kind kind;
+			Uint8 index;
+			Sint16 value;
+		};
+
+		// Samples game controllers and joysticks on its own thread at a fixed rate and hands every change
+		// to the main thread through a lock-free ring, so taps and flicks shorter than a frame are not lost.
+		// Devices can only be added while the sampler is stopped.
+		class InputSampler
+		{
+			// last holds the values that made it into the ring
+			struct ControllerEntry {
+				std::shared_ptr<ReSDL::GameController> controller;
+				SDL_JoystickID instanceId;
+				ReSDL::GameControllerState last;
+			};
+
+			struct JoystickEntry {
+				std::shared_ptr<ReSDL::Joystick> joystick;
+				SDL_JoystickID instanceId;
+				ReSDL::JoystickState last;
+			};
+
+			std::vector<ControllerEntry> controllers;
+			std::vector<JoystickEntry> joysticks;
+			Concurrency::SpscRingBuffer<InputSample> samples;
+			std::thread thread;
+			std::atomic<bool> running{ false };
+			std::chrono::nanoseconds period;
+			std::atomic<size_t> deferred{ 0 };
+
+			// a value only counts as sampled once its change made it into the ring, a full ring is retried next tick
+			bool submit(const InputSample& sample)
+			{
+				if (!samples.tryPush(sample)) {
+					deferred.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				return true;
+			}
+
+			void sample()
+			{
+				const Uint64 counter = SDL_GetPerformanceCounter();
+				const Uint32 timestamp = SDL_GetTicks();
+
+				SDL_LockJoysticks();
+				SDL_JoystickUpdate();
+				for (auto& entry : controllers) {
+					ReSDL::GameControllerState state;
+					entry.controller->snapshot(state);
+					for (int axis = 0; axis < SDL_CONTROLLER_AXIS_MAX; ++axis) {
+						const Sint16 value = state.axes[axis];
+						if (value != entry.last.axes[axis] && submit({ counter, timestamp, entry.instanceId, InputSample::Kind::ControllerAxis, static_cast<Uint8>(axis), value })) {
+							entry.last.axes[axis] = value;
+						}
+					}
+					const Uint32 changed = state.buttons ^ entry.last.buttons;
+					for (int button = 0; changed && button < SDL_CONTROLLER_BUTTON_MAX; ++button) {
+						const Uint32 bit = Uint32(1) << button;
+						const Sint16 value = (state.buttons & bit) ? 1 : 0;
+						if ((changed & bit) && submit({ counter, timestamp, entry.instanceId, InputSample::Kind::ControllerButton, static_cast<Uint8>(button), value })) {
+							entry.last.buttons ^= bit;
+						}
+					}
+				}
+				for (auto& entry : joysticks) {
+					ReSDL::JoystickState state;
+					entry.joystick->snapshot(state);
+					for (int axis = 0; axis < state.numAxes; ++axis) {
+						const Sint16 value = state.axes[axis];
+						if (value != entry.last.axes[axis] && submit({ counter, timestamp, entry.instanceId, InputSample::Kind::JoystickAxis, static_cast<Uint8>(axis), value })) {
+							entry.last.axes[axis] = value;
+						}
+					}
+				}
+				SDL_UnlockJoysticks();
+			}
+
+			void run()
+			{
+				auto next = std::chrono::steady_clock::now();
+				while (running.load(std::memory_order_relaxed)) {
+					sample();
+					next += period;
+					const auto now = std::chrono::steady_clock::now();
+					if (next < now) {
+						// fell behind, e.g. the process was suspended; do not try to catch up
+						next = now;
+					}
+					std::this_thread::sleep_until(next);
+				}
+			}
+
+		public:
+			explicit InputSampler(unsigned rate = 1000, size_t capacity = 4096)
+				: samples(capacity)
+				, period(std::chrono::nanoseconds(1000000000 / (rate ? rate : 1)))
+			{
+			}
+
+			InputSampler(const InputSampler&) = delete;
+			InputSampler& operator=(const InputSampler&) = delete;
+
+			~InputSampler()
+			{
+				stop();
+			}
+
+			void add(const std::shared_ptr<ReSDL::GameController>& controller)
+			{
+				if (running) {
+					return;
+				}
+				controllers.push_back({ controller, controller->instanceId(), {} });
+			}
+
+			void add(const std::shared_ptr<ReSDL::Joystick>& joystick)
+			{
+				if (running) {
+					return;
+				}
+				joysticks.push_back({ joystick, joystick->instanceId(), {} });
+			}
+
+			// drops the device with that instance id, e.g. after it was unplugged
+			void remove(SDL_JoystickID instanceId)
+			{
+				if (running) {
+					return;
+				}
+				controllers.erase(std::remove_if(controllers.begin(), controllers.end(), [instanceId](const ControllerEntry& entry) { return entry.instanceId == instanceId; }), controllers.end());
+				joysticks.erase(std::remove_if(joysticks.begin(), joysticks.end(), [instanceId](const JoystickEntry& entry) { return entry.instanceId == instanceId; }), joysticks.end());
+			}
+
+			void start()
+			{
+				if (running.exchange(true)) {
+					return;
+				}
+				thread = std::thread([this] { run(); });
+			}
+
+			void stop()
+			{
+				if (!running.exchange(false)) {
+					return;
+				}
+				thread.join();
+			}
+
+			bool isRunning() const
+			{
+				return running;
+			}
+
+			// main thread side, returns false when no sample is waiting
+			bool poll(InputSample& sample)
+			{
+				return samples.tryPop(sample);
+			}
+
+			// how often a change had to wait for a later tick because the main thread did not drain in time
+			size_t deferredCount() const
+			{
+				return deferred.load(std::memory_order_relaxed);
+			}
+		};
+
+	}
+}
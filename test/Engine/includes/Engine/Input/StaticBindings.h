@@ -0,0 +1,313 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <utility>
+#include <cstdlib>
+
+#include <Engine/Input/AxisInputManager.h>
+
+namespace Engine {
+	namespace Input {
+
+		// Compile time alternative to AxisInputManager's polling mode. Every binding is a concrete type,
+		// sources and mappings are plain values and handlers are stored as their own (lambda) types, so a
+		// whole pipeline is a tuple the compiler can inline into one straight function without any
+		// std::function or virtual call. Semantics match polling mode: sources of one binding are read in
+		// order, later active sources override earlier ones, and handlers are called every frame.
+		//
+		//	auto pipeline = makeInputPipeline(
+		//		bindAxis(Axis::Main_X, [&](Axis, double x) { ... },
+		//			KeyPairAxis{ SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT },
+		//			ControllerAxis<>{ 0, SDL_CONTROLLER_AXIS_LEFTX }),
+		//		bindButton(Button::A, [&](Button, ButtonState state) { ... },
+		//			KeyButton{ SDL_SCANCODE_SPACE }, ControllerButton{ 0, SDL_CONTROLLER_BUTTON_A }));
+		//	...
+		//	pipeline.update(StaticInputState::capture());
+
+		// the device state one frame of static bindings reads from
+		struct StaticInputState {
+			static constexpr size_t Slots = 4;
+			static constexpr Sint16 DeadZone = 1000;
+
+			const Uint8* keys = nullptr;
+			std::array<SDL_GameController*, Slots> controllers{};
+			std::array<SDL_Joystick*, Slots> joysticks{};
+
+			static StaticInputState capture()
+			{
+				StaticInputState state;
+				state.keys = SDL_GetKeyboardState(NULL);
+				return state;
+			}
+
+			StaticInputState& setController(size_t slot, const ReSDL::GameController& controller)
+			{
+				controllers[slot] = controller.handle.get();
+				return *this;
+			}
+
+			StaticInputState& setJoystick(size_t slot, const ReSDL::Joystick& joystick)
+			{
+				joysticks[slot] = joystick.handle.get();
+				return *this;
+			}
+		};
+
+		// value mappings, the static counterparts of AxisValueMappingS16 and RadialValueMappingS16
+		struct LinearS16 {
+			static constexpr double map(Sint16 value)
+			{
+				return static_cast<double>(value) / 32767;
+			}
+		};
+
+		struct RadialLinearS16 {
+			static constexpr Vec2d map(Sint16 x, Sint16 y)
+			{
+				return { LinearS16::map(x), LinearS16::map(y) };
+			}
+		};
+
+		// axis sources, read returns whether the source is active and if so writes value
+
+		struct KeyAxis {
+			Uint8 key;
+			double offValue = 0.0;
+			double maxValue = 1.0;
+
+			bool read(const StaticInputState& state, double& value) const
+			{
+				value = state.keys[key] ? maxValue : offValue;
+				return true;
+			}
+		};
+
+		struct KeyPairAxis {
+			Uint8 keyMin;
+			Uint8 keyMax;
+			double minValue = -1.0;
+			double offValue = 0.0;
+			double maxValue = 1.0;
+
+			bool read(const StaticInputState& state, double& value) const
+			{
+				value = state.keys[keyMin] ? minValue : state.keys[keyMax] ? maxValue : offValue;
+				return true;
+			}
+		};
+
+		template<typename Mapping = LinearS16>
+		struct ControllerAxis {
+			size_t slot;
+			SDL_GameControllerAxis axis;
+
+			bool read(const StaticInputState& state, double& value) const
+			{
+				const Sint16 raw = state.controllers[slot] ? SDL_GameControllerGetAxis(state.controllers[slot], axis) : 0;
+				if (std::abs(raw) <= StaticInputState::DeadZone) {
+					return false;
+				}
+				value = Mapping::map(raw);
+				return true;
+			}
+		};
+
+		template<typename Mapping = LinearS16>
+		struct JoystickAxis {
+			size_t slot;
+			int axis;
+
+			bool read(const StaticInputState& state, double& value) const
+			{
+				const Sint16 raw = state.joysticks[slot] ? SDL_JoystickGetAxis(state.joysticks[slot], axis) : 0;
+				if (std::abs(raw) <= StaticInputState::DeadZone) {
+					return false;
+				}
+				value = Mapping::map(raw);
+				return true;
+			}
+		};
+
+		// radial sources
+
+		// same as AxisInputManager's cross mappings, diagonals are normalized
+		inline Vec2d staticCrossValue(bool left, bool right, bool up, bool down)
+		{
+			const double value = (left || right) && (up || down) ? 0.707 : 1.0;
+			return { left ? -value : right ? value : 0.0, down ? value : up ? -value : 0.0 };
+		}
+
+		struct KeyCrossRadial {
+			Uint8 up, down, left, right;
+
+			bool read(const StaticInputState& state, Vec2d& value) const
+			{
+				value = staticCrossValue(state.keys[left], state.keys[right], state.keys[up], state.keys[down]);
+				return true;
+			}
+		};
+
+		template<typename Mapping = RadialLinearS16>
+		struct ControllerStickRadial {
+			size_t slot;
+			SDL_GameControllerAxis axisX;
+			SDL_GameControllerAxis axisY;
+
+			bool read(const StaticInputState& state, Vec2d& value) const
+			{
+				SDL_GameController* controller = state.controllers[slot];
+				if (!controller) {
+					return false;
+				}
+				const Sint16 x = SDL_GameControllerGetAxis(controller, axisX);
+				const Sint16 y = SDL_GameControllerGetAxis(controller, axisY);
+				if (std::abs(x) <= StaticInputState::DeadZone && std::abs(y) <= StaticInputState::DeadZone) {
+					return false;
+				}
+				value = Mapping::map(x, y);
+				return true;
+			}
+		};
+
+		struct ControllerCrossRadial {
+			size_t slot;
+			SDL_GameControllerButton up, down, left, right;
+
+			bool read(const StaticInputState& state, Vec2d& value) const
+			{
+				SDL_GameController* controller = state.controllers[slot];
+				if (!controller) {
+					return false;
+				}
+				value = staticCrossValue(
+					SDL_GameControllerGetButton(controller, left),
+					SDL_GameControllerGetButton(controller, right),
+					SDL_GameControllerGetButton(controller, up),
+					SDL_GameControllerGetButton(controller, down));
+				return true;
+			}
+		};
+
+		// button sources, read returns whether the button is down
+
+		struct KeyButton {
+			Uint8 key;
+
+			bool read(const StaticInputState& state) const
+			{
+				return state.keys[key] != 0;
+			}
+		};
+
+		struct ControllerButton {
+			size_t slot;
+			SDL_GameControllerButton button;
+
+			bool read(const StaticInputState& state) const
+			{
+				return state.controllers[slot] && SDL_GameControllerGetButton(state.controllers[slot], button);
+			}
+		};
+
+		// bindings
+
+		template<typename Handler, typename... Sources>
+		struct AxisBinding {
+			Axis axis;
+			Handler handler;
+			std::tuple<Sources...> sources;
+
+			void update(const StaticInputState& state)
+			{
+				double value = 0.0;
+				bool set = false;
+				std::apply([&](const auto&... source) { ((set |= source.read(state, value)), ...); }, sources);
+				if (set) {
+					handler(axis, value);
+				}
+			}
+		};
+
+		template<typename Handler, typename... Sources>
+		struct RadialBinding {
+			Radial radial;
+			Handler handler;
+			std::tuple<Sources...> sources;
+
+			void update(const StaticInputState& state)
+			{
+				Vec2d value;
+				bool set = false;
+				std::apply([&](const auto&... source) { ((set |= source.read(state, value)), ...); }, sources);
+				if (set) {
+					handler(radial, value);
+				}
+			}
+		};
+
+		// reports the same states as ButtonStateHandler: Push and Release on change, Hold or Off otherwise
+		template<typename Handler, typename... Sources>
+		struct ButtonBinding {
+			Button button;
+			Handler handler;
+			std::tuple<Sources...> sources;
+			bool wasDown = false;
+
+			void update(const StaticInputState& state)
+			{
+				const bool down = std::apply([&](const auto&... source) { return (false || ... || source.read(state)); }, sources);
+				if (down == wasDown) {
+					handler(button, down ? ButtonState::Hold : ButtonState::Off);
+				}
+				else {
+					handler(button, down ? ButtonState::Push : ButtonState::Release);
+				}
+				wasDown = down;
+			}
+		};
+
+		template<typename Handler, typename... Sources>
+		AxisBinding<Handler, Sources...> bindAxis(Axis axis, Handler handler, Sources... sources)
+		{
+			return { axis, std::move(handler), std::make_tuple(sources...) };
+		}
+
+		template<typename Handler, typename... Sources>
+		RadialBinding<Handler, Sources...> bindRadial(Radial radial, Handler handler, Sources... sources)
+		{
+			return { radial, std::move(handler), std::make_tuple(sources...) };
+		}
+
+		template<typename Handler, typename... Sources>
+		ButtonBinding<Handler, Sources...> bindButton(Button button, Handler handler, Sources... sources)
+		{
+			return { button, std::move(handler), std::make_tuple(sources...), false };
+		}
+
+		template<typename... Bindings>
+		class StaticInputPipeline
+		{
+			std::tuple<Bindings...> bindings;
+
+		public:
+			explicit StaticInputPipeline(Bindings... bindings)
+				: bindings(std::move(bindings)...)
+			{
+			}
+
+			// reads all sources and calls all handlers, in binding order
+			void update(const StaticInputState& state)
+			{
+				std::apply([&](auto&... binding) { (binding.update(state), ...); }, bindings);
+			}
+		};
+
+		template<typename... Bindings>
+		StaticInputPipeline<Bindings...> makeInputPipeline(Bindings... bindings)
+		{
+			return StaticInputPipeline<Bindings...>(std::move(bindings)...);
+		}
+
+	}
+}
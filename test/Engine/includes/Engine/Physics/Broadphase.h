@@ -0,0 +1,389 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Engine/Engine.h"
+#include "Engine/Concurrency/ThreadPool.h"
+
+namespace Engine {
+namespace Physics {
+
+struct Aabb2d
+{
+	Vec2d min;
+	Vec2d max;
+
+	bool overlaps(const Aabb2d& other) const
+	{
+		return min[0] <= other.max[0] && other.min[0] <= max[0]
+			&& min[1] <= other.max[1] && other.min[1] <= max[1];
+	}
+};
+
+using BodyId = uint32_t;
+
+// candidate pair, always ordered so that first < second
+struct BodyPair
+{
+	BodyId first;
+	BodyId second;
+};
+
+inline BodyPair makePair(BodyId a, BodyId b)
+{
+	return a < b ? BodyPair{ a, b } : BodyPair{ b, a };
+}
+
+// Uniform grid hashed into buckets. Keeps the set of overlapping pairs between calls,
+// so updatePairs only costs work proportional to the bodies that moved since the last call.
+class SpatialHashGrid
+{
+	struct CellRange
+	{
+		int minX, minY, maxX, maxY;
+
+		bool operator==(const CellRange& other) const
+		{
+			return minX == other.minX && minY == other.minY && maxX == other.maxX && maxY == other.maxY;
+		}
+	};
+
+	struct Body
+	{
+		Aabb2d box;
+		CellRange cells;
+		bool alive;
+		bool moved;
+		std::vector<BodyId> partners;
+	};
+
+	double m_inverseCellSize;
+	std::vector<Body> m_bodies;
+	std::vector<BodyId> m_freeIds;
+	std::vector<BodyId> m_moved;
+	std::unordered_map<uint64_t, std::vector<BodyId>> m_cells;
+	std::vector<BodyId> m_candidates;
+
+	static uint64_t cellKey(int x, int y)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+	}
+
+	CellRange cellsFor(const Aabb2d& box) const
+	{
+		return {
+			static_cast<int>(std::floor(box.min[0] * m_inverseCellSize)),
+			static_cast<int>(std::floor(box.min[1] * m_inverseCellSize)),
+			static_cast<int>(std::floor(box.max[0] * m_inverseCellSize)),
+			static_cast<int>(std::floor(box.max[1] * m_inverseCellSize)) };
+	}
+
+	void link(BodyId id, const CellRange& range)
+	{
+		for(int x = range.minX; x <= range.maxX; ++x) {
+			for(int y = range.minY; y <= range.maxY; ++y) {
+				m_cells[cellKey(x, y)].push_back(id);
+			}
+		}
+	}
+
+	void unlink(BodyId id, const CellRange& range)
+	{
+		for(int x = range.minX; x <= range.maxX; ++x) {
+			for(int y = range.minY; y <= range.maxY; ++y) {
+				auto cell = m_cells.find(cellKey(x, y));
+				if(cell == m_cells.end()) {
+					continue;
+				}
+				auto& ids = cell->second;
+				auto it = std::find(ids.begin(), ids.end(), id);
+				if(it != ids.end()) {
+					*it = ids.back();
+					ids.pop_back();
+				}
+				if(ids.empty()) {
+					m_cells.erase(cell);
+				}
+			}
+		}
+	}
+
+	void markMoved(BodyId id)
+	{
+		if(!m_bodies[id].moved) {
+			m_bodies[id].moved = true;
+			m_moved.push_back(id);
+		}
+	}
+
+	static void erasePartner(Body& body, BodyId partner)
+	{
+		auto it = std::find(body.partners.begin(), body.partners.end(), partner);
+		if(it != body.partners.end()) {
+			*it = body.partners.back();
+			body.partners.pop_back();
+		}
+	}
+
+public:
+	explicit SpatialHashGrid(double cellSize)
+	: m_inverseCellSize(1.0 / cellSize)
+	{
+	}
+
+	BodyId insert(const Aabb2d& box)
+	{
+		BodyId id;
+		if(!m_freeIds.empty()) {
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+		}
+		else {
+			id = static_cast<BodyId>(m_bodies.size());
+			m_bodies.emplace_back();
+		}
+		Body& body = m_bodies[id];
+		body.box = box;
+		body.cells = cellsFor(box);
+		body.alive = true;
+		body.moved = false;
+		body.partners.clear();
+		link(id, body.cells);
+		markMoved(id);
+		return id;
+	}
+
+	void update(BodyId id, const Aabb2d& box)
+	{
+		Body& body = m_bodies[id];
+		body.box = box;
+		const CellRange cells = cellsFor(box);
+		if(!(cells == body.cells)) {
+			unlink(id, body.cells);
+			body.cells = cells;
+			link(id, cells);
+		}
+		markMoved(id);
+	}
+
+	// Removes the body and drops the pairs it was part of at once. Those pairs are appended to
+	// removed if given; updatePairs does not report them. Unknown or removed ids are ignored.
+	void remove(BodyId id, std::vector<BodyPair>* removed = nullptr)
+	{
+		if(id >= m_bodies.size() || !m_bodies[id].alive) {
+			return;
+		}
+		Body& body = m_bodies[id];
+		unlink(id, body.cells);
+		for(BodyId partner : body.partners) {
+			erasePartner(m_bodies[partner], id);
+			if(removed) {
+				removed->push_back(makePair(id, partner));
+			}
+		}
+		body.partners.clear();
+		body.alive = false;
+		m_freeIds.push_back(id);
+	}
+
+	const Aabb2d& box(BodyId id) const
+	{
+		return m_bodies[id].box;
+	}
+
+	// Brings the persistent pair set up to date, only re-testing bodies that were inserted or
+	// updated since the last call. Pairs that started or stopped overlapping are appended.
+	void updatePairs(std::vector<BodyPair>& added, std::vector<BodyPair>& removed)
+	{
+		for(BodyId id : m_moved) {
+			Body& body = m_bodies[id];
+			body.moved = false;
+			if(!body.alive) {
+				continue;
+			}
+
+			// drop pairs that no longer overlap
+			for(size_t i = 0; i < body.partners.size();) {
+				const BodyId partner = body.partners[i];
+				if(!body.box.overlaps(m_bodies[partner].box)) {
+					erasePartner(m_bodies[partner], id);
+					body.partners[i] = body.partners.back();
+					body.partners.pop_back();
+					removed.push_back(makePair(id, partner));
+				}
+				else {
+					++i;
+				}
+			}
+
+			// find new ones in the cells the body covers
+			m_candidates.clear();
+			const CellRange& range = body.cells;
+			for(int x = range.minX; x <= range.maxX; ++x) {
+				for(int y = range.minY; y <= range.maxY; ++y) {
+					auto cell = m_cells.find(cellKey(x, y));
+					if(cell != m_cells.end()) {
+						m_candidates.insert(m_candidates.end(), cell->second.begin(), cell->second.end());
+					}
+				}
+			}
+			std::sort(m_candidates.begin(), m_candidates.end());
+			m_candidates.erase(std::unique(m_candidates.begin(), m_candidates.end()), m_candidates.end());
+
+			for(BodyId other : m_candidates) {
+				if(other == id || !body.box.overlaps(m_bodies[other].box)) {
+					continue;
+				}
+				if(std::find(body.partners.begin(), body.partners.end(), other) != body.partners.end()) {
+					continue;
+				}
+				body.partners.push_back(other);
+				m_bodies[other].partners.push_back(id);
+				added.push_back(makePair(id, other));
+			}
+		}
+		m_moved.clear();
+	}
+
+	// Appends every currently overlapping pair, as of the last updatePairs.
+	void pairs(std::vector<BodyPair>& out) const
+	{
+		for(BodyId id = 0; id < m_bodies.size(); ++id) {
+			for(BodyId partner : m_bodies[id].partners) {
+				if(id < partner) {
+					out.push_back({ id, partner });
+				}
+			}
+		}
+	}
+};
+
+// Sort-and-sweep along the x axis. The sorted order is kept between calls and restored with
+// an insertion sort, which is close to linear when only a few bodies moved.
+class SweepAndPrune
+{
+	struct Entry
+	{
+		double minX;
+		BodyId id;
+	};
+
+	std::vector<Aabb2d> m_boxes;
+	std::vector<BodyId> m_freeIds;
+	std::vector<Entry> m_sorted;
+	size_t m_changed = 0;
+	std::vector<std::vector<BodyPair>> m_chunkPairs;
+
+	void sort()
+	{
+		if(m_changed == 0) {
+			return;
+		}
+		for(auto &entry : m_sorted) {
+			entry.minX = m_boxes[entry.id].min[0];
+		}
+		// insertion sort degrades to quadratic when most of the order changed
+		if(m_changed > m_sorted.size() / 8) {
+			std::sort(m_sorted.begin(), m_sorted.end(), [](const Entry& a, const Entry& b) { return a.minX < b.minX; });
+			m_changed = 0;
+			return;
+		}
+		for(size_t i = 1; i < m_sorted.size(); ++i) {
+			const Entry entry = m_sorted[i];
+			size_t j = i;
+			while(j > 0 && m_sorted[j - 1].minX > entry.minX) {
+				m_sorted[j] = m_sorted[j - 1];
+				--j;
+			}
+			m_sorted[j] = entry;
+		}
+		m_changed = 0;
+	}
+
+	void sweep(size_t begin, size_t end, std::vector<BodyPair>& out) const
+	{
+		const size_t count = m_sorted.size();
+		for(size_t i = begin; i < end; ++i) {
+			const BodyId id = m_sorted[i].id;
+			const Aabb2d& box = m_boxes[id];
+			for(size_t j = i + 1; j < count && m_sorted[j].minX <= box.max[0]; ++j) {
+				const BodyId other = m_sorted[j].id;
+				if(box.overlaps(m_boxes[other])) {
+					out.push_back(makePair(id, other));
+				}
+			}
+		}
+	}
+
+public:
+	BodyId insert(const Aabb2d& box)
+	{
+		BodyId id;
+		if(!m_freeIds.empty()) {
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+			m_boxes[id] = box;
+		}
+		else {
+			id = static_cast<BodyId>(m_boxes.size());
+			m_boxes.push_back(box);
+		}
+		m_sorted.push_back({ box.min[0], id });
+		++m_changed;
+		return id;
+	}
+
+	void update(BodyId id, const Aabb2d& box)
+	{
+		m_boxes[id] = box;
+		++m_changed;
+	}
+
+	// unknown or removed ids are ignored, so an id is never recycled twice
+	void remove(BodyId id)
+	{
+		const auto entry = std::find_if(m_sorted.begin(), m_sorted.end(), [id](const Entry& e) { return e.id == id; });
+		if(entry == m_sorted.end()) {
+			return;
+		}
+		m_sorted.erase(entry);
+		m_freeIds.push_back(id);
+	}
+
+	const Aabb2d& box(BodyId id) const
+	{
+		return m_boxes[id];
+	}
+
+	// Appends all overlapping pairs. With a pool the sweep is split into chunks that are
+	// processed in parallel; the output order then follows the chunk order.
+	void findPairs(std::vector<BodyPair>& out, Concurrency::ThreadPool* pool = nullptr)
+	{
+		sort();
+		const size_t count = m_sorted.size();
+		if(!pool || pool->size() == 0 || count < 1024) {
+			sweep(0, count, out);
+			return;
+		}
+
+		const size_t chunks = (pool->size() + 1) * 4;
+		const size_t chunkSize = (count + chunks - 1) / chunks;
+		m_chunkPairs.resize(chunks);
+		pool->parallelFor(chunks, [&](size_t chunk) {
+			auto& pairs = m_chunkPairs[chunk];
+			pairs.clear();
+			const size_t begin = std::min(chunk * chunkSize, count);
+			sweep(begin, std::min(begin + chunkSize, count), pairs);
+		});
+		for(const auto& pairs : m_chunkPairs) {
+			out.insert(out.end(), pairs.begin(), pairs.end());
+		}
+	}
+};
+
+}
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <random>
+#include <limits>
+#include <chrono>
+
+#include "Engine/Engine.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ENGINE_PHYSICS_SSE2 1
+#endif
+
+namespace Engine {
+namespace Physics {
+
+// Integrates many point masses at once with the same semantics as PhysicsPoint::advance,
+// but stores mass, position and velocity as separate arrays (structure of arrays) so a
+// whole step is a handful of linear passes instead of one object construction per point.
+template<typename TimeType, size_t Dimensions>
+class PhysicsPointSystem : public IUpdatable, public IRenderable
+{
+public:
+	using Point = PhysicsPoint<double, double, TimeType, Dimensions>;
+	using Vector = Vec<double, Dimensions>;
+
+	static constexpr double InfiniteLifetime = std::numeric_limits<double>::infinity();
+
+	struct Emitter
+	{
+		Vector position;
+		Vector velocity;
+		Vector velocitySpread;
+		double mass = 1.0;
+		// points per second
+		double rate = 0.0;
+		TimeType lifetime = TimeType(1000);
+
+		double accumulator = 0.0;
+		std::minstd_rand random{ std::random_device()() };
+	};
+
+	explicit PhysicsPointSystem(size_t capacity = 0)
+	{
+		reserve(capacity);
+	}
+
+	void reserve(size_t capacity)
+	{
+		m_mass.reserve(capacity);
+		m_inverseMass.reserve(capacity);
+		m_lifetime.reserve(capacity);
+		for(size_t d = 0; d < Dimensions; ++d) {
+			m_position[d].reserve(capacity);
+			m_velocity[d].reserve(capacity);
+			m_impulse[d].reserve(capacity);
+		}
+	}
+
+	size_t size() const
+	{
+		return m_mass.size();
+	}
+
+	void clear()
+	{
+		m_mass.clear();
+		m_inverseMass.clear();
+		m_lifetime.clear();
+		for(size_t d = 0; d < Dimensions; ++d) {
+			m_position[d].clear();
+			m_velocity[d].clear();
+			m_impulse[d].clear();
+		}
+	}
+
+	size_t add(double mass, const Vector& position, const Vector& velocity, double lifetime = InfiniteLifetime)
+	{
+		m_mass.push_back(mass);
+		m_inverseMass.push_back(mass != 0.0 ? 1.0 / mass : 0.0);
+		m_lifetime.push_back(lifetime);
+		for(size_t d = 0; d < Dimensions; ++d) {
+			m_position[d].push_back(position[d]);
+			m_velocity[d].push_back(velocity[d]);
+			m_impulse[d].push_back(0.0);
+		}
+		return size() - 1;
+	}
+
+	size_t add(const Point& point, double lifetime = InfiniteLifetime)
+	{
+		return add(point.getMass(), point.getPosition(), point.getVelocity(), lifetime);
+	}
+
+	// Removes the point by moving the last point into its slot, so indices of other points may change.
+	void remove(size_t index)
+	{
+		const size_t last = size() - 1;
+		if(index != last) {
+			m_mass[index] = m_mass[last];
+			m_inverseMass[index] = m_inverseMass[last];
+			m_lifetime[index] = m_lifetime[last];
+			for(size_t d = 0; d < Dimensions; ++d) {
+				m_position[d][index] = m_position[d][last];
+				m_velocity[d][index] = m_velocity[d][last];
+				m_impulse[d][index] = m_impulse[d][last];
+			}
+		}
+		m_mass.pop_back();
+		m_inverseMass.pop_back();
+		m_lifetime.pop_back();
+		for(size_t d = 0; d < Dimensions; ++d) {
+			m_position[d].pop_back();
+			m_velocity[d].pop_back();
+			m_impulse[d].pop_back();
+		}
+	}
+
+	// Accumulates an impulse for a single point, consumed by the next advance.
+	void applyImpulse(size_t index, const Vector& impulse)
+	{
+		for(size_t d = 0; d < Dimensions; ++d) {
+			m_impulse[d][index] += impulse[d];
+		}
+		m_hasImpulses = true;
+	}
+
+	Point get(size_t index) const
+	{
+		return Point(m_mass[index], getPosition(index), getVelocity(index));
+	}
+
+	Vector getPosition(size_t index) const
+	{
+		Vector result;
+		for(size_t d = 0; d < Dimensions; ++d) {
+			result[d] = m_position[d][index];
+		}
+		return result;
+	}
+
+	Vector getVelocity(size_t index) const
+	{
+		Vector result;
+		for(size_t d = 0; d < Dimensions; ++d) {
+			result[d] = m_velocity[d][index];
+		}
+		return result;
+	}
+
+	const double *positions(size_t dimension) const
+	{
+		return m_position[dimension].data();
+	}
+
+	const double *velocities(size_t dimension) const
+	{
+		return m_velocity[dimension].data();
+	}
+
+	// Advances every point as PhysicsPoint::advance would: the position moves by the velocity
+	// before the step, then the velocity changes by (impulse + accumulated impulse) / mass.
+	// Points whose lifetime runs out are swap-removed afterwards.
+	template<typename DurationType>
+	void advance(const Vector& impulse, DurationType duration)
+	{
+		const double time = static_cast<double>(std::chrono::duration_cast<TimeType>(duration).count());
+		// the accumulated impulses are only read while some point has one
+		const bool expired = m_hasImpulses ? integrate<true>(impulse, time) : integrate<false>(impulse, time);
+		m_hasImpulses = false;
+		if(expired) {
+			removeExpired();
+		}
+	}
+
+	Emitter& addEmitter(const Emitter& emitter)
+	{
+		m_emitters.push_back(emitter);
+		return m_emitters.back();
+	}
+
+	std::vector<Emitter>& emitters()
+	{
+		return m_emitters;
+	}
+
+	void emit(Emitter& emitter, std::chrono::microseconds duration)
+	{
+		emitter.accumulator += emitter.rate * std::chrono::duration<double>(duration).count();
+		const double lifetime = static_cast<double>(emitter.lifetime.count());
+		std::uniform_real_distribution<double> spread(-1.0, 1.0);
+		while(emitter.accumulator >= 1.0) {
+			Vector velocity = emitter.velocity;
+			for(size_t d = 0; d < Dimensions; ++d) {
+				velocity[d] += emitter.velocitySpread[d] * spread(emitter.random);
+			}
+			add(emitter.mass, emitter.position, velocity, lifetime);
+			emitter.accumulator -= 1.0;
+		}
+	}
+
+	void setImpulse(const Vector& impulse)
+	{
+		m_stepImpulse = impulse;
+	}
+
+	void setColor(const ReSDL::Color& color)
+	{
+		m_color = color;
+	}
+
+	void update(std::chrono::microseconds deltaT) override
+	{
+		for(auto &emitter : m_emitters) {
+			emit(emitter, deltaT);
+		}
+		advance(m_stepImpulse, deltaT);
+	}
+
+	void render(ReSDL::Renderer& renderer) override
+	{
+		const size_t count = size();
+		if(count == 0) {
+			return;
+		}
+		m_points.resize(count);
+		const double *x = m_position[0].data();
+		for(size_t i = 0; i < count; ++i) {
+			m_points[i].x = static_cast<int>(x[i]);
+		}
+		if constexpr (Dimensions > 1) {
+			const double *y = m_position[1].data();
+			for(size_t i = 0; i < count; ++i) {
+				m_points[i].y = static_cast<int>(y[i]);
+			}
+		}
+		renderer.setDrawColor(m_color);
+		renderer.drawPoints(m_points.data(), count);
+	}
+
+private:
+	// Moves every point and counts down its lifetime in one pass over the arrays, and returns
+	// true if some lifetime ran out.
+	template<bool Accumulated>
+	bool integrate(const Vector& impulse, double time)
+	{
+		const size_t count = size();
+		const double *inverseMass = m_inverseMass.data();
+		double *lifetime = m_lifetime.data();
+		double *position[Dimensions];
+		double *velocity[Dimensions];
+		double *accumulated[Dimensions];
+		for(size_t d = 0; d < Dimensions; ++d) {
+			position[d] = m_position[d].data();
+			velocity[d] = m_velocity[d].data();
+			accumulated[d] = m_impulse[d].data();
+		}
+
+		size_t i = 0;
+		bool expired = false;
+#ifdef ENGINE_PHYSICS_SSE2
+		const __m128d t = _mm_set1_pd(time);
+		const __m128d zero = _mm_setzero_pd();
+		__m128d j[Dimensions];
+		for(size_t d = 0; d < Dimensions; ++d) {
+			j[d] = _mm_set1_pd(impulse[d]);
+		}
+		__m128d expiredMask = zero;
+		for(; i + 2 <= count; i += 2) {
+			const __m128d m = _mm_loadu_pd(inverseMass + i);
+			for(size_t d = 0; d < Dimensions; ++d) {
+				const __m128d v = _mm_loadu_pd(velocity[d] + i);
+				const __m128d p = _mm_loadu_pd(position[d] + i);
+				__m128d change = j[d];
+				if constexpr (Accumulated) {
+					change = _mm_add_pd(change, _mm_loadu_pd(accumulated[d] + i));
+					_mm_storeu_pd(accumulated[d] + i, zero);
+				}
+				_mm_storeu_pd(position[d] + i, _mm_add_pd(p, _mm_mul_pd(v, t)));
+				_mm_storeu_pd(velocity[d] + i, _mm_add_pd(v, _mm_mul_pd(change, m)));
+			}
+			const __m128d l = _mm_sub_pd(_mm_loadu_pd(lifetime + i), t);
+			_mm_storeu_pd(lifetime + i, l);
+			expiredMask = _mm_or_pd(expiredMask, _mm_cmple_pd(l, zero));
+		}
+		expired = _mm_movemask_pd(expiredMask) != 0;
+#endif
+		for(; i < count; ++i) {
+			for(size_t d = 0; d < Dimensions; ++d) {
+				double change = impulse[d];
+				if constexpr (Accumulated) {
+					change += accumulated[d][i];
+					accumulated[d][i] = 0.0;
+				}
+				position[d][i] += velocity[d][i] * time;
+				velocity[d][i] += change * inverseMass[i];
+			}
+			lifetime[i] -= time;
+			expired |= lifetime[i] <= 0.0;
+		}
+		return expired;
+	}
+
+	void removeExpired()
+	{
+		for(size_t i = size(); i > 0; --i) {
+			if(m_lifetime[i - 1] <= 0.0) {
+				remove(i - 1);
+			}
+		}
+	}
+
+	std::vector<double> m_mass;
+	std::vector<double> m_inverseMass;
+	std::vector<double> m_lifetime;
+	std::array<std::vector<double>, Dimensions> m_position;
+	std::array<std::vector<double>, Dimensions> m_velocity;
+	std::array<std::vector<double>, Dimensions> m_impulse;
+
+	bool m_hasImpulses = false;
+
+	std::vector<Emitter> m_emitters;
+	Vector m_stepImpulse;
+	ReSDL::Color m_color = ReSDL::Color::White;
+	std::vector<SDL_Point> m_points;
+};
+
+using PhysicsPointSystem2d = PhysicsPointSystem<std::chrono::milliseconds, 2>;
+
+}
+}
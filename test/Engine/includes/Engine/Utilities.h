@@ -8,120 +8,329 @@
 
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ENGINE_VEC_SSE2 1
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define ENGINE_VEC_AVX 1
+#endif
+
+// SIMD kernels cannot run during constant evaluation, so they are only used where the
+// compiler lets us tell both apart; otherwise the scalar loops (which auto-vectorize) are used.
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define ENGINE_VEC_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+#if !defined(ENGINE_VEC_CONSTANT_EVALUATED) && ((defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925))
+#define ENGINE_VEC_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+
+template<typename T, size_t N>
+struct Vec;
+
+// scalar types that may be combined with a Vec
+template<typename S>
+struct IsVecScalar : std::is_arithmetic<S> {};
+
+namespace detail {
+
+	template<typename T, size_t N>
+	struct VecAlignment : std::integral_constant<size_t, alignof(std::array<T, N>)> {};
+	template<>
+	struct VecAlignment<float, 4> : std::integral_constant<size_t, 16> {};
+	template<>
+	struct VecAlignment<double, 2> : std::integral_constant<size_t, 16> {};
+	template<>
+	struct VecAlignment<double, 4> : std::integral_constant<size_t, 32> {};
+
+	// element-wise kernels for the specializations that map onto SSE/AVX registers
+	template<typename T, size_t N>
+	struct VecKernel
+	{
+		static constexpr bool available = false;
+	};
+
+#if defined(ENGINE_VEC_SSE2) && defined(ENGINE_VEC_CONSTANT_EVALUATED)
+	template<>
+	struct VecKernel<float, 4>
+	{
+		static constexpr bool available = true;
+
+		static void add(const float *a, const float *b, float *r) { _mm_storeu_ps(r, _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+		static void sub(const float *a, const float *b, float *r) { _mm_storeu_ps(r, _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+		static void mul(const float *a, float s, float *r) { _mm_storeu_ps(r, _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(s))); }
+		static void div(const float *a, float s, float *r) { _mm_storeu_ps(r, _mm_div_ps(_mm_loadu_ps(a), _mm_set1_ps(s))); }
+		static void neg(const float *a, float *r) { _mm_storeu_ps(r, _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(a))); }
+
+		static float dot(const float *a, const float *b)
+		{
+			const __m128 m = _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+			const __m128 s = _mm_add_ps(m, _mm_movehl_ps(m, m));
+			return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+		}
+	};
+
+	template<>
+	struct VecKernel<double, 2>
+	{
+		static constexpr bool available = true;
+
+		static void add(const double *a, const double *b, double *r) { _mm_storeu_pd(r, _mm_add_pd(_mm_loadu_pd(a), _mm_loadu_pd(b))); }
+		static void sub(const double *a, const double *b, double *r) { _mm_storeu_pd(r, _mm_sub_pd(_mm_loadu_pd(a), _mm_loadu_pd(b))); }
+		static void mul(const double *a, double s, double *r) { _mm_storeu_pd(r, _mm_mul_pd(_mm_loadu_pd(a), _mm_set1_pd(s))); }
+		static void div(const double *a, double s, double *r) { _mm_storeu_pd(r, _mm_div_pd(_mm_loadu_pd(a), _mm_set1_pd(s))); }
+		static void neg(const double *a, double *r) { _mm_storeu_pd(r, _mm_sub_pd(_mm_setzero_pd(), _mm_loadu_pd(a))); }
+
+		static double dot(const double *a, const double *b)
+		{
+			const __m128d m = _mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b));
+			return _mm_cvtsd_f64(_mm_add_sd(m, _mm_unpackhi_pd(m, m)));
+		}
+	};
+
+	template<>
+	struct VecKernel<double, 4>
+	{
+		static constexpr bool available = true;
+
+#ifdef ENGINE_VEC_AVX
+		static void add(const double *a, const double *b, double *r) { _mm256_storeu_pd(r, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); }
+		static void sub(const double *a, const double *b, double *r) { _mm256_storeu_pd(r, _mm256_sub_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))); }
+		static void mul(const double *a, double s, double *r) { _mm256_storeu_pd(r, _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_set1_pd(s))); }
+		static void div(const double *a, double s, double *r) { _mm256_storeu_pd(r, _mm256_div_pd(_mm256_loadu_pd(a), _mm256_set1_pd(s))); }
+		static void neg(const double *a, double *r) { _mm256_storeu_pd(r, _mm256_sub_pd(_mm256_setzero_pd(), _mm256_loadu_pd(a))); }
+
+		static double dot(const double *a, const double *b)
+		{
+			const __m256d m = _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b));
+			const __m128d s = _mm_add_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+			return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+		}
+#else
+		using Half = VecKernel<double, 2>;
+
+		static void add(const double *a, const double *b, double *r) { Half::add(a, b, r); Half::add(a + 2, b + 2, r + 2); }
+		static void sub(const double *a, const double *b, double *r) { Half::sub(a, b, r); Half::sub(a + 2, b + 2, r + 2); }
+		static void mul(const double *a, double s, double *r) { Half::mul(a, s, r); Half::mul(a + 2, s, r + 2); }
+		static void div(const double *a, double s, double *r) { Half::div(a, s, r); Half::div(a + 2, s, r + 2); }
+		static void neg(const double *a, double *r) { Half::neg(a, r); Half::neg(a + 2, r + 2); }
+
+		static double dot(const double *a, const double *b)
+		{
+			const __m128d m = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)), _mm_mul_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+			return _mm_cvtsd_f64(_mm_add_sd(m, _mm_unpackhi_pd(m, m)));
+		}
+#endif
+	};
+#endif
+
+	template<typename T, typename U, size_t N>
+	constexpr bool useVecKernel()
+	{
+		return std::is_same<T, U>::value && VecKernel<T, N>::available;
+	}
+
+	constexpr bool isConstantEvaluated()
+	{
+#ifdef ENGINE_VEC_CONSTANT_EVALUATED
+		return ENGINE_VEC_CONSTANT_EVALUATED();
+#else
+		return true;
+#endif
+	}
+}
+
+// Base of the lazily evaluated vector expressions built by lazy(). A chain such as
+// lazy(speed) + lazy(acceleration) * dt is evaluated in a single loop when it is assigned
+// to a Vec, instead of materializing one temporary per operator. Leaves refer to their Vec,
+// so an expression must not outlive the statement it was built in.
+template<typename E>
+struct VecExpression
+{
+	constexpr const E& self() const
+	{
+		return static_cast<const E&>(*this);
+	}
+};
+
 template<typename T, size_t N>
-struct Vec
+struct alignas(detail::VecAlignment<T, N>::value) Vec
 {
 	std::array<T, N> data;
 
-	Vec()
-	: data(std::array<T,N>())
+	constexpr Vec()
+	: data()
 	{
 	}
-	
-	Vec(const std::array<T,N> &data)
+
+	constexpr Vec(const std::array<T,N> &data)
 	: data(data)
 	{
 	}
-	
-	Vec(std::initializer_list<T> l)
+
+	constexpr Vec(std::initializer_list<T> l)
+	: Vec() {
+		size_t i = 0;
+		for(auto it = l.begin(); it != l.end() && i < N; ++it, ++i) {
+			data[i] = *it;
+		}
+	}
+
+	template<typename E, typename = std::enable_if_t<E::size == N>>
+	constexpr Vec(const VecExpression<E> &expression)
 	: Vec() {
-		std::copy(l.begin(), l.end(), data.begin());
+		for(size_t i = 0; i < N; ++i) {
+			data[i] = static_cast<T>(expression.self()[i]);
+		}
+	}
+
+	template<typename E, typename = std::enable_if_t<E::size == N>>
+	constexpr Vec& operator=(const VecExpression<E> &expression)
+	{
+		for(size_t i = 0; i < N; ++i) {
+			data[i] = static_cast<T>(expression.self()[i]);
+		}
+		return *this;
 	}
-	
+
 	template<typename U>
-	auto operator+(const Vec<U,N> &other) const -> Vec<decltype(T()+U()),N>
+	constexpr auto operator+(const Vec<U,N> &other) const -> Vec<decltype(T()+U()),N>
 	{
 		using X = decltype(T()+U());
-		std::array<X,N> newData;
+		Vec<X,N> result;
+		if constexpr (detail::useVecKernel<T,U,N>()) {
+			if(!detail::isConstantEvaluated()) {
+				detail::VecKernel<T,N>::add(data.data(), other.data.data(), result.data.data());
+				return result;
+			}
+		}
 		for(size_t i = 0; i < N; ++i) {
-			newData[i] = data[i] + other.data[i];
+			result.data[i] = data[i] + other.data[i];
 		}
-		return Vec<X,N>(newData);
+		return result;
 	}
-	
+
 	template<typename U>
-	auto operator-(const Vec<U,N> &other) const -> Vec<decltype(T()-U()),N>
+	constexpr auto operator-(const Vec<U,N> &other) const -> Vec<decltype(T()-U()),N>
 	{
-		using X = decltype(T()+U());
-		std::array<X,N> newData;
+		using X = decltype(T()-U());
+		Vec<X,N> result;
+		if constexpr (detail::useVecKernel<T,U,N>()) {
+			if(!detail::isConstantEvaluated()) {
+				detail::VecKernel<T,N>::sub(data.data(), other.data.data(), result.data.data());
+				return result;
+			}
+		}
 		for(size_t i = 0; i < N; ++i) {
-			newData[i] = data[i] - other.data[i];
+			result.data[i] = data[i] - other.data[i];
 		}
-		return Vec<X,N>(newData);
+		return result;
 	}
-	
-	Vec<T,N> operator-() const
+
+	constexpr Vec<T,N> operator-() const
 	{
-		std::array<T,N> newData;
+		Vec<T,N> result;
+		if constexpr (detail::useVecKernel<T,T,N>()) {
+			if(!detail::isConstantEvaluated()) {
+				detail::VecKernel<T,N>::neg(data.data(), result.data.data());
+				return result;
+			}
+		}
 		for(size_t i = 0; i < N; ++i) {
-			newData[i] = -data[i];
+			result.data[i] = -data[i];
 		}
-		return Vec<T,N>(newData);
+		return result;
 	}
-	
+
+	// dot product
 	template<typename U>
-	auto operator*(const Vec<U,N> &other) const -> decltype((T()*U()) + (T()*U()))
+	constexpr auto operator*(const Vec<U,N> &other) const -> decltype((T()*U()) + (T()*U()))
 	{
 		using X = decltype((T()*U()) + (T()*U()));
+		if constexpr (detail::useVecKernel<T,U,N>()) {
+			if(!detail::isConstantEvaluated()) {
+				return detail::VecKernel<T,N>::dot(data.data(), other.data.data());
+			}
+		}
 		X accum{};
 		for(size_t i = 0; i < N; ++i) {
-			accum += data[i] + other.data[i];
+			accum += data[i] * other.data[i];
 		}
 		return accum;
 	}
-	
-	template<typename U>
-	auto operator*(const U &scalar) const -> Vec<decltype(T()*U()),N>
+
+	template<typename U, typename = std::enable_if_t<IsVecScalar<U>::value>>
+	constexpr auto operator*(const U &scalar) const -> Vec<decltype(T()*U()),N>
 	{
 		using X = decltype(T()*U());
-		std::array<X,N> newData;
+		Vec<X,N> result;
+		if constexpr (detail::useVecKernel<T,X,N>()) {
+			if(!detail::isConstantEvaluated()) {
+				detail::VecKernel<T,N>::mul(data.data(), static_cast<T>(scalar), result.data.data());
+				return result;
+			}
+		}
 		for(size_t i = 0; i < N; ++i) {
-			newData[i] = data[i] * scalar;
+			result.data[i] = data[i] * scalar;
 		}
-		return Vec<X,N>(newData);
+		return result;
 	}
-	
-	template<typename U>
-	auto operator/(const U &scalar) const -> Vec<decltype(T()/U()),N>
+
+	template<typename U, typename = std::enable_if_t<IsVecScalar<U>::value>>
+	constexpr auto operator/(const U &scalar) const -> Vec<decltype(T()/U()),N>
 	{
-		using X = decltype(T()*U());
-		std::array<X,N> newData;
+		using X = decltype(T()/U());
+		Vec<X,N> result;
+		if constexpr (detail::useVecKernel<T,X,N>()) {
+			if(!detail::isConstantEvaluated()) {
+				detail::VecKernel<T,N>::div(data.data(), static_cast<T>(scalar), result.data.data());
+				return result;
+			}
+		}
 		for(size_t i = 0; i < N; ++i) {
-			newData[i] = data[i] / scalar;
+			result.data[i] = data[i] / scalar;
 		}
-		return Vec<X,N>(newData);
+		return result;
 	}
-	
+
 	Vec<T,N> normalized() const
 	{
 		T length = this->length();
 		return length != T(0) ? (*this * (T(1) / length)) : *this;
 	}
-	
-	T lengthSquared() const
+
+	constexpr T lengthSquared() const
 	{
-		T accum{};
-		for(const T& v : data) {
-			accum += v * v;
-		}
-		return accum;
+		return *this * *this;
 	}
-	
+
 	T length() const
 	{
+		using std::sqrt;
 		return sqrt(lengthSquared());
 	}
-	
-	T operator[](const size_t index) const
+
+	constexpr T operator[](const size_t index) const
 	{
 		return data[index];
 	}
-	
-	T& operator[](const size_t index)
+
+	constexpr T& operator[](const size_t index)
 	{
 		return data[index];
 	}
-	
+
 
 	constexpr T& x()
 	{
@@ -140,32 +349,49 @@ struct Vec
 		return data[2];
 	}
 
+	constexpr T x() const
+	{
+		return data[0];
+	}
+
+	constexpr T y() const
+	{
+		static_assert(N > 1);
+		return data[1];
+	}
+
+	constexpr T z() const
+	{
+		static_assert(N > 2);
+		return data[2];
+	}
+
 	template<size_t NewSize>
-	Vec<T,NewSize> resize(const T& fill = T()) const
+	constexpr Vec<T,NewSize> resize(const T& fill = T()) const
 	{
-		std::array<T,NewSize> newData;
+		Vec<T,NewSize> result;
 		size_t i = 0;
 		while(i < NewSize && i < N) {
-			newData[i] = data[i];
+			result.data[i] = data[i];
 			++i;
 		}
 		while(i < NewSize) {
-			newData[i] = fill;
+			result.data[i] = fill;
 			++i;
 		}
-		return Vec<T,NewSize>(newData);
+		return result;
 	}
-	
+
 	template<typename NewType>
-	Vec<NewType,N> convert() const
+	constexpr Vec<NewType,N> convert() const
 	{
-		std::array<NewType,N> newData;
+		Vec<NewType,N> result;
 		for(size_t i = 0; i < N; ++i) {
-			newData[i] = static_cast<NewType>(data[i]);
+			result.data[i] = static_cast<NewType>(data[i]);
 		}
-		return Vec<NewType,N>(newData);
+		return result;
 	}
-	
+
 	SDL_Point toSDLPoint() const
 	{
 		Vec<T,2> resized = this->resize<2>();
@@ -189,6 +415,152 @@ std::ostream &operator<<(std::ostream &os, const Vec<T,N> &vec)
 	return os;
 }
 
+template<typename T, size_t N>
+struct VecLeaf : VecExpression<VecLeaf<T,N>>
+{
+	using value_type = T;
+	static constexpr size_t size = N;
+
+	const Vec<T,N> &vec;
+
+	constexpr explicit VecLeaf(const Vec<T,N> &vec)
+	: vec(vec)
+	{
+	}
+
+	constexpr T operator[](const size_t index) const
+	{
+		return vec.data[index];
+	}
+};
+
+template<typename L, typename R, typename Op>
+struct VecBinaryExpression : VecExpression<VecBinaryExpression<L,R,Op>>
+{
+	static_assert(L::size == R::size, "vector expressions must have the same size");
+	using value_type = decltype(Op::apply(std::declval<typename L::value_type>(), std::declval<typename R::value_type>()));
+	static constexpr size_t size = L::size;
+
+	L left;
+	R right;
+
+	constexpr VecBinaryExpression(const L &left, const R &right)
+	: left(left)
+	, right(right)
+	{
+	}
+
+	constexpr value_type operator[](const size_t index) const
+	{
+		return Op::apply(left[index], right[index]);
+	}
+};
+
+template<typename L, typename S, typename Op>
+struct VecScalarExpression : VecExpression<VecScalarExpression<L,S,Op>>
+{
+	using value_type = decltype(Op::apply(std::declval<typename L::value_type>(), std::declval<S>()));
+	static constexpr size_t size = L::size;
+
+	L left;
+	S scalar;
+
+	constexpr VecScalarExpression(const L &left, const S &scalar)
+	: left(left)
+	, scalar(scalar)
+	{
+	}
+
+	constexpr value_type operator[](const size_t index) const
+	{
+		return Op::apply(left[index], scalar);
+	}
+};
+
+template<typename L>
+struct VecNegateExpression : VecExpression<VecNegateExpression<L>>
+{
+	using value_type = decltype(-std::declval<typename L::value_type>());
+	static constexpr size_t size = L::size;
+
+	L operand;
+
+	constexpr explicit VecNegateExpression(const L &operand)
+	: operand(operand)
+	{
+	}
+
+	constexpr value_type operator[](const size_t index) const
+	{
+		return -operand[index];
+	}
+};
+
+namespace detail {
+	struct VecAdd { template<typename A, typename B> static constexpr auto apply(const A &a, const B &b) { return a + b; } };
+	struct VecSub { template<typename A, typename B> static constexpr auto apply(const A &a, const B &b) { return a - b; } };
+	struct VecMul { template<typename A, typename B> static constexpr auto apply(const A &a, const B &b) { return a * b; } };
+	struct VecDiv { template<typename A, typename B> static constexpr auto apply(const A &a, const B &b) { return a / b; } };
+}
+
+template<typename T, size_t N>
+constexpr VecLeaf<T,N> lazy(const Vec<T,N> &vec)
+{
+	return VecLeaf<T,N>(vec);
+}
+
+template<typename E>
+constexpr Vec<typename E::value_type, E::size> eval(const VecExpression<E> &expression)
+{
+	return Vec<typename E::value_type, E::size>(expression);
+}
+
+#define ENGINE_VEC_EXPRESSION_OPERATOR(op, Op) \
+	template<typename L, typename R> \
+	constexpr VecBinaryExpression<L,R,Op> operator op(const VecExpression<L> &l, const VecExpression<R> &r) \
+	{ \
+		return { l.self(), r.self() }; \
+	} \
+	template<typename L, typename T, size_t N> \
+	constexpr VecBinaryExpression<L,VecLeaf<T,N>,Op> operator op(const VecExpression<L> &l, const Vec<T,N> &r) \
+	{ \
+		return { l.self(), VecLeaf<T,N>(r) }; \
+	} \
+	template<typename T, size_t N, typename R> \
+	constexpr VecBinaryExpression<VecLeaf<T,N>,R,Op> operator op(const Vec<T,N> &l, const VecExpression<R> &r) \
+	{ \
+		return { VecLeaf<T,N>(l), r.self() }; \
+	}
+
+ENGINE_VEC_EXPRESSION_OPERATOR(+, detail::VecAdd)
+ENGINE_VEC_EXPRESSION_OPERATOR(-, detail::VecSub)
+
+#undef ENGINE_VEC_EXPRESSION_OPERATOR
+
+template<typename L, typename S, typename = std::enable_if_t<IsVecScalar<S>::value>>
+constexpr VecScalarExpression<L,S,detail::VecMul> operator*(const VecExpression<L> &l, const S &scalar)
+{
+	return { l.self(), scalar };
+}
+
+template<typename L, typename S, typename = std::enable_if_t<IsVecScalar<S>::value>>
+constexpr VecScalarExpression<L,S,detail::VecMul> operator*(const S &scalar, const VecExpression<L> &l)
+{
+	return { l.self(), scalar };
+}
+
+template<typename L, typename S, typename = std::enable_if_t<IsVecScalar<S>::value>>
+constexpr VecScalarExpression<L,S,detail::VecDiv> operator/(const VecExpression<L> &l, const S &scalar)
+{
+	return { l.self(), scalar };
+}
+
+template<typename L>
+constexpr VecNegateExpression<L> operator-(const VecExpression<L> &l)
+{
+	return VecNegateExpression<L>(l.self());
+}
+
 using Vec2i = Vec<int, 2>;
 
 using Vec2d = Vec<double,2>;
@@ -196,3 +568,5 @@ using Vec2d = Vec<double,2>;
 using Vec3d = Vec<double,3>;
 
 using Vec4d = Vec<double,4>;
+
+using Vec4f = Vec<float,4>;
@@ -32,7 +32,7 @@ namespace Engine {
 		m_Renderer->setRenderTarget(m_TargetTexture.handle.get());
 	}
 	
-	void RttRendererWindow::finalizeFrame()
+	Uint64 RttRendererWindow::finalizeFrame()
 	{
 		// render target texture to window
 		m_Renderer->setRenderTarget(nullptr);
@@ -40,6 +40,8 @@ namespace Engine {
 		m_Renderer->clear();
 		m_Renderer->copy(*m_TargetTexture, nullptr, &m_dstRect);
 		m_Renderer->present();
+		// with vsync present blocks until the swap, so this is as close to photons as SDL gets
+		return SDL_GetPerformanceCounter();
 	}
 
 	void RttRendererWindow::updateDstRect()
@@ -74,7 +76,12 @@ namespace Engine {
 		, frameCount{ 0 }
 		, sdl{SDL_INIT_EVERYTHING}
 	{
-		
+		mixerNode = dsp.add(std::make_shared<Audio::RenderNode>("mixer", [](void* userdata, float* stereo, size_t frames) {
+			static_cast<Audio::Mixer*>(userdata)->render(stereo, frames);
+		}, &mixer));
+		masterBus = dsp.add(std::make_shared<Audio::GainNode>("master"));
+		dsp.connect(mixerNode, masterBus);
+		dsp.setOutput(masterBus);
 	}
 	
 	
@@ -93,58 +100,123 @@ namespace Engine {
 		m_Updateables.push_back(updateable);
 	}
 	
-	struct AudioData {
-		float phase = 0.0;
-		float volume = 0.0;
-	};
-
 	void Engine::start()
 	{
 		using namespace ReSDL;
 		SDL_AudioSpec spec{}, got{};
 
-		AudioData ad;
-
-		SDL_AudioCallback cb = [](void* userdata, Uint8* stream, int length) {
-			auto &ad = *reinterpret_cast<AudioData*>(userdata);
-			auto data = reinterpret_cast<float*>(stream);
-			size_t count = length / sizeof(float);
-			const float freq = 2.0f * static_cast<float>(std::_Pi) * 440.0f;
-			const float step = 1.0f / 48000;
-			float t = ad.phase;
-			for(size_t i = 0; i < count; i += 2) {
-				data[i] = data[i + 1] = ad.volume * sinf(t * freq);
-				t += step;
-			}			
-			ad.phase = t;
-		};
-		spec.callback = cb;
-		spec.freq = 48000;
+		// the mixer and dsp run at mixRate in stereo float, audioOutput converts to what the device took
+		if(!pushAudio)
+		{
+			spec.callback = [](void* userdata, Uint8* stream, int length) {
+				auto* engine = static_cast<Engine*>(userdata);
+				const Uint64 startedAt = engine->audioDeadlines.callbackStarted();
+				engine->audioOutput->render(stream, static_cast<size_t>(length));
+				engine->audioDeadlines.callbackFinished(startedAt, length);
+			};
+		}
+		spec.freq = mixRate;
 		spec.channels = 2;
-		spec.format = AUDIO_F32;
-		spec.samples = 256;
-		spec.userdata = &ad;
+		spec.format = AUDIO_F32SYS;
+		spec.samples = audioBlockFrames;
+		spec.userdata = this;
 		auto deviceNames = AudioDevice::enumerate(false);
 		auto device = AudioDevice::open(deviceNames[0], false, spec, got);
+		if(device && !Audio::OutputConverter::supports(got.format))
+		{
+			device.reset();
+			device = AudioDevice::open(deviceNames[0], false, spec, got, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
+		}
 
-		
-		// std::array<float, 24000> data;
-		// const float freq = 2.0 * std::_Pi * 240.0;
-		// float t = 0;
-		// for(size_t i = 0; i < data.size(); i += 2) {
-		// 	data[i] = data[i + 1] = 1.0 * sinf(t * freq);
-		// 	t += step;
-		// }
-		// const auto statusBefore = device->status();
+		if(!soundBankPath.empty())
+		{
+			soundBank = std::make_unique<Audio::SoundBank>(soundBankPath);
+			if(soundBank->sampleRate() != mixRate)
+			{
+				throw std::runtime_error(soundBankPath + " was built for " + std::to_string(soundBank->sampleRate()) + " Hz, the mixer runs at " + std::to_string(mixRate) + " Hz");
+			}
+			soundBank->prefetch();
+		}
+
+		audioFormat = Audio::AudioFormat::fromSpec(got);
+		audioDeadlines.setFormat(got);
+		voices.setSampleRate(mixRate);
+		dsp.setSampleRate(mixRate);
+		dsp.publish();
+		audioOutput = std::make_unique<Audio::OutputConverter>(mixRate, audioFormat, &Audio::DspGraph::pull, &dsp);
+		const Uint32 queueTarget = static_cast<Uint32>(2 * audioFormat.blockFrames * audioFormat.bytesPerFrame());
+
+		// 440 Hz test tone while B is held
+		const auto sine = Audio::Wavetable::sine();
+		Audio::OscillatorSource<Audio::WavetableOscillator> tone(Audio::WavetableOscillator(sine, 440.0, mixRate), 440.0, mixRate);
+		Audio::VoiceId toneVoice = 0;
+
+		// music is streamed from the mapped file, only a small ring of it is converted at any time
+		Audio::StreamRefiller streamRefiller;
+		std::shared_ptr<Audio::AudioStream> music;
+		std::unique_ptr<Audio::MidiPlayer> midiMusic;
+		const bool isMidi = musicPath.size() > 4 && (musicPath.compare(musicPath.size() - 4, 4, ".mid") == 0 || musicPath.compare(musicPath.size() - 4, 4, ".MID") == 0);
+		if(isMidi)
+		{
+			// a song is small enough to sequence and synthesize right in the audio callback
+			midiMusic = std::make_unique<Audio::MidiPlayer>(std::make_shared<const Audio::MidiFile>(musicPath), mixRate);
+			midiMusic->setLoop(true);
+			mixer.play(midiMusic.get(), 0.5f);
+		}
+		else if(!musicPath.empty())
+		{
+			auto musicFile = std::make_shared<const Audio::WaveFile>(musicPath);
+			// the stream plays the file's frames as they are, it does not resample
+			if(musicFile->sampleRate() != static_cast<Uint32>(mixRate))
+			{
+				throw std::runtime_error(musicPath + " has " + std::to_string(musicFile->sampleRate()) + " Hz, the mixer runs at " + std::to_string(mixRate) + " Hz");
+			}
+			music = std::make_shared<Audio::AudioStream>(musicFile);
+			music->setLoop(true);
+			music->prefetch();
+			streamRefiller.add(music);
+			streamRefiller.start();
+			mixer.play(music.get(), 0.5f);
+		}
+
+		// microphone samples go through a lock-free ring to the analysis worker
+		std::optional<AudioDevice> captureDevice;
+		std::unique_ptr<Audio::CaptureFileFeeder> captureFeeder;
+		if(captureAudio)
+		{
+			if(!captureFile.empty())
+			{
+				captureFeeder = std::make_unique<Audio::CaptureFileFeeder>(capture, std::make_shared<const Audio::WaveFile>(captureFile));
+				captureFeeder->start();
+			}
+			else
+			{
+				SDL_AudioSpec captureSpec{}, captureGot{};
+				captureSpec.callback = &Audio::AudioCapture::callback;
+				captureSpec.freq = mixRate;
+				captureSpec.channels = 1;
+				captureSpec.format = AUDIO_F32SYS;
+				captureSpec.samples = audioBlockFrames;
+				captureSpec.userdata = &capture;
+				captureDevice = AudioDevice::open("", true, captureSpec, captureGot, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
+				if(captureDevice)
+				{
+					capture.setFormat(Audio::AudioFormat::fromSpec(captureGot));
+					captureDevice->unpause();
+				}
+			}
+			captureAnalyzer = std::make_unique<Audio::CaptureAnalyzer>(capture);
+			captureAnalyzer->start();
+		}
 
 		device->unpause();
 		
 		bool isDone = false;
 		// Handle quit events by setting the loop exit variable
-		eventManager.handlers[SDL_QUIT] = [&isDone](const SDL_Event&) { isDone = true; };
+		auto quitSubscription = eventManager.subscribe(SDL_QUIT, [&isDone](const SDL_Event&) { isDone = true; });
 		
 		bool hasFocus = false;
-		eventManager.handlers[SDL_WINDOWEVENT] = [&hasFocus, this](const SDL_Event& e) {
+		auto windowSubscription = eventManager.subscribe(SDL_WINDOWEVENT, [&hasFocus, this](const SDL_Event& e) {
 			switch (e.window.event)
 			{
 			// Handle focussing of window to change event polling mechanism on the fly to prevent hogging of cpu resources
@@ -156,16 +228,26 @@ namespace Engine {
 			case SDL_WINDOWEVENT_SIZE_CHANGED:
 				window.updateDstRect(); break;
 			}
-		};
+		});
 		
 		using namespace Input;
+		if(inputSampleRate > 0)
+		{
+			inputSampler.reset(new InputSampler(inputSampleRate));
+		}
 		axisInputManager.setKeyMapping(Axis::Main_X, SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT, -1.0, 0.0, 1.0);
 		axisInputManager.setKeyMapping(Axis::Main_Y, SDL_SCANCODE_UP, SDL_SCANCODE_DOWN, -1.0, 0.0, 1.0);
 		axisInputManager.setKeyMapping(Radial::Main, SDL_SCANCODE_W, SDL_SCANCODE_S, SDL_SCANCODE_A, SDL_SCANCODE_D);
 		axisInputManager.setKeyMapping(Axis::Aux_0, SDL_SCANCODE_LCTRL, 0.0, 1.0);
 				
-		for(int i = 0; i < ReSDL::Joystick::numJoysticks(); ++i)
-		{
+		// devices are mapped as they are connected, including the ones already there at startup
+		inputDevices.setAddedHandler([&](InputDevice& inputDevice) {
+			// the sampler only takes devices while it is stopped
+			const bool sampling = inputSampler && inputSampler->isRunning();
+			if(sampling)
+			{
+				inputSampler->stop();
+			}
 			auto axisMapping = [](Sint16 value) -> double {
 				// scales to [-1.0,1.0]
 				return (double)value / std::numeric_limits<Sint16>::max();
@@ -179,9 +261,13 @@ namespace Engine {
 				return { (double)x / std::numeric_limits<Sint16>::max(), (double)y / std::numeric_limits<Sint16>::max() };
 			};
 
-			if(ReSDL::GameController::isGameController(i))
+			if(inputDevice.isController())
 			{
-				auto gc = std::make_shared<ReSDL::GameController>(i);
+				auto gc = inputDevice.controller;
+				if(inputSampler)
+				{
+					inputSampler->add(gc);
+				}
 				axisInputManager.setGameControllerMapping(gc,
 					SDL_GameControllerAxis::SDL_CONTROLLER_AXIS_RIGHTX,
 					Axis::Main_X,
@@ -230,33 +316,61 @@ namespace Engine {
 					SDL_GameControllerButton::SDL_CONTROLLER_BUTTON_DPAD_RIGHT, 
 					Radial::Tertiary);
 
-				axisInputManager.setButtonHandler(Button::B, [&device, &ad](Button b, ButtonState s) {
+				axisInputManager.setButtonHandler(Button::B, [this, &tone, &toneVoice](Button b, ButtonState s) {
 					switch(s) {
 						case ButtonState::Push:
+							// the source can only be reset while no voice plays it, a press during the fade out is dropped
+							if(!mixer.isPlaying(toneVoice))
 							{
-								// lock audio
-								device->lock();
-								ad.volume = 1.0;
-								device->unlock();
-								// unlock audio
-								// if (device->getQueuedAudioSize() <= data.size()) {
-								// 	device->queueAudio(data);
-								// }
+								tone.reset();
+								toneVoice = mixer.play(&tone);
 							}
 							break;
 						case ButtonState::Release:
-								ad.volume = 0.0;
-							//device->clearQueuedAudio();
+							mixer.stop(toneVoice);
 							break;
 					} 
 				});
 			}
 			else
 			{
-				auto joystick = std::make_shared<ReSDL::Joystick>(i);
+				auto joystick = inputDevice.joystick;
+				if(inputSampler)
+				{
+					inputSampler->add(joystick);
+				}
 				axisInputManager.setJoystickMapping(joystick, 0, Axis::Main_X, axisMapping);
 				axisInputManager.setJoystickMapping(joystick, 1, Axis::Main_Y, axisMapping);
 			}
+			if(sampling)
+			{
+				inputSampler->start();
+			}
+		});
+		inputDevices.setRemovedHandler([&](InputDevice& inputDevice) {
+			axisInputManager.removeDevice(inputDevice.instanceId);
+			if(inputSampler)
+			{
+				const bool sampling = inputSampler->isRunning();
+				inputSampler->stop();
+				inputSampler->remove(inputDevice.instanceId);
+				if(sampling)
+				{
+					inputSampler->start();
+				}
+			}
+		});
+		inputDevices.openAll();
+		auto deviceSubscriptions = inputDevices.subscribe(eventManager);
+		
+		if(eventDrivenInput || inputSampler)
+		{
+			axisInputManager.setEventDriven(eventManager);
+		}
+		if(inputSampler)
+		{
+			axisInputManager.setSampler(inputSampler.get());
+			inputSampler->start();
 		}
 		
 		Ticks frameTicks;
@@ -275,7 +389,9 @@ namespace Engine {
 			{
 				eventManager.pollAndHandle();
 			}
+			axisInputManager.stampInput(eventManager.takeInputReceivedAt());
 			axisInputManager.handleAndSubmitEvents();
+			latency.frameStarted(axisInputManager.inputReceivedAt());
 			
 			// frame time calculation
 			const auto ticks = frameTicks.elapsedMs();
@@ -286,23 +402,72 @@ namespace Engine {
 			{
 				updateable->update(ticks);
 			}
+			// frame ticks count milliseconds, see Ticks::elapsedMs
+			voices.update(ticks.count() / 1000.0);
+			if(pushAudio)
+			{
+				audioDeadlines.queueSampled(static_cast<Uint32>(device->getQueuedAudioSize()));
+				audioOutput->queue(*device, queueTarget);
+			}
 			
 			window.prepareFrame();
 			for(auto &renderable : m_Renderables)
 			{
 				renderable->render(*window.renderer());
 			}
-			window.finalizeFrame();
+			latency.framePresented(window.finalizeFrame());
 		
 			frameCount++;
 			
 			if(frameCount % 100 == 0)
 			{
 				std::cout << 1000.0 / (accumulatedFrameTimes.count() / frameCount) << " fps" << std::endl;
+				std::cout << latency << std::endl;
+				latency.reset();
+				if(printAudioDeadlines)
+				{
+					std::cout << audioDeadlines.stats() << std::endl;
+					audioDeadlines.reset();
+				}
 				accumulatedFrameTimes = std::chrono::microseconds{};
 				frameCount = 0;
 			}
 		}
+
+		if(inputSampler)
+		{
+			inputSampler->stop();
+			axisInputManager.setSampler(nullptr);
+		}
+		// the mixer plays sounds that are locals of this function, pausing waits for a running callback
+		device->pause();
+		// end their voices before they go out of scope, stopping voices fade out within one block;
+		// rendering also drains the command queue if it was too full to take stopAll
+		std::vector<float> drain(Audio::Mixer::Channels * audioBlockFrames);
+		bool stopped = false;
+		do
+		{
+			stopped = stopped || mixer.stopAll();
+			mixer.render(drain.data(), audioBlockFrames);
+		}
+		while(!stopped || mixer.activeVoices() > 0);
+		if(captureDevice)
+		{
+			captureDevice->pause();
+		}
+		if(captureAnalyzer)
+		{
+			captureAnalyzer->stop();
+		}
+		// the handlers reference locals of this function
+		eventManager.unsubscribe(quitSubscription);
+		eventManager.unsubscribe(windowSubscription);
+		for(auto subscription : deviceSubscriptions)
+		{
+			eventManager.unsubscribe(subscription);
+		}
+		inputDevices.setAddedHandler(nullptr);
+		inputDevices.setRemovedHandler(nullptr);
 	}
 	
 	
@@ -76,11 +76,10 @@ public:
 	
 	void update(std::chrono::microseconds deltaT)
 	{
-		speed = speed + (acceleration * deltaT.count());
-		speed = speed * (1 - friction);
+		speed = (lazy(speed) + lazy(acceleration) * deltaT.count()) * (1 - friction);
 		if (speed.lengthSquared() < 0.0001) 
 			speed = Vec2d{};
-		m_Position = m_Position + speed * deltaT.count();
+		m_Position = lazy(m_Position) + lazy(speed) * deltaT.count();
 	}
 };
 
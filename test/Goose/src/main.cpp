@@ -10,8 +10,6 @@
 
 #include "ReSDL/ReSDL.h"
 
-//#include <SDL_mixer.h>
-
 #include "Engine/Engine.h"
 
 int main(int argc, const char * argv[])
@@ -70,10 +68,21 @@ int main(int argc, const char * argv[])
 	auto tex2 = std::make_shared<ReSDL::Texture>(renderer.get(), cloud.get());
 	SpriteSheet spriteCloud(tex2, 4,1);
 	
-	Mix_Init(MIX_INIT_OGG);
-	Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 1024);
-	Mix_Music *sound = Mix_LoadMUS("music.mid");
-	Mix_PlayMusic(sound, -1);
+	// the song is sequenced and synthesized in the audio callback, no SDL_mixer needed
+	Audio::Mixer mixer;
+	SDL_AudioSpec audioSpec{}, audioGot{};
+	audioSpec.freq = 44100;
+	audioSpec.format = AUDIO_F32SYS;
+	audioSpec.channels = 2;
+	audioSpec.samples = 1024;
+	audioSpec.callback = &Audio::Mixer::callback;
+	audioSpec.userdata = &mixer;
+	auto audioDevice = ReSDL::AudioDevice::open("", false, audioSpec, audioGot, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+	Audio::MidiPlayer music(std::make_shared<const Audio::MidiFile>("music.mid"), audioDevice ? audioGot.freq : audioSpec.freq);
+	music.setLoop(true);
+	mixer.play(&music);
+	if(audioDevice)
+		audioDevice->unpause();
 	
 	EventManager events;
 	AxisInputManager aim;
@@ -230,6 +239,7 @@ int main(int argc, const char * argv[])
 		if(fabs(velocity[0]) < 0.1) velocity[0] = 0;
 		if(fabs(velocity[1]) < 0.1) velocity[1] = 0;
 	}
-	Mix_Quit();
+	// close the device before the music it plays goes away
+	audioDevice.reset();
 	return 0;
 }
@@ -0,0 +1,99 @@
+// Runs a small fixed-point particle simulation from fixed seeds and compares its StateChecksum
+// with the one recorded when it was written. Every build, compiler and optimization level has to
+// arrive at the same value, that is what ENGINE_DETERMINISTIC promises. Returns non-zero if not.
+
+#include <cstdio>
+#include <cinttypes>
+#include <random>
+#include <vector>
+#include <type_traits>
+
+#include "SDL.h"
+#include "Engine/Engine.h"
+
+using namespace Engine;
+
+namespace {
+
+// PhysicsPoint2s is this type in ENGINE_DETERMINISTIC builds, so the check covers it there
+using Point = PhysicsPoint2fx;
+#ifdef ENGINE_DETERMINISTIC
+static_assert(std::is_same<PhysicsPoint2s, PhysicsPoint2fx>::value, "PhysicsPoint2s has to be fixed-point");
+#endif
+
+constexpr uint64_t ExpectedChecksum = 0xd34e2ec540450efeull;
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok) {
+		std::printf("FAILED: %s\n", what);
+		++failures;
+	}
+}
+
+// minstd_rand is specified exactly, the standard distributions are not, so only its raw output
+// is used; values in [-range, range] in raw Q16 steps
+Fixed randomFixed(std::minstd_rand& random, Fixed::Raw range)
+{
+	return Fixed::fromRaw(static_cast<Fixed::Raw>(random() % static_cast<uint32_t>(2 * range + 1)) - range);
+}
+
+uint64_t simulate()
+{
+	std::minstd_rand random(2015);
+	std::vector<Point> points;
+	for(int i = 0; i < 256; ++i) {
+		const Fixed mass = Fixed(1 + static_cast<int>(random() % 8)) + Fixed::fromRaw(random() % Fixed::One);
+		const Vec2fx position{ randomFixed(random, 1000 * Fixed::One), randomFixed(random, 1000 * Fixed::One) };
+		const Vec2fx velocity{ randomFixed(random, Fixed::One), randomFixed(random, Fixed::One) };
+		points.emplace_back(mass, position, velocity);
+	}
+
+	// gravity, drag and a wind that turns, so multiplication, division, sqrt and sin all take part
+	const Vec2fx gravity{ Fixed(0), Fixed::fromRaw(66) };
+	const Fixed drag = Fixed::fromRaw(-655);
+	StateChecksum checksum;
+	for(int step = 0; step < 600; ++step) {
+		const Fixed angle = Fixed(step) / 16;
+		const Vec2fx wind = Vec2fx{ cos(angle), sin(angle) } * Fixed::fromRaw(300);
+		for(auto& point : points) {
+			const Vec2fx velocity = point.getVelocity();
+			const Fixed speed = sqrt(velocity * velocity);
+			Vec2fx impulse = gravity * point.getMass() + velocity * (drag * speed) + wind;
+			if(step % 50 == 0) {
+				impulse = impulse + Vec2fx{ randomFixed(random, Fixed::One), randomFixed(random, Fixed::One) };
+			}
+			point = point.advance(impulse, std::chrono::milliseconds(16));
+		}
+		if(step % 60 == 59) {
+			for(const auto& point : points) {
+				addToChecksum(checksum, point);
+			}
+		}
+	}
+	return checksum.value();
+}
+
+}
+
+int main()
+{
+	// a few exact results the simulation relies on
+	check(Fixed(3) * Fixed(4) == Fixed(12), "integer multiplication");
+	check(Fixed(1) / Fixed(3) == Fixed::fromRaw(21845), "division truncates");
+	check(Fixed::fromRaw(-1) * Fixed::fromRaw(Fixed::One / 2) == Fixed::fromRaw(-1), "multiplication rounds down");
+	check(sqrt(Fixed(2)) == Fixed::fromRaw(92681), "sqrt");
+
+	const uint64_t first = simulate();
+	check(first == simulate(), "the same simulation twice");
+	if(first != ExpectedChecksum) {
+		std::printf("FAILED: checksum %016" PRIx64 ", expected %016" PRIx64 "\n", first, ExpectedChecksum);
+		++failures;
+	}
+	if(failures == 0) {
+		std::printf("all Fixed checks passed\n");
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+// Checks how SoftwareRenderer::copyEx maps a srcrect that runs past the texture: like SDL, the
+// missing part is cut off the destination instead of the rest being stretched over all of it.
+// Returns non-zero if anything differs.
+
+#include <cstdio>
+
+#include "SDL.h"
+#include "Engine/Graphics/SoftwareRenderer.h"
+
+using namespace Engine::Graphics;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+	if(!ok) {
+		std::printf("FAILED: %s\n", what);
+		++failures;
+	}
+}
+
+Uint32 pixel(const SoftwareTexture& texture, int x, int y)
+{
+	return texture.view().row(y).data[x];
+}
+
+// every column of an 8 by 8 target, from the top row; expected holds the source column or -1
+// for pixels that have to stay black
+bool columnsAre(const SoftwareTexture& target, const SoftwareTexture& source, const int (&expected)[8], Uint32 black)
+{
+	bool ok = true;
+	for(int y = 0; y < 8; ++y) {
+		for(int x = 0; x < 8; ++x) {
+			const Uint32 want = expected[x] < 0 ? black : pixel(source, expected[x], 0);
+			ok &= pixel(target, x, y) == want;
+		}
+	}
+	return ok;
+}
+
+}
+
+int main()
+{
+	ReSDL::Surface surface(Uint32(0), 8, 8, 32, 0x00FF0000u, 0x0000FF00u, 0x000000FFu, 0xFF000000u);
+	SoftwareRenderer renderer(surface);
+
+	// four columns of different colors
+	SoftwareTexture source = renderer.createTexture(4, 4);
+	renderer.setRenderTarget(&source);
+	const Uint8 shades[4] = { 40, 90, 160, 220 };
+	for(int x = 0; x < 4; ++x) {
+		renderer.setDrawColor(shades[x], 255 - shades[x], 0, 255);
+		renderer.fillRect(SDL_Rect{ x, 0, 1, 4 });
+	}
+
+	SoftwareTexture target = renderer.createTexture(8, 8);
+	const SDL_Rect dest{ 0, 0, 8, 8 };
+	auto draw = [&](const SDL_Rect& src, SDL_RendererFlip flip) {
+		renderer.setRenderTarget(&target);
+		renderer.setDrawColor(0, 0, 0, 255);
+		renderer.clear();
+		renderer.copyEx(source, &src, &dest, 0.0, nullptr, flip);
+		renderer.setRenderTarget(nullptr);
+	};
+	renderer.setRenderTarget(&target);
+	renderer.setDrawColor(0, 0, 0, 255);
+	renderer.clear();
+	renderer.setRenderTarget(nullptr);
+	const Uint32 black = pixel(target, 0, 0);
+
+	// inside the texture every source column covers two target columns
+	draw(SDL_Rect{ 0, 0, 4, 4 }, SDL_FLIP_NONE);
+	check(columnsAre(target, source, { 0, 0, 1, 1, 2, 2, 3, 3 }, black), "srcrect inside the texture");
+
+	// half of srcrect is right of the texture, so only the left half of dest is drawn
+	draw(SDL_Rect{ 2, 0, 4, 4 }, SDL_FLIP_NONE);
+	check(columnsAre(target, source, { 2, 2, 3, 3, -1, -1, -1, -1 }, black), "srcrect past the right edge");
+
+	// and left of it, only the right half
+	draw(SDL_Rect{ -2, 0, 4, 4 }, SDL_FLIP_NONE);
+	check(columnsAre(target, source, { -1, -1, -1, -1, 0, 0, 1, 1 }, black), "srcrect past the left edge");
+
+	// flipped, the missing part ends up on the other side of dest
+	draw(SDL_Rect{ 2, 0, 4, 4 }, SDL_FLIP_HORIZONTAL);
+	check(columnsAre(target, source, { -1, -1, -1, -1, 3, 3, 2, 2 }, black), "flipped srcrect past the right edge");
+
+	// past the bottom edge the rows are cut the same way
+	draw(SDL_Rect{ 0, 2, 4, 4 }, SDL_FLIP_NONE);
+	bool ok = true;
+	for(int x = 0; x < 8; ++x) {
+		for(int y = 0; y < 8; ++y) {
+			ok &= (pixel(target, x, y) == black) == (y >= 4);
+		}
+	}
+	check(ok, "srcrect past the bottom edge");
+
+	if(failures == 0) {
+		std::printf("all SoftwareRenderer checks passed\n");
+	}
+	return failures == 0 ? 0 : 1;
+}
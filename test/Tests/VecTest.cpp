@@ -0,0 +1,138 @@
+// Checks the SIMD kernels and the lazy expressions of Vec against plain scalar loops, and
+// the constexpr path against the runtime one. Returns non-zero if anything differs.
+
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+#include "SDL.h"
+#include "Engine/Utilities.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what, int size)
+{
+	if(!ok) {
+		std::printf("FAILED: %s for N = %d\n", what, size);
+		++failures;
+	}
+}
+
+// sums may be formed in a different order than in the scalar loop, so allow rounding errors
+// relative to the magnitude of what was added up
+template<typename T>
+bool close(T a, T b, T magnitude)
+{
+	return std::abs(a - b) <= std::max(magnitude, T(1)) * std::numeric_limits<T>::epsilon() * 8;
+}
+
+template<typename T, size_t N>
+Vec<T,N> randomVec(std::minstd_rand& random)
+{
+	std::uniform_real_distribution<T> value(T(-1000), T(1000));
+	Vec<T,N> result;
+	for(size_t i = 0; i < N; ++i) {
+		result[i] = value(random);
+	}
+	return result;
+}
+
+template<typename T, size_t N>
+void checkKernels(std::minstd_rand& random)
+{
+	const int size = static_cast<int>(N);
+	for(int round = 0; round < 10000; ++round) {
+		const Vec<T,N> a = randomVec<T,N>(random);
+		const Vec<T,N> b = randomVec<T,N>(random);
+		const T s = std::uniform_real_distribution<T>(T(-10), T(10))(random);
+
+		const Vec<T,N> sum = a + b;
+		const Vec<T,N> difference = a - b;
+		const Vec<T,N> scaled = a * s;
+		const Vec<T,N> divided = a / s;
+		const Vec<T,N> negated = -a;
+		const T dot = a * b;
+
+		T expectedDot = T(0);
+		T dotMagnitude = T(0);
+		bool sumOk = true, differenceOk = true, scaledOk = true, dividedOk = true, negatedOk = true;
+		for(size_t i = 0; i < N; ++i) {
+			sumOk &= sum[i] == a[i] + b[i];
+			differenceOk &= difference[i] == a[i] - b[i];
+			scaledOk &= scaled[i] == a[i] * s;
+			dividedOk &= divided[i] == a[i] / s;
+			negatedOk &= negated[i] == -a[i];
+			expectedDot += a[i] * b[i];
+			dotMagnitude += std::abs(a[i] * b[i]);
+		}
+		check(sumOk, "a + b", size);
+		check(differenceOk, "a - b", size);
+		check(scaledOk, "a * scalar", size);
+		check(dividedOk, "a / scalar", size);
+		check(negatedOk, "-a", size);
+		check(close(dot, expectedDot, dotMagnitude), "dot product", size);
+
+		// the fused expression has to give what the eager operators give
+		const Vec<T,N> eager = a + b * s - a / s;
+		const Vec<T,N> fused = lazy(a) + lazy(b) * s - lazy(a) / s;
+		const Vec<T,N> evaluated = eval(-(lazy(a) - lazy(b)) * s);
+		const Vec<T,N> eagerNegated = -(a - b) * s;
+		bool fusedOk = true, evaluatedOk = true;
+		for(size_t i = 0; i < N; ++i) {
+			fusedOk &= close(fused[i], eager[i], std::abs(a[i]) + std::abs(b[i] * s) + std::abs(a[i] / s));
+			evaluatedOk &= close(evaluated[i], eagerNegated[i], std::abs((a[i] - b[i]) * s));
+		}
+		check(fusedOk, "lazy(a) + lazy(b) * s - lazy(a) / s", size);
+		check(evaluatedOk, "eval(-(lazy(a) - lazy(b)) * s)", size);
+
+		if(failures > 20) {
+			return;
+		}
+	}
+}
+
+// Vec operators in a constant expression take the scalar loops
+constexpr Vec4d constA{ 1.5, -2.0, 3.25, 4.0 };
+constexpr Vec4d constB{ 0.5, 8.0, -1.0, 2.0 };
+constexpr Vec4d constSum = constA + constB;
+constexpr Vec4d constScaled = constA * 2.0;
+constexpr double constDot = constA * constB;
+constexpr Vec4d constFused = lazy(constA) + lazy(constB) * 0.5;
+static_assert(constSum[0] == 2.0 && constSum[1] == 6.0 && constSum[2] == 2.25 && constSum[3] == 6.0, "constexpr addition");
+static_assert(constScaled[2] == 6.5, "constexpr scaling");
+static_assert(constDot == 0.75 - 16.0 - 3.25 + 8.0, "constexpr dot product");
+static_assert(constFused[1] == 2.0, "constexpr lazy expression");
+
+void checkConstantEvaluation()
+{
+	// the same operations at runtime use the kernels
+	const Vec4d a = constA;
+	const Vec4d b = constB;
+	const Vec4d sum = a + b;
+	const Vec4d scaled = a * 2.0;
+	bool ok = true;
+	for(size_t i = 0; i < 4; ++i) {
+		ok &= sum[i] == constSum[i] && scaled[i] == constScaled[i];
+	}
+	check(ok, "constexpr and runtime results", 4);
+	check(a * b == constDot, "constexpr and runtime dot product", 4);
+}
+
+}
+
+int main()
+{
+	std::minstd_rand random(42);
+	checkKernels<float, 4>(random);
+	checkKernels<double, 2>(random);
+	checkKernels<double, 3>(random);
+	checkKernels<double, 4>(random);
+	checkConstantEvaluation();
+	if(failures == 0) {
+		std::printf("all Vec checks passed\n");
+	}
+	return failures == 0 ? 0 : 1;
+}